@@ -38,6 +38,8 @@
 #ifndef LLVM_ANALYSIS_ALIASANALYSIS_H
 #define LLVM_ANALYSIS_ALIASANALYSIS_H
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/None.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SmallVector.h"
@@ -284,6 +286,14 @@ createModRefInfo(const FunctionModRefBehavior FMRB) {
   return ModRefInfo(FMRB & static_cast<int>(ModRefInfo::ModRef));
 }
 
+/// The caches that an alias analysis keeps across the queries of a \c
+/// BatchAAResults. They are owned by the batch, and only used while the
+/// analysis answers one of its queries.
+class AABatchState {
+public:
+  virtual ~AABatchState() = default;
+};
+
 class AAResults {
 public:
   // Make these results default constructable and movable. We have to spell
@@ -714,17 +724,79 @@ private:
 
   template <typename T> friend class AAResultBase;
 
+  friend class BatchAAResults;
+
   const TargetLibraryInfo &TLI;
 
   std::vector<std::unique_ptr<Concept>> AAs;
 
   std::vector<AnalysisKey *> AADeps;
+
+  /// The states of the BatchAAResults whose query is being answered, if any.
+  std::vector<std::unique_ptr<AABatchState>> *BatchStates = nullptr;
+
+  /// Create the states that each analysis keeps for a BatchAAResults.
+  std::vector<std::unique_ptr<AABatchState>> createBatchStates();
+
+  /// Make the analyses use \p States, or no batch state if null, for the next
+  /// queries. Returns the states used until now.
+  std::vector<std::unique_ptr<AABatchState>> *
+  setBatchStates(std::vector<std::unique_ptr<AABatchState>> *States);
 };
 
 /// Temporary typedef for legacy code that uses a generic \c AliasAnalysis
 /// pointer or reference.
 using AliasAnalysis = AAResults;
 
+/// A wrapper around \c AAResults for a sequence of queries with no change to
+/// the IR in between, such as a scan over the instructions of a block.
+///
+/// The results of the alias queries are cached for the lifetime of this
+/// object, and the underlying analyses may keep their own caches across the
+/// queries (BasicAA keeps the decomposed GEP expressions). These caches only
+/// serve the queries made through this object: the other users of the \c
+/// AAResults are not affected. A client that changes the IR while the batch is
+/// live must call \c clear().
+class BatchAAResults {
+  using LocPair = std::pair<MemoryLocation, MemoryLocation>;
+
+  AAResults &AA;
+  std::vector<std::unique_ptr<AABatchState>> States;
+  SmallDenseMap<LocPair, AliasResult, 8> AliasCache;
+
+  /// Answer \p Query with the analyses using the states of this batch.
+  template <typename QueryT> auto query(QueryT Query) -> decltype(Query()) {
+    auto *OldStates = AA.setBatchStates(&States);
+    auto Result = Query();
+    AA.setBatchStates(OldStates);
+    return Result;
+  }
+
+public:
+  explicit BatchAAResults(AAResults &AA)
+      : AA(AA), States(AA.createBatchStates()) {}
+  BatchAAResults(const BatchAAResults &) = delete;
+  BatchAAResults &operator=(const BatchAAResults &) = delete;
+
+  AAResults &getAAResults() { return AA; }
+
+  AliasResult alias(const MemoryLocation &LocA, const MemoryLocation &LocB);
+
+  /// Answer the alias query for each pair of locations in \p Pairs, appending
+  /// the results to \p Results in the order of \p Pairs. The queries are
+  /// answered grouped by the underlying objects of their locations, so that
+  /// the ones decomposing the same GEP chains run back to back.
+  void alias(ArrayRef<LocPair> Pairs, SmallVectorImpl<AliasResult> &Results);
+
+  ModRefInfo getModRefInfo(const Instruction *I,
+                           const Optional<MemoryLocation> &OptLoc) {
+    return query([&] { return AA.getModRefInfo(I, OptLoc); });
+  }
+
+  /// Forget all cached results, after a change to the IR.
+  void clear();
+};
+
 /// A private abstract base class describing the concept of an individual alias
 /// analysis implementation.
 ///
@@ -742,6 +814,14 @@ public:
   /// a handle back to the top level aggregation.
   virtual void setAAResults(AAResults *NewAAR) = 0;
 
+  /// Create the caches to keep across the queries of a \c BatchAAResults, or
+  /// return null if this analysis keeps none.
+  virtual std::unique_ptr<AABatchState> createBatchState() = 0;
+
+  /// Use \p State, created by createBatchState, for the next queries. A null
+  /// state ends the use of the previous one.
+  virtual void setBatchState(AABatchState *State) = 0;
+
   //===--------------------------------------------------------------------===//
   /// \name Alias Queries
   /// @{
@@ -808,6 +888,14 @@ public:
 
   void setAAResults(AAResults *NewAAR) override { Result.setAAResults(NewAAR); }
 
+  std::unique_ptr<AABatchState> createBatchState() override {
+    return Result.createBatchState();
+  }
+
+  void setBatchState(AABatchState *State) override {
+    Result.setBatchState(State);
+  }
+
   AliasResult alias(const MemoryLocation &LocA,
                     const MemoryLocation &LocB) override {
     return Result.alias(LocA, LocB);
@@ -934,6 +1022,10 @@ protected:
   AAResultsProxy getBestAAResults() { return AAResultsProxy(AAR, derived()); }
 
 public:
+  std::unique_ptr<AABatchState> createBatchState() { return nullptr; }
+
+  void setBatchState(AABatchState *State) {}
+
   AliasResult alias(const MemoryLocation &LocA, const MemoryLocation &LocB) {
     return MayAlias;
   }
@@ -96,6 +96,10 @@ public:
   /// call site is not known.
   FunctionModRefBehavior getModRefBehavior(const Function *F);
 
+  /// Keep the decomposed GEP expressions across the queries of a batch.
+  std::unique_ptr<AABatchState> createBatchState();
+  void setBatchState(AABatchState *State);
+
 private:
   // A linear transformation of a Value; this class represents ZExt(SExt(V,
   // SExtBits), ZExtBits) * Scale + Offset.
@@ -160,6 +164,20 @@ private:
   /// Tracks instructions visited by pointsToConstantMemory.
   SmallPtrSet<const Value *, 16> Visited;
 
+  /// The caches kept across the queries of a BatchAAResults.
+  struct BatchState : public AABatchState {
+    /// The decomposed GEP expressions computed in the batch, and whether their
+    /// decomposition reached the maximum lookup depth.
+    DenseMap<const Value *, std::pair<DecomposedGEP, bool>> DecomposedGEPs;
+  };
+
+  /// The state of the batch whose query is being answered, if any.
+  BatchState *CurBatch = nullptr;
+
+  /// Decompose \p V with DecomposeGEPExpression, or get it from the cache of
+  /// the current batch of queries.
+  bool getDecomposedGEP(const Value *V, DecomposedGEP &Decomposed);
+
   static const Value *
   GetLinearExpression(const Value *V, APInt &Scale, APInt &Offset,
                       unsigned &ZExtBits, unsigned &SExtBits,
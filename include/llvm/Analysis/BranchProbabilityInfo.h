@@ -134,6 +134,19 @@ public:
   void calculate(const Function &F, const LoopInfo &LI,
                  const TargetLibraryInfo *TLI = nullptr);
 
+  /// \brief Attach the edge probabilities of \p F to it as metadata.
+  ///
+  /// The probabilities are tagged with the content hash of \p F, so that a
+  /// later invocation can load them with \see loadPersisted as long as the
+  /// function has not changed.
+  void persist(Function &F) const;
+
+  /// \brief Load the edge probabilities persisted in the metadata of \p F.
+  ///
+  /// Returns false, leaving this object untouched, if there are none or if
+  /// the function changed since they were persisted.
+  bool loadPersisted(const Function &F);
+
   /// Forget analysis results for the given basic block.
   void eraseBlock(const BasicBlock *BB);
 
@@ -311,6 +311,13 @@ struct CGSCCUpdateResult {
 /// \c CGSCCAnalysisManagerModuleProxy analysis prior to running the CGSCC
 /// pass over the module to enable a \c FunctionAnalysisManager to be used
 /// within this run safely.
+///
+/// The SCCs are visited one at a time, even when they do not reference each
+/// other. CGSCC passes update the call graph in place, which can merge or
+/// split RefSCCs and reorder the rest of the walk. They also mutate IR that
+/// shares a single, non thread-safe \c LLVMContext with every other function
+/// in the module. Scheduling sibling SCCs concurrently would require neither
+/// to hold.
 template <typename CGSCCPassT>
 class ModuleToPostOrderCGSCCPassAdaptor
     : public PassInfoMixin<ModuleToPostOrderCGSCCPassAdaptor<CGSCCPassT>> {
@@ -0,0 +1,59 @@
+//===- llvm/Analysis/KnownBitsCache.h - Known bits memoization --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the KnownBitsCache class, which memoizes the recursive
+// queries of computeKnownBits and ComputeNumSignBits.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ANALYSIS_KNOWNBITSCACHE_H
+#define LLVM_ANALYSIS_KNOWNBITSCACHE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/KnownBits.h"
+#include <utility>
+
+namespace llvm {
+
+class Instruction;
+class Value;
+
+/// Memoizes the results of the recursive queries made by one call to
+/// computeKnownBits, MaskedValueIsZero or ComputeNumSignBits. The subqueries
+/// of a call often reach the same values several times, through shared
+/// operands, selects and phis.
+///
+/// Results are keyed on the value, the context instruction and the depth of
+/// the query, so a hit returns exactly what the query would compute. The
+/// entry points of ValueTracking clear the cache before they use it, so the
+/// results never outlive a change to the IR and one cache can be reused
+/// across queries to save its allocations.
+class KnownBitsCache {
+public:
+  using KeyTy =
+      std::pair<const Value *, std::pair<const Instruction *, unsigned>>;
+
+  const KnownBits *lookupKnownBits(const KeyTy &Key) const;
+  void insertKnownBits(const KeyTy &Key, const KnownBits &Known);
+  const unsigned *lookupNumSignBits(const KeyTy &Key) const;
+  void insertNumSignBits(const KeyTy &Key, unsigned NumSignBits);
+
+  void clear() {
+    KnownBitsResults.clear();
+    NumSignBitsResults.clear();
+  }
+
+private:
+  DenseMap<KeyTy, KnownBits> KnownBitsResults;
+  DenseMap<KeyTy, unsigned> NumSignBitsResults;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_ANALYSIS_KNOWNBITSCACHE_H
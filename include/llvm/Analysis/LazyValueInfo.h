@@ -107,6 +107,15 @@ public:
   /// Inform the analysis cache that we have erased a block.
   void eraseBlock(BasicBlock *BB);
 
+  /// Inform the analysis cache that the edge from PredBB to Succ has been
+  /// removed, so the values it made overdefined in Succ can be solved again.
+  void eraseEdge(BasicBlock *PredBB, BasicBlock *Succ);
+
+  /// Use DT, or no dominator tree if it is null, for the following queries.
+  /// Passes that preserve this analysis but not the dominator tree must reset
+  /// it to null before they return, so the cached results outlive them.
+  void setDominatorTree(DominatorTree *DT);
+
   /// Print the \LazyValueInfo Analysis.
   /// We pass in the DTree that is required for identifying which basic blocks
   /// we can solve/print for, in the LVIPrinter. The DT is optional
@@ -162,10 +162,14 @@ public:
                const SmallVectorImpl<Instruction *> &Instrs) const;
   };
 
-  MemoryDepChecker(PredicatedScalarEvolution &PSE, const Loop *L)
+  /// If \p MinUsefulVF is more than 1, the dependences are only analyzed
+  /// while they allow vectorizing with at least that many elements.
+  MemoryDepChecker(PredicatedScalarEvolution &PSE, const Loop *L,
+                   unsigned MinUsefulVF = 0)
       : PSE(PSE), InnermostLoop(L), AccessIdx(0), MaxSafeRegisterWidth(-1U),
+        MaxSafeVF(-1ULL), MinUsefulVF(MinUsefulVF),
         ShouldRetryWithRuntimeCheck(false), SafeForVectorization(true),
-        RecordDependences(true) {}
+        RecordDependences(true), StoppedBelowMinUsefulVF(false) {}
 
   /// \brief Register the location (instructions are given increasing numbers)
   /// of a write access.
@@ -208,12 +212,16 @@ public:
   bool shouldRetryWithRuntimeCheck() { return ShouldRetryWithRuntimeCheck; }
 
   /// \brief Returns the memory dependences.  If null is returned we exceeded
-  /// the MaxDependences threshold and this information is not
-  /// available.
+  /// the MaxDependences threshold, or stopped below the smallest useful VF,
+  /// and this information is not available.
   const SmallVectorImpl<Dependence> *getDependences() const {
     return RecordDependences ? &Dependences : nullptr;
   }
 
+  /// \brief The dependences ruled out the smallest useful VF, and were not
+  /// all analyzed.
+  bool stoppedBelowMinUsefulVF() const { return StoppedBelowMinUsefulVF; }
+
   void clearDependences() { Dependences.clear(); }
 
   /// \brief The vector of memory access instructions.  The indices are used as
@@ -265,6 +273,14 @@ private:
   /// restrictive.
   uint64_t MaxSafeRegisterWidth;
 
+  /// \brief Number of elements (from consecutive iterations) that are safe to
+  /// operate on simultaneously, taken from the most restrictive dependence.
+  uint64_t MaxSafeVF;
+
+  /// \brief The smallest vectorization factor the client can use, or 0 to
+  /// analyze all the dependences.
+  unsigned MinUsefulVF;
+
   /// \brief If we see a non-constant dependence distance we can still try to
   /// vectorize this loop with runtime checks.
   bool ShouldRetryWithRuntimeCheck;
@@ -278,6 +294,10 @@ private:
   //// Dependences is invalid.
   bool RecordDependences;
 
+  /// \brief True if MaxSafeVF dropped below MinUsefulVF, after which only the
+  /// dependences that call for runtime checks are looked for.
+  bool StoppedBelowMinUsefulVF;
+
   /// \brief Memory dependences collected during the analysis.  Only valid if
   /// RecordDependences is true.
   SmallVector<Dependence, 8> Dependences;
@@ -492,8 +512,13 @@ private:
 /// PSE must be emitted in order for the results of this analysis to be valid.
 class LoopAccessInfo {
 public:
+  /// If \p MinUsefulVF is more than 1, the dependence analysis stops early
+  /// once the dependences rule out vectorizing with that many elements, unless
+  /// runtime checks could still vectorize the loop. The dependences are then
+  /// not available, so the result only suits the vectorizer.
   LoopAccessInfo(Loop *L, ScalarEvolution *SE, const TargetLibraryInfo *TLI,
-                 AliasAnalysis *AA, DominatorTree *DT, LoopInfo *LI);
+                 AliasAnalysis *AA, DominatorTree *DT, LoopInfo *LI,
+                 unsigned MinUsefulVF = 0);
 
   /// Return true we can analyze the memory accesses in the loop and there are
   /// no memory dependence cycles.
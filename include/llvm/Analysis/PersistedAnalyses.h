@@ -0,0 +1,46 @@
+//===- PersistedAnalyses.h - Analyses persisted in the IR -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines utilities to persist the results of expensive function
+// analyses as metadata attached to the function, so that a later invocation of
+// the optimizer can load them instead of recomputing them. Persisted results
+// are tagged with a hash of the function contents and are ignored as soon as
+// the function changes.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ANALYSIS_PERSISTEDANALYSES_H
+#define LLVM_ANALYSIS_PERSISTEDANALYSES_H
+
+#include "llvm/IR/PassManager.h"
+#include <cstdint>
+
+namespace llvm {
+
+class Function;
+
+/// \brief Compute a hash of the contents of \p F.
+///
+/// The hash is stable across invocations of the compiler and only covers what
+/// is visible in the IR: the CFG, the instructions and their operands, and the
+/// profile metadata. It does not depend on the names of local values.
+uint64_t computeFunctionContentHash(const Function &F);
+
+/// \brief Attach the results of the persistable analyses to each function.
+///
+/// Currently only branch probabilities are persisted; see
+/// BranchProbabilityInfo::persist.
+class PersistAnalysesPass : public PassInfoMixin<PersistAnalysesPass> {
+public:
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &AM);
+};
+
+} // end namespace llvm
+
+#endif // LLVM_ANALYSIS_PERSISTEDANALYSES_H
@@ -1037,6 +1037,11 @@ private:
   /// thare are guards present in the IR.
   bool HasGuards;
 
+  /// Units of work charged so far to the -scalar-evolution-budget of this
+  /// function, and whether it ran out.
+  unsigned BudgetUsed = 0;
+  bool BudgetExhausted = false;
+
   /// The target library information for the target we are targeting.
   TargetLibraryInfo &TLI;
 
@@ -1339,15 +1344,7 @@ private:
 
   /// Set the memoized range for the given SCEV.
   const ConstantRange &setRange(const SCEV *S, RangeSignHint Hint,
-                                ConstantRange CR) {
-    DenseMap<const SCEV *, ConstantRange> &Cache =
-        Hint == HINT_RANGE_UNSIGNED ? UnsignedRanges : SignedRanges;
-
-    auto Pair = Cache.try_emplace(S, std::move(CR));
-    if (!Pair.second)
-      Pair.first->second = std::move(CR);
-    return Pair.first->second;
-  }
+                                ConstantRange CR);
 
   /// Determine the range for a particular SCEV.
   /// NOTE: This returns a reference to an entry in a cache. It must be
@@ -1369,6 +1366,11 @@ private:
   /// expression.
   const SCEV *createSCEV(Value *V);
 
+  /// Charge one unit of work to the -scalar-evolution-budget of this function.
+  /// Returns false once the budget is exhausted, in which case the caller must
+  /// give up with a conservative answer.
+  bool consumeBudget();
+
   /// Provide the special handling we need to analyze PHI SCEVs.
   const SCEV *createNodeForPHI(PHINode *PN);
 
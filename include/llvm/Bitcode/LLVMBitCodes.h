@@ -256,6 +256,10 @@ enum GlobalValueSummarySymtabCodes {
   // strings in strtab.
   // [n * name]
   FS_CFI_FUNCTION_DECLS = 18,
+  // The hash of the body of the following function and of the module-level
+  // state it can refer to. It is used to compute incremental cache keys.
+  // [5*i32]
+  FS_CONTENT_HASH = 19,
 };
 
 enum MetadataCodes {
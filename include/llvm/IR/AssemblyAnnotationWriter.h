@@ -55,6 +55,15 @@ public:
   /// printInfoComment - This may be implemented to emit a comment to the
   /// right of an instruction or global value.
   virtual void printInfoComment(const Value &, formatted_raw_ostream &) {}
+
+  /// prepareFunctionBody - Before printing a module, the writer walks every
+  /// function body to collect the types it uses. This may be implemented to
+  /// load a body that is not materialized yet right before it is walked.
+  virtual void prepareFunctionBody(const Function *) {}
+
+  /// releaseFunctionBody - Called once the writer is done walking the body
+  /// of a function to collect its types.
+  virtual void releaseFunctionBody(const Function *) {}
 };
 
 } // End llvm namespace
@@ -1648,6 +1648,9 @@ public:
   DILocalVariableArray getVariables() const {
     return cast_or_null<MDTuple>(getRawVariables());
   }
+  void replaceVariables(DILocalVariableArray N) {
+    replaceOperandWith(7, N.get());
+  }
   DITypeArray getThrownTypes() const {
     return cast_or_null<MDTuple>(getRawThrownTypes());
   }
@@ -41,6 +41,10 @@ public:
   ///
   virtual Error materializeModule() = 0;
 
+  /// Release the body of the given GlobalValue, if it can be read again by
+  /// a later call to materialize.
+  virtual void dematerialize(GlobalValue *GV) = 0;
+
   virtual Error materializeMetadata() = 0;
   virtual void setStripDebugInfo() = 0;
 
@@ -484,6 +484,10 @@ public:
   /// Make sure the GlobalValue is fully read.
   llvm::Error materialize(GlobalValue *GV);
 
+  /// Release the body of a materialized GlobalValue if the Materializer can
+  /// read it again, to bound memory when visiting one function at a time.
+  void dematerialize(GlobalValue *GV);
+
   /// Make sure all GlobalValues in this Module are fully read and clear the
   /// Materializer.
   llvm::Error materializeAll();
@@ -300,6 +300,9 @@ inline GlobalValueSummary *GlobalValueSummary::getBaseObject() {
   return this;
 }
 
+/// 160 bits SHA1
+using ModuleHash = std::array<uint32_t, 5>;
+
 /// \brief Function summary information to aid decisions and implementation of
 /// importing.
 class FunctionSummary : public GlobalValueSummary {
@@ -366,6 +369,10 @@ private:
 
   std::unique_ptr<TypeIdInfo> TIdInfo;
 
+  /// Hash of the function body and of the module-level state it can refer to,
+  /// computed when the bitcode is written. All zeros if it wasn't computed.
+  ModuleHash ContentHash = {{0}};
+
 public:
   FunctionSummary(GVFlags Flags, unsigned NumInsts, FFlags FunFlags,
                   std::vector<ValueInfo> Refs, std::vector<EdgeTy> CGEdges,
@@ -401,6 +408,12 @@ public:
   /// Return the list of <CalleeValueInfo, CalleeInfo> pairs.
   ArrayRef<EdgeTy> calls() const { return CallGraphEdgeList; }
 
+  /// Get the content hash of the function, all zeros if it is unknown.
+  const ModuleHash &contentHash() const { return ContentHash; }
+
+  /// Set the content hash of the function.
+  void setContentHash(const ModuleHash &Hash) { ContentHash = Hash; }
+
   /// Returns the list of type identifiers used by this function in
   /// llvm.type.test intrinsics other than by an llvm.assume intrinsic,
   /// represented as GUIDs.
@@ -578,9 +591,6 @@ struct TypeIdSummary {
   std::map<uint64_t, WholeProgramDevirtResolution> WPDRes;
 };
 
-/// 160 bits SHA1
-using ModuleHash = std::array<uint32_t, 5>;
-
 /// Type used for iterating through the global value summary map.
 using const_gvsummary_iterator = GlobalValueSummaryMapTy::const_iterator;
 using gvsummary_iterator = GlobalValueSummaryMapTy::iterator;
@@ -15,11 +15,13 @@
 #define LLVM_IR_TYPEFINDER_H
 
 #include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
 #include <cstddef>
 #include <vector>
 
 namespace llvm {
 
+class Function;
 class MDNode;
 class Module;
 class StructType;
@@ -42,6 +44,13 @@ public:
   TypeFinder() = default;
 
   void run(const Module &M, bool onlyNamed);
+
+  /// Like run, but call \p PrepareBody on each function before walking its
+  /// body and \p ReleaseBody after, so that the bodies of a lazily loaded
+  /// module can be brought in one at a time.
+  void run(const Module &M, bool onlyNamed,
+           function_ref<void(const Function &)> PrepareBody,
+           function_ref<void(const Function &)> ReleaseBody);
   void clear();
 
   using iterator = std::vector<StructType*>::iterator;
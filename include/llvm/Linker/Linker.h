@@ -14,6 +14,7 @@
 #include "llvm/Linker/IRMover.h"
 
 namespace llvm {
+class GlobalValue;
 class Module;
 class StructType;
 class Type;
@@ -52,6 +53,10 @@ public:
                           unsigned Flags = Flags::None,
                           std::function<void(Module &, const StringSet<> &)>
                               InternalizeCallback = {});
+
+  /// Whether a non-local \p GV is only linked in when the composite
+  /// references it, as linkonce and available_externally definitions are.
+  static bool isLinkedLazily(const GlobalValue &GV);
 };
 
 } // End llvm namespace
@@ -254,63 +254,65 @@ struct SemiNCAInfo {
     return LastNum;
   }
 
-  NodePtr eval(NodePtr VIn, unsigned LastLinked) {
-    auto &VInInfo = NodeToInfo[VIn];
-    if (VInInfo.DFSNum < LastLinked)
-      return VIn;
-
-    SmallVector<NodePtr, 32> Work;
-    SmallPtrSet<NodePtr, 32> Visited;
-
-    if (VInInfo.Parent >= LastLinked)
-      Work.push_back(VIn);
-
-    while (!Work.empty()) {
-      NodePtr V = Work.back();
-      auto &VInfo = NodeToInfo[V];
-      NodePtr VAncestor = NumToNode[VInfo.Parent];
-
-      // Process Ancestor first
-      if (Visited.insert(VAncestor).second && VInfo.Parent >= LastLinked) {
-        Work.push_back(VAncestor);
-        continue;
-      }
-      Work.pop_back();
-
-      // Update VInfo based on Ancestor info
-      if (VInfo.Parent < LastLinked)
-        continue;
+  // The parts of InfoRec that Semi-NCA reads and updates, with the nodes
+  // replaced by their DFS numbers. runSemiNCA copies them into an array indexed
+  // by DFS number, so that the path compression in eval doesn't need to look
+  // up NodeToInfo at every step, which dominates the runtime on large CFGs.
+  struct SemiNCANode {
+    unsigned Parent;
+    unsigned Semi;
+    unsigned Label;
+    unsigned IDom;
+  };
 
-      auto &VAInfo = NodeToInfo[VAncestor];
-      NodePtr VAncestorLabel = VAInfo.Label;
-      NodePtr VLabel = VInfo.Label;
-      if (NodeToInfo[VAncestorLabel].Semi < NodeToInfo[VLabel].Semi)
-        VInfo.Label = VAncestorLabel;
-      VInfo.Parent = VAInfo.Parent;
+  static unsigned eval(unsigned V, unsigned LastLinked,
+                       std::vector<SemiNCANode> &Nodes,
+                       SmallVectorImpl<unsigned> &Stack) {
+    if (V < LastLinked)
+      return V;
+
+    // Collect the path to the first ancestor that is not linked yet, and
+    // compress it starting from its top.
+    assert(Stack.empty() && "Stack should be empty between evaluations");
+    for (unsigned W = V; Nodes[W].Parent >= LastLinked; W = Nodes[W].Parent)
+      Stack.push_back(W);
+
+    while (!Stack.empty()) {
+      SemiNCANode &WInfo = Nodes[Stack.pop_back_val()];
+      const SemiNCANode &WAInfo = Nodes[WInfo.Parent];
+      if (Nodes[WAInfo.Label].Semi < Nodes[WInfo.Label].Semi)
+        WInfo.Label = WAInfo.Label;
+      WInfo.Parent = WAInfo.Parent;
     }
 
-    return VInInfo.Label;
+    return Nodes[V].Label;
   }
 
   // This function requires DFS to be run before calling it.
   void runSemiNCA(DomTreeT &DT, const unsigned MinLevel = 0) {
     const unsigned NextDFSNum(NumToNode.size());
-    // Initialize IDoms to spanning tree parents.
+    // Copy the DFS information into the compact array, with the IDoms
+    // initialized to spanning tree parents. The node 0 is the dummy element of
+    // NumToNode.
+    std::vector<InfoRec *> NumToInfo(NextDFSNum, nullptr);
+    std::vector<SemiNCANode> Nodes(NextDFSNum, SemiNCANode{0, 0, 0, 0});
     for (unsigned i = 1; i < NextDFSNum; ++i) {
-      const NodePtr V = NumToNode[i];
-      auto &VInfo = NodeToInfo[V];
-      VInfo.IDom = NumToNode[VInfo.Parent];
+      InfoRec &VInfo = NodeToInfo.find(NumToNode[i])->second;
+      assert(VInfo.DFSNum == i && "DFS numbers out of sync with NumToNode");
+      NumToInfo[i] = &VInfo;
+      Nodes[i] = SemiNCANode{VInfo.Parent, VInfo.Semi, i, VInfo.Parent};
     }
 
     // Step #1: Calculate the semidominators of all vertices.
+    SmallVector<unsigned, 32> EvalStack;
     for (unsigned i = NextDFSNum - 1; i >= 2; --i) {
-      NodePtr W = NumToNode[i];
-      auto &WInfo = NodeToInfo[W];
+      SemiNCANode &WInfo = Nodes[i];
 
       // Initialize the semi dominator to point to the parent node.
       WInfo.Semi = WInfo.Parent;
-      for (const auto &N : WInfo.ReverseChildren) {
-        if (NodeToInfo.count(N) == 0)  // Skip unreachable predecessors.
+      for (const auto &N : NumToInfo[i]->ReverseChildren) {
+        const auto NIt = NodeToInfo.find(N);
+        if (NIt == NodeToInfo.end())  // Skip unreachable predecessors.
           continue;
 
         const TreeNodePtr TN = DT.getNode(N);
@@ -318,7 +320,8 @@ struct SemiNCAInfo {
         if (TN && TN->getLevel() < MinLevel)
           continue;
 
-        unsigned SemiU = NodeToInfo[eval(N, i + 1)].Semi;
+        unsigned SemiU =
+            Nodes[eval(NIt->second.DFSNum, i + 1, Nodes, EvalStack)].Semi;
         if (SemiU < WInfo.Semi) WInfo.Semi = SemiU;
       }
     }
@@ -328,15 +331,23 @@ struct SemiNCAInfo {
     // Note that the parents were stored in IDoms and later got invalidated
     // during path compression in Eval.
     for (unsigned i = 2; i < NextDFSNum; ++i) {
-      const NodePtr W = NumToNode[i];
-      auto &WInfo = NodeToInfo[W];
-      const unsigned SDomNum = NodeToInfo[NumToNode[WInfo.Semi]].DFSNum;
-      NodePtr WIDomCandidate = WInfo.IDom;
-      while (NodeToInfo[WIDomCandidate].DFSNum > SDomNum)
-        WIDomCandidate = NodeToInfo[WIDomCandidate].IDom;
+      SemiNCANode &WInfo = Nodes[i];
+      unsigned WIDomCandidate = WInfo.IDom;
+      while (WIDomCandidate > WInfo.Semi)
+        WIDomCandidate = Nodes[WIDomCandidate].IDom;
 
       WInfo.IDom = WIDomCandidate;
     }
+
+    // Write the results back.
+    for (unsigned i = 1; i < NextDFSNum; ++i) {
+      InfoRec &VInfo = *NumToInfo[i];
+      const SemiNCANode &V = Nodes[i];
+      VInfo.Parent = V.Parent;
+      VInfo.Semi = V.Semi;
+      VInfo.Label = NumToNode[V.Label];
+      VInfo.IDom = NumToNode[V.IDom];
+    }
   }
 
   // PostDominatorTree always has a virtual root that represents a virtual CFG
@@ -556,8 +567,12 @@ struct SemiNCAInfo {
                                 // there's no point doing it incrementally.
 
     // Step #0: Number blocks in depth-first order and initialize variables used
-    // in later stages of the algorithm.
+    // in later stages of the algorithm. Size the maps up front: every node is
+    // going to be visited, and growing them on huge CFGs is costly.
     DT.Roots = FindRoots(DT, nullptr);
+    const size_t NumNodes = Parent->size() + IsPostDom;
+    SNCA.NodeToInfo.reserve(NumNodes);
+    SNCA.NumToNode.reserve(NumNodes + 1);
     SNCA.doFullDFSWalk(DT, AlwaysDescend);
 
     SNCA.runSemiNCA(DT);
@@ -0,0 +1,33 @@
+//===- CallChainClustering.h - Profile-guided function order ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass computes a function order for the linker from the profile, using
+// call-chain clustering.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_IPO_CALLCHAINCLUSTERING_H
+#define LLVM_TRANSFORMS_IPO_CALLCHAINCLUSTERING_H
+
+#include "llvm/IR/PassManager.h"
+
+namespace llvm {
+
+class Module;
+
+/// Pass to write a profile-guided symbol ordering file.
+class CallChainClusteringPass
+    : public PassInfoMixin<CallChainClusteringPass> {
+public:
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM);
+};
+
+} // end namespace llvm
+
+#endif // LLVM_TRANSFORMS_IPO_CALLCHAINCLUSTERING_H
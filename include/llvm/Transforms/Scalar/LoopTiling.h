@@ -0,0 +1,32 @@
+//===- LoopTiling.h - Loop Tiling Pass --------------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the Loop Tiling Pass, which strip-mines the loops of
+// perfect loop nests and runs the nest tile by tile, with tiles sized to fit
+// in the data cache.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_SCALAR_LOOPTILING_H
+#define LLVM_TRANSFORMS_SCALAR_LOOPTILING_H
+
+#include "llvm/IR/PassManager.h"
+
+namespace llvm {
+
+class Function;
+
+class LoopTilingPass : public PassInfoMixin<LoopTilingPass> {
+public:
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &AM);
+};
+
+} // end namespace llvm
+
+#endif // LLVM_TRANSFORMS_SCALAR_LOOPTILING_H
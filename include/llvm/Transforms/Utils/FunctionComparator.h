@@ -70,7 +70,13 @@ public:
   GlobalNumberState() = default;
 
   uint64_t getNumber(GlobalValue* Global) {
-    ValueNumberMap::iterator MapIter;
+    // Look the global up before inserting, so that numbering a global twice
+    // does not modify the map. Once every global has been numbered, the
+    // comparisons can run concurrently.
+    ValueNumberMap::iterator MapIter = GlobalNumbers.find(Global);
+    if (MapIter != GlobalNumbers.end())
+      return MapIter->second;
+
     bool Inserted;
     std::tie(MapIter, Inserted) = GlobalNumbers.insert({Global, NextNumber});
     if (Inserted)
@@ -100,6 +100,10 @@ struct LoopVectorizePass : public PassInfoMixin<LoopVectorizePass> {
                OptimizationRemarkEmitter &ORE);
 
   bool processLoop(Loop *L);
+
+  /// Vectorize the remainder loop \p L of a loop that was just vectorized
+  /// with \p MainVF and \p MainIC, at a narrower VF.
+  bool vectorizeEpilogue(Loop *L, unsigned MainVF, unsigned MainIC);
 };
 
 } // end namespace llvm
@@ -72,6 +72,9 @@ struct SLPVectorizerPass : public PassInfoMixin<SLPVectorizerPass> {
   DemandedBits *DB = nullptr;
   const DataLayout *DL = nullptr;
 
+  /// True if the last run changed the CFG.
+  bool CFGChanged = false;
+
 public:
   PreservedAnalyses run(Function &F, FunctionAnalysisManager &AM);
 
@@ -82,6 +85,13 @@ public:
                OptimizationRemarkEmitter *ORE_);
 
 private:
+  /// \brief Speculate the arms of small if-then-else diamonds and if-then
+  /// triangles into their head block, replacing the phis that join them with
+  /// selects and merging the join block into the head. This exposes
+  /// reductions split by if-converted control flow to the vectorizer.
+  /// \returns true if the CFG was changed.
+  bool speculateDiamonds(Function &F);
+
   /// \brief Collect store and getelementptr instructions and organize them
   /// according to the underlying object of their pointer operands. We sort the
   /// instructions by their underlying objects to reduce the cost of
@@ -44,6 +44,7 @@
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/Operator.h"
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Value.h"
 #include "llvm/Pass.h"
@@ -109,6 +110,78 @@ AliasResult AAResults::alias(const MemoryLocation &LocA,
   return MayAlias;
 }
 
+std::vector<std::unique_ptr<AABatchState>> AAResults::createBatchStates() {
+  std::vector<std::unique_ptr<AABatchState>> States;
+  States.reserve(AAs.size());
+  for (const auto &AA : AAs)
+    States.push_back(AA->createBatchState());
+  return States;
+}
+
+std::vector<std::unique_ptr<AABatchState>> *AAResults::setBatchStates(
+    std::vector<std::unique_ptr<AABatchState>> *States) {
+  assert((!States || States->size() == AAs.size()) &&
+         "Batch states created for a different set of analyses!");
+  for (unsigned I = 0, E = AAs.size(); I != E; ++I)
+    AAs[I]->setBatchState(States ? (*States)[I].get() : nullptr);
+  std::swap(BatchStates, States);
+  return States;
+}
+
+AliasResult BatchAAResults::alias(const MemoryLocation &LocA,
+                                  const MemoryLocation &LocB) {
+  auto Pair = AliasCache.insert({LocPair(LocA, LocB), MayAlias});
+  if (!Pair.second)
+    return Pair.first->second;
+
+  // The query can't modify AliasCache, so the iterator stays valid.
+  AliasResult Result = query([&] { return AA.alias(LocA, LocB); });
+  Pair.first->second = Result;
+  return Result;
+}
+
+/// Strip the casts and GEPs off \p V, to group the queries whose GEP chains
+/// share their decomposition. The walk is bounded like GetUnderlyingObject's.
+static const Value *getBatchGroupBase(const Value *V) {
+  V = V->stripPointerCasts();
+  for (unsigned Count = 0; Count != 6; ++Count) {
+    const auto *GEP = dyn_cast<GEPOperator>(V);
+    if (!GEP)
+      break;
+    V = GEP->getPointerOperand()->stripPointerCasts();
+  }
+  return V;
+}
+
+void BatchAAResults::alias(ArrayRef<LocPair> Pairs,
+                           SmallVectorImpl<AliasResult> &Results) {
+  // Number the groups in the order they are first seen, so that the queries
+  // run in a deterministic order.
+  using BasePair = std::pair<const Value *, const Value *>;
+  SmallDenseMap<BasePair, unsigned, 8> GroupIDs;
+  SmallVector<std::pair<unsigned, unsigned>, 16> Order;
+  Order.reserve(Pairs.size());
+  for (unsigned I = 0, E = Pairs.size(); I != E; ++I) {
+    BasePair Bases(getBatchGroupBase(Pairs[I].first.Ptr),
+                   getBatchGroupBase(Pairs[I].second.Ptr));
+    unsigned ID = GroupIDs.insert({Bases, GroupIDs.size()}).first->second;
+    Order.push_back({ID, I});
+  }
+  std::stable_sort(Order.begin(), Order.end(), llvm::less_first());
+
+  unsigned Start = Results.size();
+  Results.resize(Start + Pairs.size(), MayAlias);
+  for (const auto &GroupAndIndex : Order) {
+    const LocPair &Locs = Pairs[GroupAndIndex.second];
+    Results[Start + GroupAndIndex.second] = alias(Locs.first, Locs.second);
+  }
+}
+
+void BatchAAResults::clear() {
+  AliasCache.clear();
+  States = AA.createBatchStates();
+}
+
 bool AAResults::pointsToConstantMemory(const MemoryLocation &Loc,
                                        bool OrLocal) {
   for (const auto &AA : AAs)
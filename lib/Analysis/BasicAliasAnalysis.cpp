@@ -1164,6 +1164,31 @@ bool BasicAAResult::isGEPBaseAtNegativeOffset(const GEPOperator *GEPOp,
   return (GEPBaseOffset >= ObjectBaseOffset + (int64_t)ObjectAccessSize);
 }
 
+std::unique_ptr<AABatchState> BasicAAResult::createBatchState() {
+  return llvm::make_unique<BatchState>();
+}
+
+void BasicAAResult::setBatchState(AABatchState *State) {
+  CurBatch = static_cast<BatchState *>(State);
+}
+
+bool BasicAAResult::getDecomposedGEP(const Value *V,
+                                     DecomposedGEP &Decomposed) {
+  if (!CurBatch)
+    return DecomposeGEPExpression(V, Decomposed, DL, &AC, DT);
+
+  auto &Cache = CurBatch->DecomposedGEPs;
+  auto I = Cache.find(V);
+  if (I == Cache.end()) {
+    DecomposedGEP NewDecomposed;
+    bool MaxLookupReached =
+        DecomposeGEPExpression(V, NewDecomposed, DL, &AC, DT);
+    I = Cache.insert({V, {std::move(NewDecomposed), MaxLookupReached}}).first;
+  }
+  Decomposed = I->second.first;
+  return I->second.second;
+}
+
 /// Provides a bunch of ad-hoc rules to disambiguate a GEP instruction against
 /// another pointer.
 ///
@@ -1176,10 +1201,8 @@ AliasResult BasicAAResult::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
                                     const Value *UnderlyingV1,
                                     const Value *UnderlyingV2) {
   DecomposedGEP DecompGEP1, DecompGEP2;
-  bool GEP1MaxLookupReached =
-    DecomposeGEPExpression(GEP1, DecompGEP1, DL, &AC, DT);
-  bool GEP2MaxLookupReached =
-    DecomposeGEPExpression(V2, DecompGEP2, DL, &AC, DT);
+  bool GEP1MaxLookupReached = getDecomposedGEP(GEP1, DecompGEP1);
+  bool GEP2MaxLookupReached = getDecomposedGEP(V2, DecompGEP2);
 
   int64_t GEP1BaseOffset = DecompGEP1.StructOffset + DecompGEP1.OtherOffset;
   int64_t GEP2BaseOffset = DecompGEP2.StructOffset + DecompGEP2.OtherOffset;
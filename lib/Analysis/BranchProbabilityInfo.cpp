@@ -16,7 +16,9 @@
 #include "llvm/ADT/SCCIterator.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/PersistedAnalyses.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/IR/Attributes.h"
 #include "llvm/IR/BasicBlock.h"
@@ -54,6 +56,21 @@ cl::opt<std::string> PrintBranchProbFuncName(
     cl::desc("The option to specify the name of the function "
              "whose branch probability info is printed."));
 
+static cl::opt<bool> UsePersistedBranchProb(
+    "use-persisted-bpi", cl::init(true), cl::Hidden,
+    cl::desc("Load branch probabilities persisted in the IR when they are "
+             "still valid for the function."));
+
+STATISTIC(NumPersistedLoaded, "Number of functions with persisted branch "
+                              "probabilities loaded");
+
+// Name of the function metadata holding persisted branch probabilities, and
+// the version of its layout: !{i32 Version, i64 Hash, i32 Numerators...}, with
+// one numerator per successor of every block with at least two successors,
+// in function order.
+static const char PersistedBPIMDName[] = "persisted.bpi";
+static const unsigned PersistedBPIVersion = 1;
+
 INITIALIZE_PASS_BEGIN(BranchProbabilityInfoWrapperPass, "branch-prob",
                       "Branch Probability Analysis", false, true)
 INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
@@ -884,7 +901,91 @@ void BranchProbabilityInfoWrapperPass::getAnalysisUsage(
   AU.setPreservesAll();
 }
 
+void BranchProbabilityInfo::persist(Function &F) const {
+  LLVMContext &Ctx = F.getContext();
+  Type *Int32Ty = Type::getInt32Ty(Ctx);
+  SmallVector<Metadata *, 32> Ops;
+  Ops.push_back(ConstantAsMetadata::get(
+      ConstantInt::get(Int32Ty, PersistedBPIVersion)));
+  Ops.push_back(ConstantAsMetadata::get(ConstantInt::get(
+      Type::getInt64Ty(Ctx), computeFunctionContentHash(F))));
+  for (const BasicBlock &BB : F) {
+    const TerminatorInst *TI = BB.getTerminator();
+    if (!TI || TI->getNumSuccessors() < 2)
+      continue;
+    for (unsigned I = 0, E = TI->getNumSuccessors(); I != E; ++I)
+      Ops.push_back(ConstantAsMetadata::get(ConstantInt::get(
+          Int32Ty, getEdgeProbability(&BB, I).getNumerator())));
+  }
+  F.setMetadata(PersistedBPIMDName, MDTuple::get(Ctx, Ops));
+}
+
+/// Return the persisted branch probabilities attached to \p F, if any. The
+/// kind is looked up without registering it: getMetadata(StringRef) would add
+/// it to the context, and to every module written from that context.
+static MDNode *getPersistedBPIMetadata(const Function &F) {
+  if (!F.hasMetadata())
+    return nullptr;
+  SmallVector<StringRef, 32> Names;
+  F.getContext().getMDKindNames(Names);
+  auto I = find(Names, StringRef(PersistedBPIMDName));
+  if (I == Names.end())
+    return nullptr;
+  return F.getMetadata(I - Names.begin());
+}
+
+bool BranchProbabilityInfo::loadPersisted(const Function &F) {
+  if (!UsePersistedBranchProb)
+    return false;
+  MDNode *MD = getPersistedBPIMetadata(F);
+  if (!MD || MD->getNumOperands() < 2)
+    return false;
+  auto *Version = mdconst::dyn_extract<ConstantInt>(MD->getOperand(0));
+  auto *Hash = mdconst::dyn_extract<ConstantInt>(MD->getOperand(1));
+  if (!Version || Version->getZExtValue() != PersistedBPIVersion || !Hash ||
+      Hash->getZExtValue() != computeFunctionContentHash(F))
+    return false;
+
+  // Validate everything before touching the current state.
+  SmallVector<std::pair<const BasicBlock *, BranchProbability>, 32> Edges;
+  unsigned OpNo = 2;
+  for (const BasicBlock &BB : F) {
+    const TerminatorInst *TI = BB.getTerminator();
+    if (!TI || TI->getNumSuccessors() < 2)
+      continue;
+    uint64_t Sum = 0;
+    for (unsigned I = 0, E = TI->getNumSuccessors(); I != E; ++I) {
+      if (OpNo == MD->getNumOperands())
+        return false;
+      auto *N = mdconst::dyn_extract<ConstantInt>(MD->getOperand(OpNo++));
+      if (!N || N->getZExtValue() > BranchProbability::getDenominator())
+        return false;
+      Sum += N->getZExtValue();
+      Edges.push_back(
+          {&BB, BranchProbability::getRaw((uint32_t)N->getZExtValue())});
+    }
+    if (Sum > BranchProbability::getDenominator() + TI->getNumSuccessors())
+      return false;
+  }
+  if (OpNo != MD->getNumOperands())
+    return false;
+
+  DEBUG(dbgs() << "---- Branch Probability Info : " << F.getName()
+               << " (persisted) ----\n\n");
+  LastF = &F; // Store the last function we ran on for printing.
+  unsigned Index = 0;
+  for (unsigned I = 0, E = Edges.size(); I != E; ++I) {
+    if (I && Edges[I].first != Edges[I - 1].first)
+      Index = 0;
+    setEdgeProbability(Edges[I].first, Index++, Edges[I].second);
+  }
+  ++NumPersistedLoaded;
+  return true;
+}
+
 bool BranchProbabilityInfoWrapperPass::runOnFunction(Function &F) {
+  if (BPI.loadPersisted(F))
+    return false;
   const LoopInfo &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
   const TargetLibraryInfo &TLI = getAnalysis<TargetLibraryInfoWrapperPass>().getTLI();
   BPI.calculate(F, LI, &TLI);
@@ -902,6 +1003,8 @@ AnalysisKey BranchProbabilityAnalysis::Key;
 BranchProbabilityInfo
 BranchProbabilityAnalysis::run(Function &F, FunctionAnalysisManager &AM) {
   BranchProbabilityInfo BPI;
+  if (BPI.loadPersisted(F))
+    return BPI;
   BPI.calculate(F, AM.getResult<LoopAnalysis>(F), &AM.getResult<TargetLibraryAnalysis>(F));
   return BPI;
 }
@@ -467,6 +467,18 @@ namespace {
     /// PredBB to OldSucc has been threaded to be from PredBB to NewSucc.
     void threadEdge(BasicBlock *PredBB,BasicBlock *OldSucc,BasicBlock *NewSucc);
 
+    /// This is the update interface to inform the cache that the edge from
+    /// PredBB to Succ has been removed.
+    void eraseEdge(BasicBlock *PredBB, BasicBlock *Succ) {
+      // Removing an edge can only refine the values in Succ and below, so the
+      // cached results stay correct. Flush the overdefined ones, as threading
+      // an edge away from Succ does, so they can be refined.
+      TheCache.threadEdgeImpl(Succ, nullptr);
+    }
+
+    /// Set the optional DT pointer.
+    void setDT(DominatorTree *NewDT) { DT = NewDT; }
+
     LazyValueInfoImpl(AssumptionCache *AC, const DataLayout &DL,
                        DominatorTree *DT = nullptr)
         : AC(AC), DL(DL), DT(DT) {}
@@ -1784,6 +1796,19 @@ void LazyValueInfo::eraseBlock(BasicBlock *BB) {
   }
 }
 
+void LazyValueInfo::eraseEdge(BasicBlock *PredBB, BasicBlock *Succ) {
+  if (PImpl) {
+    const DataLayout &DL = PredBB->getModule()->getDataLayout();
+    getImpl(PImpl, AC, &DL, DT).eraseEdge(PredBB, Succ);
+  }
+}
+
+void LazyValueInfo::setDominatorTree(DominatorTree *NewDT) {
+  DT = NewDT;
+  if (PImpl)
+    static_cast<LazyValueInfoImpl *>(PImpl)->setDT(NewDT);
+}
+
 
 void LazyValueInfo::printLVI(Function &F, DominatorTree &DTree, raw_ostream &OS) {
   if (PImpl) {
@@ -23,6 +23,7 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/iterator_range.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/AliasSetTracker.h"
@@ -71,6 +72,10 @@ using namespace llvm;
 
 #define DEBUG_TYPE "loop-accesses"
 
+STATISTIC(NumStoppedBelowMinUsefulVF,
+          "Number of loops whose dependence analysis stopped because the "
+          "maximum safe VF was too small");
+
 static cl::opt<unsigned, true>
 VectorizationFactor("force-vector-width", cl::Hidden,
                     cl::desc("Sets the SIMD width. Zero is autoselect."),
@@ -1545,6 +1550,7 @@ MemoryDepChecker::isDependent(const MemAccessInfo &A, unsigned AIdx,
                << " with max VF = " << MaxVF << '\n');
   uint64_t MaxVFInBits = MaxVF * TypeByteSize * 8;
   MaxSafeRegisterWidth = std::min(MaxSafeRegisterWidth, MaxVFInBits);
+  MaxSafeVF = std::min(MaxSafeVF, MaxVF);
   return Dependence::BackwardVectorizable;
 }
 
@@ -1553,6 +1559,7 @@ bool MemoryDepChecker::areDepsSafe(DepCandidates &AccessSets,
                                    const ValueToValueMap &Strides) {
 
   MaxSafeDepDistBytes = -1;
+  MaxSafeVF = -1;
   SmallPtrSet<MemAccessInfo, 8> Visited;
   for (MemAccessInfo CurAccess : CheckDeps) {
     if (Visited.count(CurAccess))
@@ -1603,7 +1610,26 @@ bool MemoryDepChecker::areDepsSafe(DepCandidates &AccessSets,
                 DEBUG(dbgs() << "Too many dependences, stopped recording\n");
               }
             }
-            if (!RecordDependences && !SafeForVectorization)
+
+            // The remaining pairs can only restrict the vectorization factor
+            // further, so the loop is no longer worth vectorizing as is. A
+            // dependence with an unknown distance would still let
+            // analyzeLoop retry with runtime checks, which ignore the
+            // dependences, so keep looking for one of those only.
+            if (MinUsefulVF > 1 && MaxSafeVF < MinUsefulVF &&
+                !StoppedBelowMinUsefulVF) {
+              DEBUG(dbgs() << "LAA: Stopped analyzing dependences, max VF = "
+                           << MaxSafeVF << " is below the smallest useful VF "
+                           << MinUsefulVF << "\n");
+              ++NumStoppedBelowMinUsefulVF;
+              StoppedBelowMinUsefulVF = true;
+              SafeForVectorization = false;
+              RecordDependences = false;
+              Dependences.clear();
+            }
+
+            if (!RecordDependences && !SafeForVectorization &&
+                (!StoppedBelowMinUsefulVF || ShouldRetryWithRuntimeCheck))
               return false;
           }
         ++OI;
@@ -2187,10 +2213,12 @@ void LoopAccessInfo::collectStridedAccess(Value *MemAccess) {
 
 LoopAccessInfo::LoopAccessInfo(Loop *L, ScalarEvolution *SE,
                                const TargetLibraryInfo *TLI, AliasAnalysis *AA,
-                               DominatorTree *DT, LoopInfo *LI)
+                               DominatorTree *DT, LoopInfo *LI,
+                               unsigned MinUsefulVF)
     : PSE(llvm::make_unique<PredicatedScalarEvolution>(*SE, *L)),
       PtrRtChecking(llvm::make_unique<RuntimePointerChecking>(SE)),
-      DepChecker(llvm::make_unique<MemoryDepChecker>(*PSE, L)), TheLoop(L),
+      DepChecker(llvm::make_unique<MemoryDepChecker>(*PSE, L, MinUsefulVF)),
+      TheLoop(L),
       NumLoads(0), NumStores(0), MaxSafeDepDistBytes(-1), CanVecMem(false),
       StoreToLoopInvariantAddress(false) {
   if (canAnalyzeLoop())
@@ -2217,7 +2245,10 @@ void LoopAccessInfo::print(raw_ostream &OS, unsigned Depth) const {
       Dep.print(OS, Depth + 2, DepChecker->getMemoryInstructions());
       OS << "\n";
     }
-  } else
+  } else if (DepChecker->stoppedBelowMinUsefulVF())
+    OS.indent(Depth) << "Dependences below the smallest useful VF, not "
+                        "recorded\n";
+  else
     OS.indent(Depth) << "Too many dependences, not recorded\n";
 
   // List the pair of accesses need run-time checks to prove independence.
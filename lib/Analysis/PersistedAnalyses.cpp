@@ -0,0 +1,182 @@
+//===- PersistedAnalyses.cpp - Analyses persisted in the IR ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the content hash used to validate persisted analysis
+// results and the pass that persists them.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/PersistedAnalyses.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Analysis/BranchProbabilityInfo.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/MD5.h"
+
+using namespace llvm;
+
+namespace {
+
+/// Feeds the contents of a function into an MD5 hash. Local values are
+/// identified by their position in the function rather than by their name.
+class FunctionContentHasher {
+  MD5 Hash;
+  DenseMap<const Value *, uint64_t> LocalNumbers;
+
+  void hashInt(uint64_t V) {
+    uint8_t Bytes[sizeof(V)];
+    support::endian::write64le(Bytes, V);
+    Hash.update(Bytes);
+  }
+
+  void hashString(StringRef S) {
+    hashInt(S.size());
+    Hash.update(S);
+  }
+
+  void hashAPInt(const APInt &V) {
+    hashInt(V.getBitWidth());
+    for (unsigned I = 0, E = V.getNumWords(); I != E; ++I)
+      hashInt(V.getRawData()[I]);
+  }
+
+  void hashType(Type *Ty) {
+    hashInt(Ty->getTypeID());
+    if (auto *ITy = dyn_cast<IntegerType>(Ty))
+      hashInt(ITy->getBitWidth());
+    else if (auto *PTy = dyn_cast<PointerType>(Ty))
+      hashInt(PTy->getAddressSpace());
+    else if (auto *STy = dyn_cast<SequentialType>(Ty))
+      hashInt(STy->getNumElements());
+    else if (auto *STy = dyn_cast<StructType>(Ty))
+      hashInt(STy->getNumElements());
+  }
+
+  void hashConstant(const Constant *C);
+  void hashValue(const Value *V);
+  void hashMetadata(const MDNode *MD);
+
+public:
+  uint64_t hash(const Function &F);
+};
+
+} // end anonymous namespace
+
+void FunctionContentHasher::hashConstant(const Constant *C) {
+  hashInt(C->getValueID());
+  hashType(C->getType());
+  if (auto *CI = dyn_cast<ConstantInt>(C))
+    return hashAPInt(CI->getValue());
+  if (auto *CFP = dyn_cast<ConstantFP>(C))
+    return hashAPInt(CFP->getValueAPF().bitcastToAPInt());
+  if (auto *GV = dyn_cast<GlobalValue>(C))
+    return hashString(GV->getName());
+  if (auto *CDS = dyn_cast<ConstantDataSequential>(C))
+    return hashString(CDS->getRawDataValues());
+  if (auto *BA = dyn_cast<BlockAddress>(C))
+    return hashString(BA->getFunction()->getName());
+  if (auto *CE = dyn_cast<ConstantExpr>(C)) {
+    hashInt(CE->getOpcode());
+    if (CE->isCompare())
+      hashInt(CE->getPredicate());
+  }
+  for (const Use &Op : C->operands())
+    hashConstant(cast<Constant>(Op));
+}
+
+void FunctionContentHasher::hashValue(const Value *V) {
+  auto It = LocalNumbers.find(V);
+  if (It != LocalNumbers.end()) {
+    // Tag local values so that they cannot collide with a value ID.
+    hashInt(~0ULL);
+    hashInt(It->second);
+    return;
+  }
+  if (auto *C = dyn_cast<Constant>(V))
+    return hashConstant(C);
+  hashInt(V->getValueID());
+  if (auto *IA = dyn_cast<InlineAsm>(V))
+    hashString(IA->getAsmString());
+}
+
+void FunctionContentHasher::hashMetadata(const MDNode *MD) {
+  if (!MD) {
+    hashInt(0);
+    return;
+  }
+  hashInt(MD->getNumOperands());
+  for (const MDOperand &Op : MD->operands()) {
+    if (auto *S = dyn_cast_or_null<MDString>(Op))
+      hashString(S->getString());
+    else if (auto *CMD = dyn_cast_or_null<ConstantAsMetadata>(Op))
+      hashConstant(CMD->getValue());
+    else
+      hashInt(0);
+  }
+}
+
+uint64_t FunctionContentHasher::hash(const Function &F) {
+  if (const Module *M = F.getParent())
+    hashString(M->getTargetTriple());
+  hashType(F.getFunctionType());
+
+  // Number the local values up front; phis and branches refer to values and
+  // blocks that come later in the function.
+  uint64_t Next = 0;
+  for (const Argument &A : F.args())
+    LocalNumbers[&A] = Next++;
+  for (const BasicBlock &BB : F) {
+    LocalNumbers[&BB] = Next++;
+    for (const Instruction &I : BB)
+      LocalNumbers[&I] = Next++;
+  }
+
+  for (const BasicBlock &BB : F) {
+    hashInt(BB.size());
+    for (const Instruction &I : BB) {
+      hashInt(I.getOpcode());
+      hashType(I.getType());
+      hashInt(I.getNumOperands());
+      for (const Use &Op : I.operands())
+        hashValue(Op);
+      if (auto *Cmp = dyn_cast<CmpInst>(&I))
+        hashInt(Cmp->getPredicate());
+      if (auto *PN = dyn_cast<PHINode>(&I))
+        for (const BasicBlock *Pred : PN->blocks())
+          hashValue(Pred);
+      if (ImmutableCallSite CS = ImmutableCallSite(&I)) {
+        hashInt(CS.hasFnAttr(Attribute::Cold));
+        hashInt(CS.hasFnAttr(Attribute::NoReturn));
+      }
+      hashMetadata(I.getMetadata(LLVMContext::MD_prof));
+    }
+  }
+
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  return Result.low();
+}
+
+uint64_t llvm::computeFunctionContentHash(const Function &F) {
+  return FunctionContentHasher().hash(F);
+}
+
+PreservedAnalyses PersistAnalysesPass::run(Function &F,
+                                           FunctionAnalysisManager &AM) {
+  AM.getResult<BranchProbabilityAnalysis>(F).persist(F);
+  // Only metadata that no analysis looks at has changed.
+  return PreservedAnalyses::all();
+}
@@ -144,6 +144,12 @@ STATISTIC(NumTripCountsNotComputed,
           "Number of loops without predictable loop counts");
 STATISTIC(NumBruteForceTripCountsComputed,
           "Number of loops with trip counts computed by force");
+STATISTIC(NumBudgetExhausted,
+          "Number of functions where ScalarEvolution ran out of budget");
+STATISTIC(NumBudgetGiveUps,
+          "Number of queries given up because of the ScalarEvolution budget");
+STATISTIC(NumCacheEvictions,
+          "Number of ScalarEvolution caches evicted for reaching their limit");
 
 static cl::opt<unsigned>
 MaxBruteForceIterations("scalar-evolution-max-iterations", cl::ReallyHidden,
@@ -210,6 +216,19 @@ static cl::opt<bool> VersionUnknown(
     cl::desc("Use predicated scalar evolution to version SCEVUnknowns"),
     cl::init(false));
 
+static cl::opt<unsigned> ScalarEvolutionBudget(
+    "scalar-evolution-budget", cl::Hidden,
+    cl::desc("Maximum number of expressions, ranges, values at scope and "
+             "trip counts computed per function before giving up with "
+             "conservative answers (0 = unlimited)"),
+    cl::init(0));
+
+static cl::opt<unsigned> MaxSCEVCacheSize(
+    "scalar-evolution-max-cache-size", cl::Hidden,
+    cl::desc("Maximum number of expressions in each of the range, disposition "
+             "and value at scope caches (0 = unlimited)"),
+    cl::init(0));
+
 //===----------------------------------------------------------------------===//
 //                           SCEV class definitions
 //===----------------------------------------------------------------------===//
@@ -5348,6 +5367,30 @@ static Optional<ConstantRange> GetRangeFromMetadata(Value *V) {
   return None;
 }
 
+/// Evict the memoized results of \p Cache if it holds
+/// -scalar-evolution-max-cache-size expressions. These caches only hold results
+/// that can be computed again, so the limit bounds memory use at the price of
+/// compile time.
+template <typename CacheTy> static void limitCacheSize(CacheTy &Cache) {
+  if (!MaxSCEVCacheSize || Cache.size() < MaxSCEVCacheSize)
+    return;
+  Cache.clear();
+  ++NumCacheEvictions;
+}
+
+const ConstantRange &ScalarEvolution::setRange(const SCEV *S,
+                                               RangeSignHint Hint,
+                                               ConstantRange CR) {
+  DenseMap<const SCEV *, ConstantRange> &Cache =
+      Hint == HINT_RANGE_UNSIGNED ? UnsignedRanges : SignedRanges;
+  limitCacheSize(Cache);
+
+  auto Pair = Cache.try_emplace(S, std::move(CR));
+  if (!Pair.second)
+    Pair.first->second = std::move(CR);
+  return Pair.first->second;
+}
+
 /// Determine the range for a particular SCEV.  If SignHint is
 /// HINT_RANGE_UNSIGNED (resp. HINT_RANGE_SIGNED) then getRange prefers ranges
 /// with a "cleaner" unsigned (resp. signed) representation.
@@ -5369,6 +5412,9 @@ ScalarEvolution::getRangeRef(const SCEV *S,
   unsigned BitWidth = getTypeSizeInBits(S->getType());
   ConstantRange ConservativeResult(BitWidth, /*isFullSet=*/true);
 
+  if (!consumeBudget())
+    return setRange(S, SignHint, std::move(ConservativeResult));
+
   // If the value has known zeros, the maximum value will have those known zeros
   // as well.
   uint32_t TZ = GetMinTrailingZeros(S);
@@ -5905,6 +5951,19 @@ ScalarEvolution::getLoopProperties(const Loop *L) {
   return Itr->second;
 }
 
+bool ScalarEvolution::consumeBudget() {
+  if (!ScalarEvolutionBudget || BudgetUsed < ScalarEvolutionBudget) {
+    ++BudgetUsed;
+    return true;
+  }
+  if (!BudgetExhausted) {
+    BudgetExhausted = true;
+    ++NumBudgetExhausted;
+  }
+  ++NumBudgetGiveUps;
+  return false;
+}
+
 const SCEV *ScalarEvolution::createSCEV(Value *V) {
   if (!isSCEVable(V->getType()))
     return getUnknown(V);
@@ -5925,6 +5984,9 @@ const SCEV *ScalarEvolution::createSCEV(Value *V) {
   else if (!isa<ConstantExpr>(V))
     return getUnknown(V);
 
+  if (!consumeBudget())
+    return getUnknown(V);
+
   Operator *U = cast<Operator>(V);
   if (auto BO = MatchBinaryOp(U, DT)) {
     switch (BO->Opcode) {
@@ -6775,6 +6837,12 @@ void ScalarEvolution::BackedgeTakenInfo::clear() {
 ScalarEvolution::BackedgeTakenInfo
 ScalarEvolution::computeBackedgeTakenCount(const Loop *L,
                                            bool AllowPredicates) {
+  if (!consumeBudget()) {
+    SmallVector<BackedgeTakenInfo::EdgeExitInfo, 1> NoExitCounts;
+    return BackedgeTakenInfo(std::move(NoExitCounts), /*Complete=*/false,
+                             getCouldNotCompute(), /*MaxOrZero=*/false);
+  }
+
   SmallVector<BasicBlock *, 8> ExitingBlocks;
   L->getExitingBlocks(ExitingBlocks);
 
@@ -7772,6 +7840,21 @@ const SCEV *ScalarEvolution::computeExitCountExhaustively(const Loop *L,
 }
 
 const SCEV *ScalarEvolution::getSCEVAtScope(const SCEV *V, const Loop *L) {
+  // Evict the folded expressions, but not the ones still being computed, which
+  // guard against infinite recursion.
+  if (MaxSCEVCacheSize && ValuesAtScopes.size() >= MaxSCEVCacheSize) {
+    bool Evicted = false;
+    for (auto I = ValuesAtScopes.begin(), E = ValuesAtScopes.end(); I != E;
+         ++I)
+      if (all_of(I->second,
+                 [](const std::pair<const Loop *, const SCEV *> &LS) {
+                   return LS.second != nullptr;
+                 }))
+        Evicted |= ValuesAtScopes.erase(I->first);
+    if (Evicted)
+      ++NumCacheEvictions;
+  }
+
   SmallVector<std::pair<const Loop *, const SCEV *>, 2> &Values =
       ValuesAtScopes[V];
   // Check to see if we've folded this expression at this loop before.
@@ -7893,6 +7976,9 @@ static Constant *BuildConstantFromSCEV(const SCEV *V) {
 const SCEV *ScalarEvolution::computeSCEVAtScope(const SCEV *V, const Loop *L) {
   if (isa<SCEVConstant>(V)) return V;
 
+  if (!consumeBudget())
+    return V;
+
   // If this instruction is evolved from a constant-evolving PHI, compute the
   // exit value from the loop without using SCEVs.
   if (const SCEVUnknown *SU = dyn_cast<SCEVUnknown>(V)) {
@@ -10724,8 +10810,9 @@ ScalarEvolution::ScalarEvolution(Function &F, TargetLibraryInfo &TLI,
 }
 
 ScalarEvolution::ScalarEvolution(ScalarEvolution &&Arg)
-    : F(Arg.F), HasGuards(Arg.HasGuards), TLI(Arg.TLI), AC(Arg.AC), DT(Arg.DT),
-      LI(Arg.LI), CouldNotCompute(std::move(Arg.CouldNotCompute)),
+    : F(Arg.F), HasGuards(Arg.HasGuards), BudgetUsed(Arg.BudgetUsed),
+      BudgetExhausted(Arg.BudgetExhausted), TLI(Arg.TLI), AC(Arg.AC),
+      DT(Arg.DT), LI(Arg.LI), CouldNotCompute(std::move(Arg.CouldNotCompute)),
       ValueExprMap(std::move(Arg.ValueExprMap)),
       PendingLoopPredicates(std::move(Arg.PendingLoopPredicates)),
       MinTrailingZerosCache(std::move(Arg.MinTrailingZerosCache)),
@@ -10939,6 +11026,7 @@ void ScalarEvolution::print(raw_ostream &OS) const {
 
 ScalarEvolution::LoopDisposition
 ScalarEvolution::getLoopDisposition(const SCEV *S, const Loop *L) {
+  limitCacheSize(LoopDispositions);
   auto &Values = LoopDispositions[S];
   for (auto &V : Values) {
     if (V.getPointer() == L)
@@ -11044,6 +11132,7 @@ bool ScalarEvolution::hasComputableLoopEvolution(const SCEV *S, const Loop *L) {
 
 ScalarEvolution::BlockDisposition
 ScalarEvolution::getBlockDisposition(const SCEV *S, const BasicBlock *BB) {
+  limitCacheSize(BlockDispositions);
   auto &Values = BlockDispositions[S];
   for (auto &V : Values) {
     if (V.getPointer() == BB)
@@ -22,11 +22,13 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/iterator_range.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/AssumptionCache.h"
 #include "llvm/Analysis/InstructionSimplify.h"
+#include "llvm/Analysis/KnownBitsCache.h"
 #include "llvm/Analysis/Loads.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/OptimizationRemarkEmitter.h"
@@ -76,6 +78,17 @@
 using namespace llvm;
 using namespace llvm::PatternMatch;
 
+#define DEBUG_TYPE "value-tracking"
+
+STATISTIC(NumKnownBitsCacheHits, "Number of known bits queries answered "
+                                 "from the cache");
+STATISTIC(NumKnownBitsCacheMisses, "Number of known bits queries missing "
+                                   "the cache");
+STATISTIC(NumSignBitsCacheHits, "Number of sign bits queries answered from "
+                                "the cache");
+STATISTIC(NumSignBitsCacheMisses, "Number of sign bits queries missing the "
+                                  "cache");
+
 const unsigned MaxDepth = 6;
 
 // Controls the number of uses of the value searched for possible
@@ -108,6 +121,9 @@ struct Query {
   // provide it currently.
   OptimizationRemarkEmitter *ORE;
 
+  /// Optional cache of the results of previous queries.
+  KnownBitsCache *Cache;
+
   /// Set of assumptions that should be excluded from further queries.
   /// This is because of the potential for mutual recursion to cause
   /// computeKnownBits to repeatedly visit the same assume intrinsic. The
@@ -121,11 +137,12 @@ struct Query {
   unsigned NumExcluded = 0;
 
   Query(const DataLayout &DL, AssumptionCache *AC, const Instruction *CxtI,
-        const DominatorTree *DT, OptimizationRemarkEmitter *ORE = nullptr)
-      : DL(DL), AC(AC), CxtI(CxtI), DT(DT), ORE(ORE) {}
+        const DominatorTree *DT, OptimizationRemarkEmitter *ORE = nullptr,
+        KnownBitsCache *Cache = nullptr)
+      : DL(DL), AC(AC), CxtI(CxtI), DT(DT), ORE(ORE), Cache(Cache) {}
 
   Query(const Query &Q, const Value *NewExcl)
-      : DL(Q.DL), AC(Q.AC), CxtI(Q.CxtI), DT(Q.DT), ORE(Q.ORE),
+      : DL(Q.DL), AC(Q.AC), CxtI(Q.CxtI), DT(Q.DT), ORE(Q.ORE), Cache(Q.Cache),
         NumExcluded(Q.NumExcluded) {
     Excluded = Q.Excluded;
     Excluded[NumExcluded++] = NewExcl;
@@ -138,6 +155,15 @@ struct Query {
     auto End = Excluded.begin() + NumExcluded;
     return std::find(Excluded.begin(), End, Value) != End;
   }
+
+  /// Return the cache to use for a query on \p V, if any. Constants are
+  /// cheaper to analyze than to look up, and queries excluding assumptions
+  /// may give weaker results than the ones recorded in the cache.
+  KnownBitsCache *getCacheFor(const Value *V) const {
+    if (!Cache || NumExcluded || isa<Constant>(V))
+      return nullptr;
+    return Cache;
+  }
 };
 
 } // end anonymous namespace
@@ -165,9 +191,12 @@ void llvm::computeKnownBits(const Value *V, KnownBits &Known,
                             const DataLayout &DL, unsigned Depth,
                             AssumptionCache *AC, const Instruction *CxtI,
                             const DominatorTree *DT,
-                            OptimizationRemarkEmitter *ORE) {
+                            OptimizationRemarkEmitter *ORE,
+                            KnownBitsCache *Cache) {
+  if (Cache)
+    Cache->clear();
   ::computeKnownBits(V, Known, Depth,
-                     Query(DL, AC, safeCxtI(V, CxtI), DT, ORE));
+                     Query(DL, AC, safeCxtI(V, CxtI), DT, ORE, Cache));
 }
 
 static KnownBits computeKnownBits(const Value *V, unsigned Depth,
@@ -177,9 +206,12 @@ KnownBits llvm::computeKnownBits(const Value *V, const DataLayout &DL,
                                  unsigned Depth, AssumptionCache *AC,
                                  const Instruction *CxtI,
                                  const DominatorTree *DT,
-                                 OptimizationRemarkEmitter *ORE) {
+                                 OptimizationRemarkEmitter *ORE,
+                                 KnownBitsCache *Cache) {
+  if (Cache)
+    Cache->clear();
   return ::computeKnownBits(V, Depth,
-                            Query(DL, AC, safeCxtI(V, CxtI), DT, ORE));
+                            Query(DL, AC, safeCxtI(V, CxtI), DT, ORE, Cache));
 }
 
 bool llvm::haveNoCommonBitsSet(const Value *LHS, const Value *RHS,
@@ -274,9 +306,13 @@ static bool MaskedValueIsZero(const Value *V, const APInt &Mask, unsigned Depth,
 bool llvm::MaskedValueIsZero(const Value *V, const APInt &Mask,
                              const DataLayout &DL,
                              unsigned Depth, AssumptionCache *AC,
-                             const Instruction *CxtI, const DominatorTree *DT) {
+                             const Instruction *CxtI, const DominatorTree *DT,
+                             KnownBitsCache *Cache) {
+  if (Cache)
+    Cache->clear();
   return ::MaskedValueIsZero(V, Mask, Depth,
-                             Query(DL, AC, safeCxtI(V, CxtI), DT));
+                             Query(DL, AC, safeCxtI(V, CxtI), DT,
+                                   /*ORE=*/nullptr, Cache));
 }
 
 static unsigned ComputeNumSignBits(const Value *V, unsigned Depth,
@@ -285,8 +321,13 @@ static unsigned ComputeNumSignBits(const Value *V, unsigned Depth,
 unsigned llvm::ComputeNumSignBits(const Value *V, const DataLayout &DL,
                                   unsigned Depth, AssumptionCache *AC,
                                   const Instruction *CxtI,
-                                  const DominatorTree *DT) {
-  return ::ComputeNumSignBits(V, Depth, Query(DL, AC, safeCxtI(V, CxtI), DT));
+                                  const DominatorTree *DT,
+                                  KnownBitsCache *Cache) {
+  if (Cache)
+    Cache->clear();
+  return ::ComputeNumSignBits(V, Depth,
+                              Query(DL, AC, safeCxtI(V, CxtI), DT,
+                                    /*ORE=*/nullptr, Cache));
 }
 
 static void computeKnownBitsAddSub(bool Add, const Value *Op0, const Value *Op1,
@@ -1538,8 +1579,8 @@ KnownBits computeKnownBits(const Value *V, unsigned Depth, const Query &Q) {
 /// where V is a vector, known zero, and known one values are the
 /// same width as the vector element, and the bit is set only if it is true
 /// for all of the elements in the vector.
-void computeKnownBits(const Value *V, KnownBits &Known, unsigned Depth,
-                      const Query &Q) {
+static void computeKnownBitsImpl(const Value *V, KnownBits &Known,
+                                 unsigned Depth, const Query &Q) {
   assert(V && "No Value?");
   assert(Depth <= MaxDepth && "Limit Search Depth");
   unsigned BitWidth = Known.getBitWidth();
@@ -1638,6 +1679,45 @@ void computeKnownBits(const Value *V, KnownBits &Known, unsigned Depth,
   assert((Known.Zero & Known.One) == 0 && "Bits known to be one AND zero?");
 }
 
+void computeKnownBits(const Value *V, KnownBits &Known, unsigned Depth,
+                      const Query &Q) {
+  KnownBitsCache *Cache = Q.getCacheFor(V);
+  KnownBitsCache::KeyTy Key(V, {Q.CxtI, Depth});
+  if (Cache) {
+    if (const KnownBits *Cached = Cache->lookupKnownBits(Key)) {
+      ++NumKnownBitsCacheHits;
+      Known = *Cached;
+      return;
+    }
+    ++NumKnownBitsCacheMisses;
+  }
+
+  computeKnownBitsImpl(V, Known, Depth, Q);
+  if (Cache)
+    Cache->insertKnownBits(Key, Known);
+}
+
+const KnownBits *
+KnownBitsCache::lookupKnownBits(const KeyTy &Key) const {
+  auto It = KnownBitsResults.find(Key);
+  return It == KnownBitsResults.end() ? nullptr : &It->second;
+}
+
+void KnownBitsCache::insertKnownBits(const KeyTy &Key,
+                                     const KnownBits &Known) {
+  KnownBitsResults.insert({Key, Known});
+}
+
+const unsigned *KnownBitsCache::lookupNumSignBits(const KeyTy &Key) const {
+  auto It = NumSignBitsResults.find(Key);
+  return It == NumSignBitsResults.end() ? nullptr : &It->second;
+}
+
+void KnownBitsCache::insertNumSignBits(const KeyTy &Key,
+                                       unsigned NumSignBits) {
+  NumSignBitsResults.insert({Key, NumSignBits});
+}
+
 /// Return true if the given value is known to have exactly one
 /// bit set when defined. For vectors return true if every element is known to
 /// be a power of two when defined. Supports values with integer or pointer
@@ -2170,8 +2250,20 @@ static unsigned ComputeNumSignBitsImpl(const Value *V, unsigned Depth,
 
 static unsigned ComputeNumSignBits(const Value *V, unsigned Depth,
                                    const Query &Q) {
+  KnownBitsCache *Cache = Q.getCacheFor(V);
+  KnownBitsCache::KeyTy Key(V, {Q.CxtI, Depth});
+  if (Cache) {
+    if (const unsigned *Cached = Cache->lookupNumSignBits(Key)) {
+      ++NumSignBitsCacheHits;
+      return *Cached;
+    }
+    ++NumSignBitsCacheMisses;
+  }
+
   unsigned Result = ComputeNumSignBitsImpl(V, Depth, Q);
   assert(Result > 0 && "At least one sign bit needs to be present!");
+  if (Cache)
+    Cache->insertNumSignBits(Key, Result);
   return Result;
 }
 
@@ -530,6 +530,7 @@ public:
 
   Error materialize(GlobalValue *GV) override;
   Error materializeModule() override;
+  void dematerialize(GlobalValue *GV) override;
   std::vector<StructType *> getIdentifiedStructTypes() const override;
 
   /// \brief Main interface to parsing a bitcode buffer.
@@ -4708,6 +4709,10 @@ Error BitcodeReader::materialize(GlobalValue *GV) {
   if (DISubprogram *SP = MDLoader->lookupSubprogramForFunction(F))
     F->setSubprogram(SP);
 
+  // Load the subprogram variables that were deferred until the function body
+  // is needed.
+  MDLoader->loadDeferredSubprogramVariables(*F);
+
   // Check if the TBAA Metadata are valid, otherwise we will need to strip them.
   if (!MDLoader->isStrippingTBAA()) {
     for (auto &I : instructions(F)) {
@@ -4724,6 +4729,25 @@ Error BitcodeReader::materialize(GlobalValue *GV) {
   return materializeForwardReferencedFunctions();
 }
 
+void BitcodeReader::dematerialize(GlobalValue *GV) {
+  Function *F = dyn_cast<Function>(GV);
+  // Only a body read from the stream can be read again, and a blockaddress
+  // may still refer to the blocks of the current one.
+  if (!F || F->isMaterializable() || !DeferredFunctionInfo.count(F) ||
+      llvm::any_of(*F, [](BasicBlock &BB) { return BB.hasAddressTaken(); }))
+    return;
+
+  // Drop the blocks and the metadata attachments, which are parsed again
+  // with the body. The linkage, personality, prefix and prologue come from
+  // the module block and must survive.
+  for (BasicBlock &BB : *F)
+    BB.dropAllReferences();
+  while (!F->empty())
+    F->begin()->eraseFromParent();
+  F->clearMetadata();
+  F->setIsMaterializable(true);
+}
+
 Error BitcodeReader::materializeModule() {
   if (Error Err = materializeMetadata())
     return Err;
@@ -5095,6 +5119,7 @@ Error ModuleSummaryIndexBitcodeReader::parseEntireSummary(unsigned ID) {
       PendingTypeCheckedLoadVCalls;
   std::vector<FunctionSummary::ConstVCall> PendingTypeTestAssumeConstVCalls,
       PendingTypeCheckedLoadConstVCalls;
+  ModuleHash PendingContentHash = {{0}};
 
   while (true) {
     BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
@@ -5175,6 +5200,8 @@ Error ModuleSummaryIndexBitcodeReader::parseEntireSummary(unsigned ID) {
       PendingTypeCheckedLoadVCalls.clear();
       PendingTypeTestAssumeConstVCalls.clear();
       PendingTypeCheckedLoadConstVCalls.clear();
+      FS->setContentHash(PendingContentHash);
+      PendingContentHash = {{0}};
       auto VIAndOriginalGUID = getValueInfoFromValueId(ValueID);
       FS->setModulePath(addThisModule()->first());
       FS->setOriginalName(VIAndOriginalGUID.second);
@@ -5268,6 +5295,8 @@ Error ModuleSummaryIndexBitcodeReader::parseEntireSummary(unsigned ID) {
       PendingTypeCheckedLoadVCalls.clear();
       PendingTypeTestAssumeConstVCalls.clear();
       PendingTypeCheckedLoadConstVCalls.clear();
+      FS->setContentHash(PendingContentHash);
+      PendingContentHash = {{0}};
       LastSeenSummary = FS.get();
       LastSeenGUID = VI.getGUID();
       FS->setModulePath(ModuleIdMap[ModuleId]);
@@ -5355,6 +5384,14 @@ Error ModuleSummaryIndexBitcodeReader::parseEntireSummary(unsigned ID) {
           {{Record[0], Record[1]}, {Record.begin() + 2, Record.end()}});
       break;
 
+    case bitc::FS_CONTENT_HASH: { // [5*i32]
+      if (Record.size() != 5)
+        return error("Invalid hash length " + Twine(Record.size()).str());
+      for (unsigned I = 0; I != 5; ++I)
+        PendingContentHash[I] = Record[I];
+      break;
+    }
+
     case bitc::FS_CFI_FUNCTION_DEFS: {
       std::set<std::string> &CfiFunctionDefs = TheIndex.cfiFunctionDefs();
       for (unsigned I = 0; I != Record.size(); I += 2)
@@ -90,6 +90,10 @@ using namespace llvm;
 STATISTIC(NumMDStringLoaded, "Number of MDStrings loaded");
 STATISTIC(NumMDNodeTemporary, "Number of MDNode::Temporary created");
 STATISTIC(NumMDRecordLoaded, "Number of Metadata records loaded");
+STATISTIC(NumSPVariablesDeferred,
+          "Number of DISubprogram variable lists deferred");
+STATISTIC(NumSPVariablesLoaded,
+          "Number of deferred DISubprogram variable lists loaded");
 
 /// Flag whether we need to import full type definitions for ThinLTO.
 /// Currently needed for Darwin and LLDB.
@@ -97,6 +101,13 @@ static cl::opt<bool> ImportFullTypeDefinitions(
     "import-full-type-definitions", cl::init(false), cl::Hidden,
     cl::desc("Import full type definitions for ThinLTO."));
 
+/// Flag whether to load the variables of every DISubprogram definition when
+/// importing, instead of only those of the materialized functions.
+static cl::opt<bool> ImportAllSubprogramVariables(
+    "import-all-subprogram-variables", cl::init(false), cl::Hidden,
+    cl::desc("Load the variables of all the subprograms reached while "
+             "importing, not only of the imported functions."));
+
 static cl::opt<bool> DisableLazyLoading(
     "disable-ondemand-mds-loading", cl::init(false), cl::Hidden,
     cl::desc("Force disable the lazy-loading on-demand of metadata when "
@@ -440,6 +451,19 @@ class MetadataLoader::MetadataLoaderImpl {
   /// populated.
   void lazyLoadOneMetadata(unsigned Idx, PlaceholderQueue &Placeholders);
 
+  /// Return true if the metadata \p ID is a node that can be loaded on-demand
+  /// from the index above.
+  bool isLazyLoadableNode(unsigned ID) const {
+    return ID >= MDStringRef.size() &&
+           ID < MDStringRef.size() + GlobalMetadataBitPosIndex.size();
+  }
+
+  /// Variables of the DISubprogram definitions that have been deferred while
+  /// lazy-loading. They are loaded when the function owning the subprogram is
+  /// materialized, the subprograms reached only through inlined locations or
+  /// scopes never get them.
+  DenseMap<DISubprogram *, unsigned> DeferredSPVariables;
+
   // Keep mapping of seens pair of old-style CU <-> SP, and update pointers to
   // point from SP to CU after a block is completly parsed.
   std::vector<std::pair<DICompileUnit *, Metadata *>> CUSubprograms;
@@ -658,6 +682,19 @@ public:
     return FunctionsWithSPs.lookup(F);
   }
 
+  void loadDeferredSubprogramVariables(Function &F) {
+    DISubprogram *SP = F.getSubprogram();
+    if (!SP)
+      return;
+    auto I = DeferredSPVariables.find(SP);
+    if (I == DeferredSPVariables.end())
+      return;
+    unsigned ID = I->second;
+    DeferredSPVariables.erase(I);
+    ++NumSPVariablesLoaded;
+    SP->replaceVariables(cast_or_null<MDTuple>(getMetadataFwdRefOrLoad(ID)));
+  }
+
   bool hasSeenOldLoopTags() { return HasSeenOldLoopTags; }
 
   Error parseMetadataAttachment(
@@ -1394,6 +1431,14 @@ Error MetadataLoader::MetadataLoaderImpl::parseOneMetadata(
     bool HasFn = Offset && !HasUnit;
     bool HasThisAdj = Record.size() >= 20;
     bool HasThrownTypes = Record.size() >= 21;
+    // When lazy-loading for importing, the variables of a definition are only
+    // needed if its function is materialized: defer loading them until then.
+    unsigned VariablesID = Record[17 + Offset];
+    bool DeferVariables = IsDistinct && IsImporting &&
+                          !ImportAllSubprogramVariables && VariablesID &&
+                          isLazyLoadableNode(VariablesID - 1) &&
+                          !MetadataList.lookup(VariablesID - 1);
+    Metadata *Variables = DeferVariables ? nullptr : getMDOrNull(VariablesID);
     DISubprogram *SP = GET_OR_DISTINCT(
         DISubprogram,
         (Context,
@@ -1415,12 +1460,17 @@ Error MetadataLoader::MetadataLoaderImpl::parseOneMetadata(
          HasUnit ? CUorFn : nullptr,                        // unit
          getMDOrNull(Record[15 + Offset]),                  // templateParams
          getMDOrNull(Record[16 + Offset]),                  // declaration
-         getMDOrNull(Record[17 + Offset]),                  // variables
+         Variables,                                         // variables
          HasThrownTypes ? getMDOrNull(Record[20]) : nullptr // thrownTypes
          ));
     MetadataList.assignValue(SP, NextMetadataNo);
     NextMetadataNo++;
 
+    if (DeferVariables) {
+      DeferredSPVariables[SP] = VariablesID - 1;
+      ++NumSPVariablesDeferred;
+    }
+
     // Upgrade sp->function mapping to function->sp mapping.
     if (HasFn) {
       if (auto *CMD = dyn_cast_or_null<ConstantAsMetadata>(CUorFn))
@@ -1954,6 +2004,10 @@ DISubprogram *MetadataLoader::lookupSubprogramForFunction(Function *F) {
   return Pimpl->lookupSubprogramForFunction(F);
 }
 
+void MetadataLoader::loadDeferredSubprogramVariables(Function &F) {
+  return Pimpl->loadDeferredSubprogramVariables(F);
+}
+
 Error MetadataLoader::parseMetadataAttachment(
     Function &F, const SmallVectorImpl<Instruction *> &InstructionList) {
   return Pimpl->parseMetadataAttachment(F, InstructionList);
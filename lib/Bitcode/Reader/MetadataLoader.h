@@ -70,6 +70,10 @@ public:
   /// Return the DISubprogra metadata for a Function if any, null otherwise.
   DISubprogram *lookupSubprogramForFunction(Function *F);
 
+  /// Load the variables of the DISubprogram attached to \p F if their loading
+  /// was deferred while lazily loading the module-level metadata.
+  void loadDeferredSubprogramVariables(Function &F);
+
   /// Parse a `METADATA_ATTACHMENT` block for a function.
   Error parseMetadataAttachment(
       Function &F, const SmallVectorImpl<Instruction *> &InstructionList);
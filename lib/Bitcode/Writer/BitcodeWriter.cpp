@@ -164,6 +164,9 @@ protected:
   /// backpatched with the offset of the actual VST.
   uint64_t VSTOffsetPlaceholder = 0;
 
+  /// Content hash of each function body written, emitted in its summary.
+  DenseMap<const Function *, ModuleHash> FunctionContentHashes;
+
 public:
   /// Constructs a ModuleBitcodeWriterBase object for the given Module,
   /// writing to the provided \p Buffer.
@@ -245,9 +248,17 @@ class ModuleBitcodeWriter : public ModuleBitcodeWriterBase {
 
   SHA1 Hasher;
 
+  /// Hasher over the module-level state, i.e. everything written before the
+  /// first function block, that every function content hash starts from.
+  SHA1 ModuleLevelHasher;
+  bool HasModuleLevelHash = false;
+
   /// The start bit of the identification block.
   uint64_t BitcodeStartBit;
 
+  /// The start position in the buffer of the module block content.
+  size_t ModuleBlockStartPos = 0;
+
 public:
   /// Constructs a ModuleBitcodeWriter object for the given Module,
   /// writing to the provided \p Buffer.
@@ -2987,6 +2998,16 @@ void ModuleBitcodeWriter::writeUseListBlock(const Function *F) {
   Stream.ExitBlock();
 }
 
+/// Split a raw 160-bits SHA1 into the five words used for the module and
+/// function content hashes.
+static ModuleHash getHashValues(StringRef Hash) {
+  ModuleHash Vals;
+  for (int Pos = 0; Pos < 20; Pos += 4) {
+    Vals[Pos / 4] = support::endian::read32be(Hash.data() + Pos);
+  }
+  return Vals;
+}
+
 /// Emit a function body to the module stream.
 void ModuleBitcodeWriter::writeFunction(
     const Function &F,
@@ -2998,6 +3019,17 @@ void ModuleBitcodeWriter::writeFunction(
   Stream.EnterSubblock(bitc::FUNCTION_BLOCK_ID, 4);
   VE.incorporateFunction(F);
 
+  // The block starts with its length word, that is now flushed to the buffer.
+  size_t FunctionBlockStartPos = Buffer.size() - 4;
+  bool GenerateContentHash = GenerateHash && Index;
+  if (GenerateContentHash && !HasModuleLevelHash) {
+    ModuleLevelHasher = Hasher;
+    ModuleLevelHasher.update(
+        ArrayRef<uint8_t>((const uint8_t *)&Buffer[ModuleBlockStartPos],
+                          FunctionBlockStartPos - ModuleBlockStartPos));
+    HasModuleLevelHash = true;
+  }
+
   SmallVector<unsigned, 64> Vals;
 
   // Emit the number of basic blocks, so the reader can create them ahead of
@@ -3063,6 +3095,16 @@ void ModuleBitcodeWriter::writeFunction(
     writeUseListBlock(&F);
   VE.purgeFunction();
   Stream.ExitBlock();
+
+  // Hash the function block on top of the module-level state: other function
+  // bodies, the VST and the summary don't affect the code of this function.
+  if (GenerateContentHash) {
+    SHA1 FunctionHasher = ModuleLevelHasher;
+    FunctionHasher.update(
+        ArrayRef<uint8_t>((const uint8_t *)&Buffer[FunctionBlockStartPos],
+                          Buffer.size() - FunctionBlockStartPos));
+    FunctionContentHashes[&F] = getHashValues(FunctionHasher.result());
+  }
 }
 
 // Emit blockinfo, which defines the standard abbreviations etc.
@@ -3363,6 +3405,17 @@ void ModuleBitcodeWriterBase::writePerModuleFunctionSummaryRecord(
   FunctionSummary *FS = cast<FunctionSummary>(Summary);
   writeFunctionTypeMetadataRecords(Stream, FS);
 
+  // Save the content hash of the function body written, so that the thin link
+  // bitcode written from the same index, without function bodies, has it too.
+  auto HashIt = FunctionContentHashes.find(&F);
+  if (HashIt != FunctionContentHashes.end())
+    FS->setContentHash(HashIt->second);
+
+  // FS_CONTENT_HASH: [5*i32]
+  if (llvm::any_of(FS->contentHash(), [](uint32_t H) { return H; }))
+    Stream.EmitRecord(bitc::FS_CONTENT_HASH,
+                      ArrayRef<uint32_t>(FS->contentHash()));
+
   NameVals.push_back(getEncodedGVSummaryFlags(FS->flags()));
   NameVals.push_back(FS->instCount());
   NameVals.push_back(getEncodedFFlags(FS->fflags()));
@@ -3653,6 +3706,11 @@ void IndexBitcodeWriter::writeCombinedGlobalValueSummary() {
     auto *FS = cast<FunctionSummary>(S);
     writeFunctionTypeMetadataRecords(Stream, FS);
 
+    // FS_CONTENT_HASH: [5*i32]
+    if (llvm::any_of(FS->contentHash(), [](uint32_t H) { return H; }))
+      Stream.EmitRecord(bitc::FS_CONTENT_HASH,
+                        ArrayRef<uint32_t>(FS->contentHash()));
+
     NameVals.push_back(*ValueId);
     NameVals.push_back(Index.getModuleId(FS->modulePath()));
     NameVals.push_back(getEncodedGVSummaryFlags(FS->flags()));
@@ -3788,16 +3846,12 @@ void ModuleBitcodeWriter::writeModuleHash(size_t BlockStartPos) {
   // Emit the module's hash.
   // MODULE_CODE_HASH: [5*i32]
   if (GenerateHash) {
-    uint32_t Vals[5];
     Hasher.update(ArrayRef<uint8_t>((const uint8_t *)&(Buffer)[BlockStartPos],
                                     Buffer.size() - BlockStartPos));
-    StringRef Hash = Hasher.result();
-    for (int Pos = 0; Pos < 20; Pos += 4) {
-      Vals[Pos / 4] = support::endian::read32be(Hash.data() + Pos);
-    }
+    ModuleHash Vals = getHashValues(Hasher.result());
 
     // Emit the finished record.
-    Stream.EmitRecord(bitc::MODULE_CODE_HASH, Vals);
+    Stream.EmitRecord(bitc::MODULE_CODE_HASH, ArrayRef<uint32_t>(Vals));
 
     if (ModHash)
       // Save the written hash value.
@@ -3810,6 +3864,7 @@ void ModuleBitcodeWriter::write() {
 
   Stream.EnterSubblock(bitc::MODULE_BLOCK_ID, 3);
   size_t BlockStartPos = Buffer.size();
+  ModuleBlockStartPos = BlockStartPos;
 
   writeModuleVersion();
 
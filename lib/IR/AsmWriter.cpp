@@ -479,7 +479,8 @@ public:
   TypePrinting(const TypePrinting &) = delete;
   TypePrinting &operator=(const TypePrinting &) = delete;
 
-  void incorporateTypes(const Module &M);
+  void incorporateTypes(const Module &M,
+                        AssemblyAnnotationWriter *AAW = nullptr);
 
   void print(Type *Ty, raw_ostream &OS);
 
@@ -488,8 +489,17 @@ public:
 
 } // end anonymous namespace
 
-void TypePrinting::incorporateTypes(const Module &M) {
-  NamedTypes.run(M, false);
+void TypePrinting::incorporateTypes(const Module &M,
+                                    AssemblyAnnotationWriter *AAW) {
+  NamedTypes.run(M, false,
+                 [AAW](const Function &F) {
+                   if (AAW)
+                     AAW->prepareFunctionBody(&F);
+                 },
+                 [AAW](const Function &F) {
+                   if (AAW)
+                     AAW->releaseFunctionBody(&F);
+                 });
 
   // The list of struct types we got back includes all the struct types, split
   // the unnamed ones out to a numbering and remove the anonymous structs.
@@ -2208,7 +2218,7 @@ AssemblyWriter::AssemblyWriter(formatted_raw_ostream &o, SlotTracker &Mac,
       ShouldPreserveUseListOrder(ShouldPreserveUseListOrder) {
   if (!TheModule)
     return;
-  TypePrinter.incorporateTypes(*TheModule);
+  TypePrinter.incorporateTypes(*TheModule, AAW);
   for (const GlobalObject &GO : TheModule->global_objects())
     if (const Comdat *C = GO.getComdat())
       Comdats.insert(C);
@@ -390,6 +390,11 @@ Error Module::materialize(GlobalValue *GV) {
   return Materializer->materialize(GV);
 }
 
+void Module::dematerialize(GlobalValue *GV) {
+  if (Materializer)
+    Materializer->dematerialize(GV);
+}
+
 Error Module::materializeAll() {
   if (!Materializer)
     return Error::success();
@@ -30,6 +30,12 @@
 using namespace llvm;
 
 void TypeFinder::run(const Module &M, bool onlyNamed) {
+  run(M, onlyNamed, [](const Function &) {}, [](const Function &) {});
+}
+
+void TypeFinder::run(const Module &M, bool onlyNamed,
+                     function_ref<void(const Function &)> PrepareBody,
+                     function_ref<void(const Function &)> ReleaseBody) {
   OnlyNamed = onlyNamed;
 
   // Get types from global variables.
@@ -61,6 +67,7 @@ void TypeFinder::run(const Module &M, bool onlyNamed) {
          AI != AE; ++AI)
       incorporateValue(&*AI);
 
+    PrepareBody(FI);
     for (const BasicBlock &BB : FI)
       for (const Instruction &I : BB) {
         // Incorporate the type of the instruction.
@@ -80,6 +87,7 @@ void TypeFinder::run(const Module &M, bool onlyNamed) {
 
         MDForInst.clear();
       }
+    ReleaseBody(FI);
   }
 
   for (Module::const_named_metadata_iterator I = M.named_metadata_begin(),
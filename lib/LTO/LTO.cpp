@@ -56,6 +56,38 @@ typedef DenseMap<
     TinyPtrVector<const std::pair<const std::string, TypeIdSummary> *>>
     TypeIdSummariesByGuidTy;
 
+// Returns the content hash of the function \p GUID imported from module
+// \p ModPath if the code it brings into the importing module only depends on
+// that hash, or null if the hash of the whole module must be used instead.
+static const ModuleHash *
+getImportedFunctionContentHash(const ModuleSummaryIndex &Index,
+                               StringRef ModPath, GlobalValue::GUID GUID) {
+  auto *FS = dyn_cast_or_null<FunctionSummary>(
+      Index.findSummaryInModule(GUID, ModPath));
+  if (!FS || llvm::none_of(FS->contentHash(), [](uint32_t H) { return H; }))
+    return nullptr;
+
+  // Locals promoted when importing are renamed after their module hash, so
+  // the importing module depends on it if any of them is imported or
+  // referenced by the imported code.
+  auto IsLocal = [&](const ValueInfo &VI) {
+    return llvm::any_of(VI.getSummaryList(),
+                        [&](const std::unique_ptr<GlobalValueSummary> &S) {
+                          return S->modulePath() == ModPath &&
+                                 S->getOriginalName() != VI.getGUID();
+                        });
+  };
+  if (FS->getOriginalName() != GUID)
+    return nullptr;
+  for (const ValueInfo &VI : FS->refs())
+    if (IsLocal(VI))
+      return nullptr;
+  for (auto &Edge : FS->calls())
+    if (IsLocal(Edge.first))
+      return nullptr;
+  return &FS->contentHash();
+}
+
 // Returns a unique hash for the Module considering the current list of
 // export/import and other global analysis results.
 // The hash is produced in \p Key.
@@ -142,14 +174,37 @@ static void computeCacheKey(
 
   // Include the hash for every module we import functions from. The set of
   // imported symbols for each module may affect code generation and is
-  // sensitive to link order, so include that as well.
+  // sensitive to link order, so include that as well. When the content hash of
+  // every function imported from a module is known, use them instead of the
+  // module hash, so that changes to the other functions of that module don't
+  // invalidate this entry.
   for (auto &Entry : ImportList) {
-    auto ModHash = Index.getModuleHash(Entry.first());
-    Hasher.update(ArrayRef<uint8_t>((uint8_t *)&ModHash[0], sizeof(ModHash)));
+    SmallVector<const ModuleHash *, 8> ContentHashes;
+    for (auto &Fn : Entry.second) {
+      auto *ContentHash =
+          getImportedFunctionContentHash(Index, Entry.first(), Fn.first);
+      if (!ContentHash) {
+        ContentHashes.clear();
+        break;
+      }
+      ContentHashes.push_back(ContentHash);
+    }
+    if (ContentHashes.empty()) {
+      auto ModHash = Index.getModuleHash(Entry.first());
+      Hasher.update(
+          ArrayRef<uint8_t>((uint8_t *)&ModHash[0], sizeof(ModHash)));
+    }
 
     AddUint64(Entry.second.size());
-    for (auto &Fn : Entry.second)
+    auto ContentHashIt = ContentHashes.begin();
+    for (auto &Fn : Entry.second) {
       AddUint64(Fn.first);
+      if (ContentHashIt != ContentHashes.end()) {
+        auto &FnHash = **ContentHashIt++;
+        Hasher.update(
+            ArrayRef<uint8_t>((const uint8_t *)&FnHash[0], sizeof(FnHash)));
+      }
+    }
   }
 
   // Include the hash for the resolved ODR.
@@ -370,8 +370,7 @@ bool ModuleLinker::linkIfNeeded(GlobalValue &GV) {
   }
 
   if (!DGV && !shouldOverrideFromSrc() &&
-      (GV.hasLocalLinkage() || GV.hasLinkOnceLinkage() ||
-       GV.hasAvailableExternallyLinkage()))
+      (GV.hasLocalLinkage() || Linker::isLinkedLazily(GV)))
     return false;
 
   if (GV.isDeclaration())
@@ -395,8 +394,7 @@ bool ModuleLinker::linkIfNeeded(GlobalValue &GV) {
 
 void ModuleLinker::addLazyFor(GlobalValue &GV, const IRMover::ValueAdder &Add) {
   // Add these to the internalize list
-  if (!GV.hasLinkOnceLinkage() && !GV.hasAvailableExternallyLinkage() &&
-      !shouldLinkOnlyNeeded())
+  if (!Linker::isLinkedLazily(GV) && !shouldLinkOnlyNeeded())
     return;
 
   if (InternalizeCallback)
@@ -595,6 +593,10 @@ bool Linker::linkModules(
   return L.linkInModule(std::move(Src), Flags, std::move(InternalizeCallback));
 }
 
+bool Linker::isLinkedLazily(const GlobalValue &GV) {
+  return GV.hasLinkOnceLinkage() || GV.hasAvailableExternallyLinkage();
+}
+
 //===----------------------------------------------------------------------===//
 // C API.
 //===----------------------------------------------------------------------===//
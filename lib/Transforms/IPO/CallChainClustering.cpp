@@ -0,0 +1,283 @@
+//===- CallChainClustering.cpp - Profile-guided function order ------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass writes a symbol ordering file for the linker, laying out the
+// functions that call each other often next to each other in .text. It should
+// run on a module annotated with an instrumentation or sample profile, and the
+// module should be compiled with -function-sections, so that the linker can
+// honor the order.
+//
+// The call graph is weighted with the profile counts of the call sites. The
+// order is then computed with call-chain clustering, as described in
+// "Optimizing Function Placement for Large-Scale Data-Center Applications"
+// (Ottoni and Maher, CGO 2017):
+//
+//  - Every function starts in a cluster of its own.
+//  - Functions are visited in decreasing order of entry count. The cluster of
+//    each function is appended to the cluster of its most frequent caller,
+//    unless the merged cluster would exceed a page, or would be much less
+//    dense than the caller's cluster.
+//  - The clusters are emitted in decreasing order of density, which is the
+//    entry count of their functions per instruction.
+//
+// Functions that were never executed are not listed, and are left by the
+// linker after the ordered ones.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO/CallChainClustering.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Mangler.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/IPO.h"
+#include <algorithm>
+#include <vector>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "call-chain-clustering"
+
+STATISTIC(NumOrderedFunctions, "Number of functions in the symbol order");
+STATISTIC(NumClusters, "Number of call-chain clusters");
+
+static cl::opt<std::string> OrderFile(
+    "call-chain-clustering-order-file", cl::value_desc("filename"),
+    cl::desc("Write the function order computed by call-chain clustering "
+             "to this file"));
+
+static cl::opt<unsigned> MaxClusterSize(
+    "call-chain-clustering-max-cluster-size", cl::init(1024), cl::Hidden,
+    cl::desc("Maximum size of a cluster, in instructions (about a page of "
+             "code by default)"));
+
+// Do not merge a cluster into its caller's cluster if that would divide the
+// density of the latter by more than this.
+static const double MaxDensityDegradation = 8.0;
+
+namespace {
+
+struct Cluster {
+  double getDensity() const { return Size ? double(Samples) / Size : 0; }
+
+  SmallVector<unsigned, 4> Functions;
+  uint64_t Size = 0;
+  uint64_t Samples = 0;
+};
+
+} // end anonymous namespace
+
+static unsigned getFunctionSize(const Function &F) {
+  unsigned Size = 0;
+  for (const BasicBlock &BB : F)
+    for (const Instruction &I : BB)
+      if (!isa<DbgInfoIntrinsic>(I))
+        ++Size;
+  return Size;
+}
+
+/// Compute the order of the executed functions of \p M.
+static std::vector<Function *>
+computeFunctionOrder(Module &M,
+                     function_ref<BlockFrequencyInfo &(Function &)> GetBFI,
+                     ProfileSummaryInfo &PSI) {
+  std::vector<Function *> Funcs;
+  std::vector<Cluster> Clusters;
+  DenseMap<const Function *, unsigned> FuncIndex;
+  for (Function &F : M) {
+    if (F.isDeclaration())
+      continue;
+    FuncIndex[&F] = Funcs.size();
+    Funcs.push_back(&F);
+    Clusters.emplace_back();
+    Cluster &C = Clusters.back();
+    C.Functions.push_back(FuncIndex[&F]);
+    C.Size = getFunctionSize(F);
+    C.Samples = F.getEntryCount().getValueOr(0);
+  }
+
+  // Weigh the call graph edges with the profile counts of the call sites. Only
+  // functions that were executed have call sites with a count.
+  MapVector<std::pair<unsigned, unsigned>, uint64_t> EdgeWeights;
+  for (unsigned Caller = 0, E = Funcs.size(); Caller != E; ++Caller) {
+    if (!Clusters[Caller].Samples)
+      continue;
+    BlockFrequencyInfo &BFI = GetBFI(*Funcs[Caller]);
+    for (BasicBlock &BB : *Funcs[Caller])
+      for (Instruction &I : BB) {
+        CallSite CS(&I);
+        if (!CS)
+          continue;
+        auto It = FuncIndex.find(CS.getCalledFunction());
+        if (It == FuncIndex.end() || It->second == Caller)
+          continue;
+        if (auto Count = PSI.getProfileCount(&I, &BFI))
+          if (*Count)
+            EdgeWeights[{Caller, It->second}] += *Count;
+      }
+  }
+
+  // Find the most frequent caller of each function.
+  std::vector<std::pair<unsigned, uint64_t>> BestCaller(
+      Funcs.size(), {Funcs.size(), 0});
+  for (const auto &Edge : EdgeWeights) {
+    auto &Best = BestCaller[Edge.first.second];
+    if (Edge.second > Best.second)
+      Best = {Edge.first.first, Edge.second};
+  }
+
+  std::vector<unsigned> Sorted;
+  for (unsigned Idx = 0, E = Funcs.size(); Idx != E; ++Idx)
+    if (Clusters[Idx].Samples)
+      Sorted.push_back(Idx);
+  std::stable_sort(Sorted.begin(), Sorted.end(), [&](unsigned A, unsigned B) {
+    return Clusters[A].Samples > Clusters[B].Samples;
+  });
+
+  // Leader[F] is the index of the cluster F currently belongs to.
+  std::vector<unsigned> Leader(Funcs.size());
+  for (unsigned Idx = 0, E = Funcs.size(); Idx != E; ++Idx)
+    Leader[Idx] = Idx;
+
+  for (unsigned Idx : Sorted) {
+    unsigned Caller = BestCaller[Idx].first;
+    if (Caller == Funcs.size())
+      continue;
+    Cluster &CalleeC = Clusters[Leader[Idx]];
+    Cluster &CallerC = Clusters[Leader[Caller]];
+    if (&CalleeC == &CallerC || CallerC.Size + CalleeC.Size > MaxClusterSize)
+      continue;
+    double NewDensity =
+        double(CallerC.Samples + CalleeC.Samples) /
+        double(CallerC.Size + CalleeC.Size);
+    if (NewDensity < CallerC.getDensity() / MaxDensityDegradation)
+      continue;
+
+    for (unsigned Member : CalleeC.Functions)
+      Leader[Member] = Leader[Caller];
+    CallerC.Functions.append(CalleeC.Functions.begin(),
+                             CalleeC.Functions.end());
+    CallerC.Size += CalleeC.Size;
+    CallerC.Samples += CalleeC.Samples;
+    CalleeC.Functions.clear();
+  }
+
+  std::vector<unsigned> Order;
+  for (unsigned Idx : Sorted)
+    if (Leader[Idx] == Idx)
+      Order.push_back(Idx);
+  std::stable_sort(Order.begin(), Order.end(), [&](unsigned A, unsigned B) {
+    return Clusters[A].getDensity() > Clusters[B].getDensity();
+  });
+  NumClusters += Order.size();
+
+  std::vector<Function *> Result;
+  for (unsigned Idx : Order) {
+    DEBUG(dbgs() << "Cluster of density " << Clusters[Idx].getDensity()
+                 << ":");
+    for (unsigned Member : Clusters[Idx].Functions) {
+      DEBUG(dbgs() << " " << Funcs[Member]->getName());
+      Result.push_back(Funcs[Member]);
+    }
+    DEBUG(dbgs() << "\n");
+  }
+  NumOrderedFunctions += Result.size();
+  return Result;
+}
+
+static void
+writeFunctionOrder(Module &M,
+                   function_ref<BlockFrequencyInfo &(Function &)> GetBFI,
+                   ProfileSummaryInfo &PSI) {
+  std::vector<Function *> Order = computeFunctionOrder(M, GetBFI, PSI);
+
+  std::error_code EC;
+  raw_fd_ostream OS(OrderFile, EC, sys::fs::F_Text);
+  if (EC) {
+    M.getContext().emitError("cannot open call-chain clustering order file '" +
+                             OrderFile + "': " + EC.message());
+    return;
+  }
+  // The linker sees the symbol names, with the global prefix of the target.
+  Mangler Mang;
+  for (Function *F : Order) {
+    Mang.getNameWithPrefix(OS, F, /*CannotUsePrivateLabel=*/false);
+    OS << "\n";
+  }
+}
+
+namespace {
+
+class CallChainClusteringLegacyPass : public ModulePass {
+public:
+  static char ID;
+
+  CallChainClusteringLegacyPass() : ModulePass(ID) {
+    initializeCallChainClusteringLegacyPassPass(
+        *PassRegistry::getPassRegistry());
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<BlockFrequencyInfoWrapperPass>();
+    AU.addRequired<ProfileSummaryInfoWrapperPass>();
+    AU.setPreservesAll();
+  }
+
+  bool runOnModule(Module &M) override {
+    if (OrderFile.empty())
+      return false;
+    auto GetBFI = [this](Function &F) -> BlockFrequencyInfo & {
+      return this->getAnalysis<BlockFrequencyInfoWrapperPass>(F).getBFI();
+    };
+    writeFunctionOrder(M, GetBFI,
+                       *getAnalysis<ProfileSummaryInfoWrapperPass>().getPSI());
+    return false;
+  }
+};
+
+} // end anonymous namespace
+
+char CallChainClusteringLegacyPass::ID = 0;
+
+INITIALIZE_PASS_BEGIN(CallChainClusteringLegacyPass, "call-chain-clustering",
+                      "Call-Chain Clustering Function Order", false, false)
+INITIALIZE_PASS_DEPENDENCY(BlockFrequencyInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(ProfileSummaryInfoWrapperPass)
+INITIALIZE_PASS_END(CallChainClusteringLegacyPass, "call-chain-clustering",
+                    "Call-Chain Clustering Function Order", false, false)
+
+ModulePass *llvm::createCallChainClusteringPass() {
+  return new CallChainClusteringLegacyPass();
+}
+
+PreservedAnalyses CallChainClusteringPass::run(Module &M,
+                                               ModuleAnalysisManager &AM) {
+  if (OrderFile.empty())
+    return PreservedAnalyses::all();
+  auto &FAM = AM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+  auto GetBFI = [&FAM](Function &F) -> BlockFrequencyInfo & {
+    return FAM.getResult<BlockFrequencyAnalysis>(F);
+  };
+  writeFunctionOrder(M, GetBFI, AM.getResult<ProfileSummaryAnalysis>(M));
+  return PreservedAnalyses::all();
+}
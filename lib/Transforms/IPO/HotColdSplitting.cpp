@@ -0,0 +1,285 @@
+//===- HotColdSplitting.cpp -- Outline Cold Regions -------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass outlines the cold regions of functions, so that the hot code is
+// laid out densely and cold error paths no longer take up i-cache and iTLB
+// entries next to it.
+//
+// Cold blocks are found from the profile, through ProfileSummaryInfo and
+// BlockFrequencyInfo, when the module has one. Independently of the profile,
+// blocks ending in unreachable or calling a cold function are unlikely to be
+// executed, and so are the blocks that can only lead to them.
+//
+// A cold block and the cold blocks it dominates form a single-entry region,
+// which is extracted by the CodeExtractor into a new function. That function
+// is marked cold and minsize, and placed in the .text.unlikely section.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO/HotColdSplitting.h"
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Analysis/BranchProbabilityInfo.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
+#include "llvm/IR/Attributes.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/Utils/CodeExtractor.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "hotcoldsplit"
+
+STATISTIC(NumColdRegionsOutlined, "Number of cold regions outlined");
+
+static cl::opt<unsigned> MinOutliningSize(
+    "hotcoldsplit-min-size", cl::init(3), cl::Hidden,
+    cl::desc("Minimum number of instructions in a cold region for it to be "
+             "outlined"));
+
+/// A block is unlikely to be executed if it ends the program abnormally or
+/// calls a function known to be cold.
+static bool unlikelyExecuted(const BasicBlock &BB) {
+  if (isa<UnreachableInst>(BB.getTerminator()))
+    return true;
+  for (const Instruction &I : BB)
+    if (auto CS = ImmutableCallSite(&I))
+      if (CS.hasFnAttr(Attribute::Cold))
+        return true;
+  return false;
+}
+
+/// Count the instructions that moving BB out of its function would save.
+static unsigned getOutlinedSize(const BasicBlock &BB) {
+  unsigned Size = 0;
+  for (const Instruction &I : BB)
+    if (!isa<PHINode>(I) && !isa<DbgInfoIntrinsic>(I) && !isa<TerminatorInst>(I))
+      ++Size;
+  return Size;
+}
+
+namespace {
+
+class HotColdSplitting {
+public:
+  HotColdSplitting(ProfileSummaryInfo *PSI) : PSI(PSI) {}
+
+  bool run(Module &M);
+
+private:
+  bool shouldOutlineFrom(const Function &F);
+  bool isOutlinable(const BasicBlock &BB) const;
+  SmallVector<BasicBlock *, 8>
+  getColdRegion(BasicBlock *Header, const SmallPtrSetImpl<BasicBlock *> &Cold,
+                const DominatorTree &DT) const;
+  bool outlineColdRegions(Function &F);
+
+  ProfileSummaryInfo *PSI;
+  /// The functions created by this pass. The blocks calling them are left
+  /// alone, as they are all that remains of a region already outlined.
+  SmallPtrSet<const Function *, 8> OutlinedFunctions;
+};
+
+} // end anonymous namespace
+
+bool HotColdSplitting::shouldOutlineFrom(const Function &F) {
+  if (F.isDeclaration() || OutlinedFunctions.count(&F))
+    return false;
+  // There is no hot code to split cold code from.
+  if (F.hasFnAttribute(Attribute::Cold) ||
+      (PSI->hasProfileSummary() && PSI->isFunctionEntryCold(&F)))
+    return false;
+  return !F.hasFnAttribute(Attribute::OptimizeNone) &&
+         !F.hasFnAttribute(Attribute::Naked);
+}
+
+bool HotColdSplitting::isOutlinable(const BasicBlock &BB) const {
+  // Exception handling edges cannot be redirected through a call.
+  if (BB.isEHPad() || BB.getTerminator()->isExceptional())
+    return false;
+  for (const Instruction &I : BB)
+    if (auto CS = ImmutableCallSite(&I))
+      if (OutlinedFunctions.count(CS.getCalledFunction()))
+        return false;
+  return true;
+}
+
+/// Return the region made of \p Header and the cold blocks it dominates, with
+/// \p Header first. Blocks that can be entered from outside the region are left
+/// out, so that \p Header is its only entry.
+SmallVector<BasicBlock *, 8>
+HotColdSplitting::getColdRegion(BasicBlock *Header,
+                                const SmallPtrSetImpl<BasicBlock *> &Cold,
+                                const DominatorTree &DT) const {
+  SmallSetVector<BasicBlock *, 8> Region;
+  SmallVector<BasicBlock *, 8> Worklist;
+  Worklist.push_back(Header);
+  while (!Worklist.empty()) {
+    BasicBlock *BB = Worklist.pop_back_val();
+    Region.insert(BB);
+    for (DomTreeNode *Child : DT.getNode(BB)->getChildren())
+      if (Cold.count(Child->getBlock()) && isOutlinable(*Child->getBlock()))
+        Worklist.push_back(Child->getBlock());
+  }
+
+  bool Changed;
+  do {
+    Changed = Region.remove_if([&](BasicBlock *BB) {
+      return BB != Header && any_of(predecessors(BB), [&](BasicBlock *Pred) {
+               return !Region.count(Pred);
+             });
+    });
+  } while (Changed);
+  return SmallVector<BasicBlock *, 8>(Region.begin(), Region.end());
+}
+
+/// Outline the cold regions of \p F. They are all found from a single
+/// computation of the analyses of \p F. The regions are disjoint, and
+/// extracting one only replaces its own blocks by a call, so what the analyses
+/// say about the blocks of the other regions still holds.
+bool HotColdSplitting::outlineColdRegions(Function &F) {
+  DominatorTree DT(F);
+  PostDominatorTree PDT;
+  PDT.recalculate(F);
+  LoopInfo LI(DT);
+  BranchProbabilityInfo BPI(F, LI);
+  BlockFrequencyInfo BFI(F, BPI, LI);
+
+  SmallPtrSet<BasicBlock *, 16> ColdBlocks;
+  bool HasProfile = PSI->hasProfileSummary();
+  for (BasicBlock &BB : F) {
+    if (!isOutlinable(BB))
+      continue;
+    if (HasProfile && PSI->isColdBB(&BB, &BFI))
+      ColdBlocks.insert(&BB);
+    if (!unlikelyExecuted(BB))
+      continue;
+    // The blocks that can only lead to BB are as cold as it is.
+    if (DomTreeNode *Node = PDT.getNode(&BB))
+      for (DomTreeNode *PostDominated : depth_first(Node))
+        if (isOutlinable(*PostDominated->getBlock()))
+          ColdBlocks.insert(PostDominated->getBlock());
+  }
+  if (ColdBlocks.empty() || ColdBlocks.count(&F.getEntryBlock()))
+    return false;
+
+  // The regions are disjoint: a cold block left out of the region of its
+  // dominator, because it has another entry, can head a region of its own.
+  SmallVector<SmallVector<BasicBlock *, 8>, 4> Regions;
+  ReversePostOrderTraversal<Function *> RPOT(&F);
+  for (BasicBlock *Header : RPOT) {
+    if (!ColdBlocks.count(Header))
+      continue;
+    SmallVector<BasicBlock *, 8> Region = getColdRegion(Header, ColdBlocks, DT);
+    for (BasicBlock *BB : Region)
+      ColdBlocks.erase(BB);
+    unsigned Size = 0;
+    for (BasicBlock *BB : Region)
+      Size += getOutlinedSize(*BB);
+    if (Size >= MinOutliningSize)
+      Regions.push_back(std::move(Region));
+  }
+
+  bool Changed = false;
+  for (ArrayRef<BasicBlock *> Region : Regions) {
+    CodeExtractor CE(Region, &DT, /* AggregateArgs */ false, &BFI, &BPI);
+    if (!CE.isEligible())
+      continue;
+    Function *Outlined = CE.extractCodeRegion();
+    if (!Outlined)
+      continue;
+
+    DEBUG(dbgs() << "Outlined cold region of " << Region.size()
+                 << " blocks from " << F.getName() << " into "
+                 << Outlined->getName() << "\n");
+    Outlined->addFnAttr(Attribute::Cold);
+    Outlined->addFnAttr(Attribute::MinSize);
+    Outlined->addFnAttr(Attribute::NoInline);
+    Outlined->setSectionPrefix(".unlikely");
+    OutlinedFunctions.insert(Outlined);
+    ++NumColdRegionsOutlined;
+    Changed = true;
+  }
+  return Changed;
+}
+
+bool HotColdSplitting::run(Module &M) {
+  SmallVector<Function *, 16> Worklist;
+  for (Function &F : M)
+    if (shouldOutlineFrom(F))
+      Worklist.push_back(&F);
+
+  bool Changed = false;
+  for (Function *F : Worklist)
+    Changed |= outlineColdRegions(*F);
+  return Changed;
+}
+
+namespace {
+
+class HotColdSplittingLegacyPass : public ModulePass {
+public:
+  static char ID;
+
+  HotColdSplittingLegacyPass() : ModulePass(ID) {
+    initializeHotColdSplittingLegacyPassPass(*PassRegistry::getPassRegistry());
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<ProfileSummaryInfoWrapperPass>();
+  }
+
+  bool runOnModule(Module &M) override {
+    if (skipModule(M))
+      return false;
+    ProfileSummaryInfo *PSI =
+        getAnalysis<ProfileSummaryInfoWrapperPass>().getPSI();
+    return HotColdSplitting(PSI).run(M);
+  }
+};
+
+} // end anonymous namespace
+
+char HotColdSplittingLegacyPass::ID = 0;
+
+INITIALIZE_PASS_BEGIN(HotColdSplittingLegacyPass, "hotcoldsplit",
+                      "Hot Cold Splitting", false, false)
+INITIALIZE_PASS_DEPENDENCY(ProfileSummaryInfoWrapperPass)
+INITIALIZE_PASS_END(HotColdSplittingLegacyPass, "hotcoldsplit",
+                    "Hot Cold Splitting", false, false)
+
+ModulePass *llvm::createHotColdSplittingPass() {
+  return new HotColdSplittingLegacyPass();
+}
+
+PreservedAnalyses HotColdSplittingPass::run(Module &M,
+                                            ModuleAnalysisManager &AM) {
+  ProfileSummaryInfo *PSI = &AM.getResult<ProfileSummaryAnalysis>(M);
+  if (HotColdSplitting(PSI).run(M))
+    return PreservedAnalyses::none();
+  return PreservedAnalyses::all();
+}
@@ -76,6 +76,7 @@ STATISTIC(NumInlined, "Number of functions inlined");
 STATISTIC(NumCallsDeleted, "Number of call sites deleted, not inlined");
 STATISTIC(NumDeleted, "Number of functions deleted because all callers found");
 STATISTIC(NumMergedAllocas, "Number of allocas merged together");
+STATISTIC(NumCachedInlineCosts, "Number of inline costs reused from the cache");
 
 // This weirdly named statistic tracks the number of times that, when attempting
 // to inline a function A into B, we analyze the callers of B in order to see
@@ -93,6 +94,13 @@ static cl::opt<bool>
     DisableInlinedAllocaMerging("disable-inlined-alloca-merging",
                                 cl::init(false), cl::Hidden);
 
+/// Flag to disable the reuse of inline costs within one run of the inliner.
+static cl::opt<bool>
+    EnableInlineCostCache("inline-cost-cache", cl::init(true), cl::Hidden,
+                          cl::desc("Reuse the inline cost of a call site while "
+                                   "neither its caller nor its callee "
+                                   "changed"));
+
 namespace {
 
 enum class InlinerFunctionImportStatsOpts {
@@ -289,6 +297,103 @@ static bool InlineCallIfPossible(
   return true;
 }
 
+namespace {
+
+/// Caches the inline costs computed during one run of the inliner over an SCC.
+///
+/// The legacy inliner re-evaluates every remaining call site each time it
+/// goes around its worklist, and shouldBeDeferred analyzes all the callers of
+/// a caller for each of its call sites, so most call sites get analyzed many
+/// times while their caller and callee did not change at all.
+///
+/// Each function has a modification counter, which the inliner bumps when it
+/// changes the body of the function or inlines it somewhere. A cached cost is
+/// reused as long as the counters of its caller and callee are unchanged and
+/// the callee still has the same number of uses (one or more). Callees with
+/// indirect calls are never cached, as the analysis may look into the body of
+/// whatever function such a call resolves to.
+class InlineCostCache {
+  struct CachedInlineCost {
+    Function *Caller;
+    Function *Callee;
+    unsigned CallerVersion;
+    unsigned CalleeVersion;
+    bool CalleeHasOneUse;
+    InlineCost IC;
+  };
+
+  /// The modification counter of each function, zero if it never changed.
+  DenseMap<Function *, unsigned> Versions;
+
+  /// Whether the costs of calls to a function can be cached, along with the
+  /// version of the function it was computed for.
+  DenseMap<Function *, std::pair<unsigned, bool>> CacheableCallees;
+
+  DenseMap<Instruction *, CachedInlineCost> Costs;
+
+  unsigned getVersion(Function *F) const { return Versions.lookup(F); }
+  bool isCacheableCallee(Function *Callee);
+
+public:
+  /// Return the cost of \p CS, either from the cache or from \p GetInlineCost.
+  InlineCost getInlineCost(CallSite CS,
+                           function_ref<InlineCost(CallSite CS)> GetInlineCost);
+
+  /// Record that the body or the set of callers of \p F changed.
+  void invalidate(Function *F) { ++Versions[F]; }
+
+  /// Forget all the cached costs, e.g. because a function has been deleted.
+  void clear() {
+    Versions.clear();
+    CacheableCallees.clear();
+    Costs.clear();
+  }
+};
+
+} // end anonymous namespace
+
+bool InlineCostCache::isCacheableCallee(Function *Callee) {
+  unsigned Version = getVersion(Callee);
+  auto It = CacheableCallees.find(Callee);
+  if (It != CacheableCallees.end() && It->second.first == Version)
+    return It->second.second;
+
+  bool Cacheable = none_of(instructions(*Callee), [](Instruction &I) {
+    CallSite CS(&I);
+    return CS && !CS.getCalledFunction();
+  });
+  CacheableCallees[Callee] = {Version, Cacheable};
+  return Cacheable;
+}
+
+InlineCost InlineCostCache::getInlineCost(
+    CallSite CS, function_ref<InlineCost(CallSite CS)> GetInlineCost) {
+  Function *Caller = CS.getCaller();
+  Function *Callee = CS.getCalledFunction();
+  if (!EnableInlineCostCache || !Callee || Callee->isDeclaration() ||
+      !isCacheableCallee(Callee))
+    return GetInlineCost(CS);
+
+  Instruction *Call = CS.getInstruction();
+  auto It = Costs.find(Call);
+  if (It != Costs.end()) {
+    const CachedInlineCost &Cached = It->second;
+    if (Cached.Caller == Caller && Cached.Callee == Callee &&
+        Cached.CallerVersion == getVersion(Caller) &&
+        Cached.CalleeVersion == getVersion(Callee) &&
+        Cached.CalleeHasOneUse == Callee->hasOneUse()) {
+      ++NumCachedInlineCosts;
+      return Cached.IC;
+    }
+    Costs.erase(It);
+  }
+
+  InlineCost IC = GetInlineCost(CS);
+  Costs.insert({Call, {Caller, Callee, getVersion(Caller), getVersion(Callee),
+                       Callee->hasOneUse(), IC}});
+  return IC;
+}
+
 /// Return true if inlining of CS can block the caller from being
 /// inlined which is proved to be more beneficial. \p IC is the
 /// estimated inline cost associated with callsite \p CS.
@@ -541,6 +646,13 @@ inlineCallsImpl(CallGraphSCC &SCC, CallGraph &CG,
   InlinedArrayAllocasTy InlinedArrayAllocas;
   InlineFunctionInfo InlineInfo(&CG, &GetAssumptionCache, PSI);
 
+  // Remaining call sites are analyzed again each time we go around the loop
+  // below, so keep their costs while nothing they depend on changed.
+  InlineCostCache CostCache;
+  auto GetCachedInlineCost = [&](CallSite CS) {
+    return CostCache.getInlineCost(CS, GetInlineCost);
+  };
+
   // Now that we have all of the call sites, loop over them and inline them if
   // it looks profitable to do so.
   bool Changed = false;
@@ -582,7 +694,7 @@ inlineCallsImpl(CallGraphSCC &SCC, CallGraph &CG,
       // just become a regular analysis dependency.
       OptimizationRemarkEmitter ORE(Caller);
 
-      Optional<InlineCost> OIC = shouldInline(CS, GetInlineCost, ORE);
+      Optional<InlineCost> OIC = shouldInline(CS, GetCachedInlineCost, ORE);
       // If the policy determines that we should inline this function,
       // delete the call instead.
       if (!OIC)
@@ -648,6 +760,10 @@ inlineCallsImpl(CallGraphSCC &SCC, CallGraph &CG,
         }
       }
 
+      // The caller has been modified and the callee lost a call site.
+      CostCache.invalidate(Caller);
+      CostCache.invalidate(Callee);
+
       // If we inlined or deleted the last possible call site to the function,
       // delete the function body now.
       if (Callee && Callee->use_empty() && Callee->hasLocalLinkage() &&
@@ -667,6 +783,7 @@ inlineCallsImpl(CallGraphSCC &SCC, CallGraph &CG,
         // Removing the node for callee from the call graph and delete it.
         delete CG.removeFunctionFromModule(CalleeNode);
         ++NumDeleted;
+        CostCache.clear();
       }
 
       // Remove this call site from the list.  If possible, use
@@ -865,6 +982,10 @@ PreservedAnalyses InlinerPass::run(LazyCallGraph::SCC &InitialC,
   // defer deleting these to make it easier to handle the call graph updates.
   SmallVector<Function *, 4> DeadFunctions;
 
+  // shouldBeDeferred analyzes all the callers of a caller for each of its call
+  // sites, keep these costs while nothing they depend on changed.
+  InlineCostCache CostCache;
+
   // Loop forward over all of the calls. Note that we cannot cache the size as
   // inlining can introduce new calls that need to be processed.
   for (int i = 0; i < (int)Calls.size(); ++i) {
@@ -909,6 +1030,9 @@ PreservedAnalyses InlinerPass::run(LazyCallGraph::SCC &InitialC,
       return getInlineCost(CS, Params, CalleeTTI, GetAssumptionCache, {GetBFI},
                            PSI, &ORE);
     };
+    auto GetCachedInlineCost = [&](CallSite CS) {
+      return CostCache.getInlineCost(CS, GetInlineCost);
+    };
 
     // Now process as many calls as we have within this caller in the sequnece.
     // We bail out as soon as the caller has to change so we can update the
@@ -937,7 +1061,7 @@ PreservedAnalyses InlinerPass::run(LazyCallGraph::SCC &InitialC,
         continue;
       }
 
-      Optional<InlineCost> OIC = shouldInline(CS, GetInlineCost, ORE);
+      Optional<InlineCost> OIC = shouldInline(CS, GetCachedInlineCost, ORE);
       // Check whether we want to inline this callsite.
       if (!OIC)
         continue;
@@ -965,6 +1089,8 @@ PreservedAnalyses InlinerPass::run(LazyCallGraph::SCC &InitialC,
       }
       DidInline = true;
       InlinedCallees.insert(&Callee);
+      CostCache.invalidate(&F);
+      CostCache.invalidate(&Callee);
 
       ORE.emit([&]() {
         bool AlwaysInline = OIC->isAlways();
@@ -1015,6 +1141,7 @@ PreservedAnalyses InlinerPass::run(LazyCallGraph::SCC &InitialC,
           // Note that after this point, it is an error to do anything other
           // than use the callee's address or delete it.
           Callee.dropAllReferences();
+          CostCache.clear();
           assert(find(DeadFunctions, &Callee) == DeadFunctions.end() &&
                  "Cannot put cause a function to become dead twice!");
           DeadFunctions.push_back(&Callee);
@@ -36,6 +36,12 @@
 // Collisions in the hash affect the speed of the pass but not the correctness
 // or determinism of the resulting transformation.
 //
+// Before the functions are inserted into the tree, the functions sharing a
+// hash are sorted by the comparison function, one hash bucket per task, on
+// multiple threads. The tree is then built from the sorted worklist, mostly
+// with a single comparison per insertion. Merging stays sequential, as it
+// modifies the module.
+//
 // When a match is found the functions are folded. If both functions are
 // overridable, we move the functionality into a new internal function and
 // leave two overridable thunks to it.
@@ -111,6 +117,7 @@
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
+#include "llvm/IR/TypeFinder.h"
 #include "llvm/IR/Use.h"
 #include "llvm/IR/User.h"
 #include "llvm/IR/Value.h"
@@ -120,6 +127,8 @@
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/Utils/FunctionComparator.h"
@@ -165,6 +174,18 @@ static cl::opt<bool>
                       cl::desc("Preserve debug info in thunk when mergefunc "
                                "transformations are made."));
 
+static cl::opt<bool> MergeFunctionsParallel(
+    "mergefunc-parallel", cl::Hidden, cl::init(true),
+    cl::desc("Sort the functions that share a hash on multiple threads before "
+             "inserting them into the function tree."));
+
+// Unlike -stats, this report is available in release builds, so that the
+// effect of the pass can be measured on real builds.
+static cl::opt<bool> MergeFunctionsStats(
+    "mergefunc-stats", cl::init(false),
+    cl::desc("Report how many functions mergefunc merged and how many "
+             "instructions that saved."));
+
 namespace {
 
 class FunctionNode {
@@ -234,6 +255,15 @@ private:
   bool doSanityCheck(std::vector<WeakTrackingVH> &Worklist);
 #endif
 
+  /// Order the functions of the worklist by hash, and the functions sharing
+  /// a hash by the comparison function, so that each function is inserted
+  /// next to the one inserted before it.
+  void sortWorklist(Module &M, std::vector<WeakTrackingVH> &Worklist);
+
+  /// Print the -mergefunc-stats report.
+  void printStats(Module &M, unsigned NumFunctions, unsigned NumCandidates,
+                  unsigned InstrsBefore);
+
   /// Insert a ComparableFunction into the FnTree, or merge it away if it's
   /// equal to one that's already present.
   bool insert(Function *NewFunction);
@@ -285,6 +315,14 @@ private:
   // dangling iterators into FnTree. The invariant that preserves this is that
   // there is exactly one mapping F -> FN for each FunctionNode FN in FnTree.
   ValueMap<Function*, FnTreeType::iterator> FNodesInTree;
+
+  /// The function last inserted as unique, after which the next function of
+  /// the sorted worklist is most likely to go.
+  WeakVH LastInserted;
+
+  /// Counts for the -mergefunc-stats report of the current module.
+  unsigned MergedCount = 0;
+  unsigned ThunkCount = 0;
 };
 
 } // end anonymous namespace
@@ -370,11 +408,21 @@ bool MergeFunctions::doSanityCheck(std::vector<WeakTrackingVH> &Worklist) {
 }
 #endif
 
+static unsigned countInstructions(const Module &M) {
+  unsigned Count = 0;
+  for (const Function &F : M)
+    for (const BasicBlock &BB : F)
+      Count += BB.size();
+  return Count;
+}
+
 bool MergeFunctions::runOnModule(Module &M) {
   if (skipModule(M))
     return false;
 
   bool Changed = false;
+  MergedCount = ThunkCount = 0;
+  unsigned InstrsBefore = MergeFunctionsStats ? countInstructions(M) : 0;
 
   // All functions in the module, ordered by hash. Functions with a unique
   // hash value are easily eliminated.
@@ -402,13 +450,17 @@ bool MergeFunctions::runOnModule(Module &M) {
       Deferred.push_back(WeakTrackingVH(I->second));
     }
   }
-  
+  unsigned NumCandidates = Deferred.size();
+
   do {
     std::vector<WeakTrackingVH> Worklist;
     Deferred.swap(Worklist);
 
     DEBUG(doSanityCheck(Worklist));
 
+    sortWorklist(M, Worklist);
+    LastInserted = nullptr;
+
     DEBUG(dbgs() << "size of module: " << M.size() << '\n');
     DEBUG(dbgs() << "size of worklist: " << Worklist.size() << '\n');
 
@@ -427,9 +479,94 @@ bool MergeFunctions::runOnModule(Module &M) {
   FnTree.clear();
   GlobalNumbers.clear();
 
+  if (MergeFunctionsStats)
+    printStats(M, HashedFuncs.size(), NumCandidates, InstrsBefore);
+
   return Changed;
 }
 
+void MergeFunctions::sortWorklist(Module &M,
+                                  std::vector<WeakTrackingVH> &Worklist) {
+  using HashedFunction =
+      std::pair<FunctionComparator::FunctionHash, Function *>;
+  std::vector<HashedFunction> HashedFuncs;
+  for (WeakTrackingVH &I : Worklist) {
+    if (!I)
+      continue;
+    Function *F = cast<Function>(I);
+    if (!F->isDeclaration() && !F->hasAvailableExternallyLinkage())
+      HashedFuncs.push_back({FunctionComparator::functionHash(*F), F});
+  }
+
+  std::stable_sort(HashedFuncs.begin(), HashedFuncs.end(),
+                   [](const HashedFunction &A, const HashedFunction &B) {
+                     return A.first < B.first;
+                   });
+
+  // Only the functions that share a hash need the full comparison.
+  std::vector<std::pair<size_t, size_t>> Buckets;
+  for (size_t B = 0, E = HashedFuncs.size(); B != E;) {
+    size_t BucketEnd = B + 1;
+    while (BucketEnd != E &&
+           HashedFuncs[BucketEnd].first == HashedFuncs[B].first)
+      ++BucketEnd;
+    if (BucketEnd - B > 1)
+      Buckets.push_back({B, BucketEnd});
+    B = BucketEnd;
+  }
+
+  // The comparison numbers globals, creates the integer type of pointers and
+  // computes struct layouts on first use. Do all of that here, so that the
+  // comparisons of different buckets only read shared state.
+  for (GlobalValue &GV : M.global_values())
+    GlobalNumbers.getNumber(&GV);
+  const DataLayout &DL = M.getDataLayout();
+  DL.getIntPtrType(M.getContext());
+  TypeFinder StructTypes;
+  StructTypes.run(M, /*onlyNamed=*/false);
+  for (StructType *STy : StructTypes)
+    if (STy->isSized())
+      DL.getStructLayout(STy);
+
+  // Equal functions keep their relative order, so they are merged in the same
+  // order as with an unsorted worklist.
+  auto SortBucket = [&](const std::pair<size_t, size_t> &Bucket) {
+    std::stable_sort(HashedFuncs.begin() + Bucket.first,
+                     HashedFuncs.begin() + Bucket.second,
+                     [&](const HashedFunction &A, const HashedFunction &B) {
+                       FunctionComparator FCmp(A.second, B.second,
+                                               &GlobalNumbers);
+                       return FCmp.compare() == -1;
+                     });
+  };
+  if (MergeFunctionsParallel)
+    parallel::for_each(parallel::par, Buckets.begin(), Buckets.end(),
+                       SortBucket);
+  else
+    std::for_each(Buckets.begin(), Buckets.end(), SortBucket);
+
+  DEBUG(dbgs() << "hash buckets to sort: " << Buckets.size() << '\n');
+
+  Worklist.clear();
+  for (const HashedFunction &HF : HashedFuncs)
+    Worklist.push_back(WeakTrackingVH(HF.second));
+}
+
+void MergeFunctions::printStats(Module &M, unsigned NumFunctions,
+                                unsigned NumCandidates,
+                                unsigned InstrsBefore) {
+  unsigned InstrsAfter = countInstructions(M);
+  unsigned Saved = InstrsBefore > InstrsAfter ? InstrsBefore - InstrsAfter : 0;
+  double Percent = InstrsBefore ? 100.0 * Saved / InstrsBefore : 0.0;
+  errs() << "mergefunc: " << M.getModuleIdentifier() << ": merged "
+         << MergedCount << " of " << NumFunctions << " functions ("
+         << NumCandidates << " sharing a hash), " << ThunkCount
+         << " thunks written\n";
+  errs() << "mergefunc: " << M.getModuleIdentifier() << ": " << InstrsBefore
+         << " -> " << InstrsAfter << " instructions, " << Saved << " saved ("
+         << format("%.1f", Percent) << "%)\n";
+}
+
 // Replace direct callers of Old with New.
 void MergeFunctions::replaceDirectCallers(Function *Old, Function *New) {
   Constant *BitcastNew = ConstantExpr::getBitCast(New, Old->getType());
@@ -727,6 +864,7 @@ void MergeFunctions::writeThunk(Function *F, Function *G) {
 
   DEBUG(dbgs() << "writeThunk: " << H->getName() << '\n');
   ++NumThunksWritten;
+  ++ThunkCount;
 }
 
 // Merge two equivalent functions. Upon completion, Function G is deleted.
@@ -755,6 +893,7 @@ void MergeFunctions::mergeTwoFunctions(Function *F, Function *G) {
     F->setLinkage(GlobalValue::PrivateLinkage);
     ++NumDoubleWeak;
     ++NumFunctionsMerged;
+    ++MergedCount;
   } else {
     // For better debugability, under MergeFunctionsPDI, we do not modify G's
     // call sites to point to F even when within the same translation unit.
@@ -779,6 +918,7 @@ void MergeFunctions::mergeTwoFunctions(Function *F, Function *G) {
     if (G->hasLocalLinkage() && G->use_empty() && !MergeFunctionsPDI) {
       G->eraseFromParent();
       ++NumFunctionsMerged;
+      ++MergedCount;
       return;
     }
 
@@ -788,6 +928,7 @@ void MergeFunctions::mergeTwoFunctions(Function *F, Function *G) {
 
     writeThunk(F, G);
     ++NumFunctionsMerged;
+    ++MergedCount;
   }
 }
 
@@ -814,17 +955,27 @@ void MergeFunctions::replaceFunctionInTree(const FunctionNode &FN,
 // Insert a ComparableFunction into the FnTree, or merge it away if equal to one
 // that was already inserted.
 bool MergeFunctions::insert(Function *NewFunction) {
-  std::pair<FnTreeType::iterator, bool> Result =
-      FnTree.insert(FunctionNode(NewFunction));
+  assert(FNodesInTree.count(NewFunction) == 0);
+
+  // The worklist is sorted, so the new function usually goes right after the
+  // last one inserted and the hint saves the lookup from the root.
+  FnTreeType::iterator Hint = FnTree.end();
+  if (LastInserted) {
+    auto I = FNodesInTree.find(cast<Function>(LastInserted));
+    if (I != FNodesInTree.end())
+      Hint = std::next(I->second);
+  }
+  FnTreeType::iterator Result = FnTree.insert(Hint, FunctionNode(NewFunction));
 
-  if (Result.second) {
-    assert(FNodesInTree.count(NewFunction) == 0);
-    FNodesInTree.insert({NewFunction, Result.first});
+  // An equal function already in the tree is not replaced.
+  if (Result->getFunc() == NewFunction) {
+    FNodesInTree.insert({NewFunction, Result});
+    LastInserted = NewFunction;
     DEBUG(dbgs() << "Inserting as unique: " << NewFunction->getName() << '\n');
     return false;
   }
 
-  const FunctionNode &OldF = *Result.first;
+  const FunctionNode &OldF = *Result;
 
   // Impose a total order (by name) on the replacement of functions. This is
   // important when operating on more than one module independently to prevent
@@ -836,7 +987,7 @@ bool MergeFunctions::insert(Function *NewFunction) {
        OldF.getFunc()->getName() > NewFunction->getName())) {
     // Swap the two functions.
     Function *F = OldF.getFunc();
-    replaceFunctionInTree(*Result.first, NewFunction);
+    replaceFunctionInTree(*Result, NewFunction);
     NewFunction = F;
     assert(OldF.getFunc() != F && "Must have swapped the functions.");
   }
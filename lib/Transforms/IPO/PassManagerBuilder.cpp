@@ -45,6 +45,10 @@ static cl::opt<bool>
     RunPartialInlining("enable-partial-inlining", cl::init(false), cl::Hidden,
                        cl::ZeroOrMore, cl::desc("Run Partial inlinining pass"));
 
+static cl::opt<bool>
+    RunHotColdSplitting("hot-cold-split", cl::init(false), cl::Hidden,
+                        cl::desc("Outline the cold regions of functions"));
+
 static cl::opt<bool>
     RunLoopVectorization("vectorize-loops", cl::Hidden,
                          cl::desc("Run the Loop vectorization passes"));
@@ -518,6 +522,10 @@ void PassManagerBuilder::populateModulePassManager(
   if (RunPartialInlining)
     MPM.add(createPartialInliningPass());
 
+  // Outline cold code once inlining is done, so that it is not inlined back.
+  if (RunHotColdSplitting)
+    MPM.add(createHotColdSplittingPass());
+
   if (OptLevel > 1 && !PrepareForLTO && !PrepareForThinLTO)
     // Remove avail extern fns and globals definitions if we aren't
     // compiling an object file for later LTO. For LTO we want to preserve
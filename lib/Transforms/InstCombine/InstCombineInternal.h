@@ -55,6 +55,7 @@ class DataLayout;
 class DominatorTree;
 class GEPOperator;
 class GlobalVariable;
+class KnownBitsCache;
 class LoopInfo;
 class OptimizationRemarkEmitter;
 class TargetLibraryInfo;
@@ -249,6 +250,11 @@ private:
   // combining and will be updated to reflect any changes.
   LoopInfo *LI;
 
+  // Optional cache for the recursive known bits queries. ValueTracking clears
+  // it at the start of every query, so it is never stale after a change to
+  // the IR.
+  KnownBitsCache *KBCache;
+
   bool MadeIRChange = false;
 
 public:
@@ -256,10 +262,10 @@ public:
                bool MinimizeSize, bool ExpensiveCombines, AliasAnalysis *AA,
                AssumptionCache &AC, TargetLibraryInfo &TLI, DominatorTree &DT,
                OptimizationRemarkEmitter &ORE, const DataLayout &DL,
-               LoopInfo *LI)
+               LoopInfo *LI, KnownBitsCache *KBCache = nullptr)
       : Worklist(Worklist), Builder(Builder), MinimizeSize(MinimizeSize),
         ExpensiveCombines(ExpensiveCombines), AA(AA), AC(AC), TLI(TLI), DT(DT),
-        DL(DL), SQ(DL, &TLI, &DT, &AC), ORE(ORE), LI(LI) {}
+        DL(DL), SQ(DL, &TLI, &DT, &AC), ORE(ORE), LI(LI), KBCache(KBCache) {}
 
   /// \brief Run the combiner over the entire worklist until it is empty.
   ///
@@ -569,12 +575,14 @@ public:
 
   void computeKnownBits(const Value *V, KnownBits &Known,
                         unsigned Depth, const Instruction *CxtI) const {
-    llvm::computeKnownBits(V, Known, DL, Depth, &AC, CxtI, &DT);
+    llvm::computeKnownBits(V, Known, DL, Depth, &AC, CxtI, &DT,
+                           /*ORE=*/nullptr, KBCache);
   }
 
   KnownBits computeKnownBits(const Value *V, unsigned Depth,
                              const Instruction *CxtI) const {
-    return llvm::computeKnownBits(V, DL, Depth, &AC, CxtI, &DT);
+    return llvm::computeKnownBits(V, DL, Depth, &AC, CxtI, &DT,
+                                  /*ORE=*/nullptr, KBCache);
   }
 
   bool isKnownToBeAPowerOfTwo(const Value *V, bool OrZero = false,
@@ -585,12 +593,13 @@ public:
 
   bool MaskedValueIsZero(const Value *V, const APInt &Mask, unsigned Depth = 0,
                          const Instruction *CxtI = nullptr) const {
-    return llvm::MaskedValueIsZero(V, Mask, DL, Depth, &AC, CxtI, &DT);
+    return llvm::MaskedValueIsZero(V, Mask, DL, Depth, &AC, CxtI, &DT,
+                                   KBCache);
   }
 
   unsigned ComputeNumSignBits(const Value *Op, unsigned Depth = 0,
                               const Instruction *CxtI = nullptr) const {
-    return llvm::ComputeNumSignBits(Op, DL, Depth, &AC, CxtI, &DT);
+    return llvm::ComputeNumSignBits(Op, DL, Depth, &AC, CxtI, &DT, KBCache);
   }
 
   OverflowResult computeOverflowForUnsignedMul(const Value *LHS,
@@ -614,6 +623,9 @@ public:
   /// Maximum size of array considered when transforming.
   uint64_t MaxArraySizeForCombine;
 
+  /// Number of instructions taken off the worklist by run().
+  unsigned VisitCount = 0;
+
 private:
   /// \brief Performs a few simplifications for operators which are associative
   /// or commutative.
@@ -51,6 +51,7 @@
 #include "llvm/Analysis/EHPersonalities.h"
 #include "llvm/Analysis/GlobalsModRef.h"
 #include "llvm/Analysis/InstructionSimplify.h"
+#include "llvm/Analysis/KnownBitsCache.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/MemoryBuiltins.h"
 #include "llvm/Analysis/OptimizationRemarkEmitter.h"
@@ -115,6 +116,14 @@ STATISTIC(NumSunkInst , "Number of instructions sunk");
 STATISTIC(NumExpand,    "Number of expansions");
 STATISTIC(NumFactor   , "Number of factorizations");
 STATISTIC(NumReassoc  , "Number of reassociations");
+STATISTIC(NumVisited  , "Number of instructions visited");
+STATISTIC(NumOneIteration, "Number of functions with one iteration");
+STATISTIC(NumTwoIterations, "Number of functions with two iterations");
+STATISTIC(NumThreeIterations, "Number of functions with three iterations");
+STATISTIC(NumFourOrMoreIterations,
+          "Number of functions with four or more iterations");
+STATISTIC(NumMissedFixpoint, "Number of functions where a later iteration "
+                             "found new work");
 DEBUG_COUNTER(VisitCounter, "instcombine-visit",
               "Controls which instructions are visited");
 
@@ -122,6 +131,12 @@ static cl::opt<bool>
 EnableExpensiveCombines("expensive-combines",
                         cl::desc("Enable expensive instruction combines"));
 
+static cl::opt<unsigned>
+MaxIterations("instcombine-max-iterations", cl::Hidden, cl::init(0),
+              cl::desc("Maximum number of sweeps over a function, or 0 to "
+                       "sweep until nothing changes. With 1, reaching the "
+                       "fixpoint relies on the worklist alone"));
+
 static cl::opt<unsigned>
 MaxArraySize("instcombine-maxarray-size", cl::init(1024),
              cl::desc("Maximum array size considered when doing a combine"));
@@ -136,6 +151,11 @@ MaxArraySize("instcombine-maxarray-size", cl::init(1024),
 static cl::opt<unsigned> ShouldLowerDbgDeclare("instcombine-lower-dbg-declare",
                                                cl::Hidden, cl::init(true));
 
+static cl::opt<bool>
+CacheKnownBits("instcombine-cache-known-bits", cl::Hidden, cl::init(false),
+               cl::desc("Memoize the recursive subqueries of each known "
+                        "bits query"));
+
 Value *InstCombiner::EmitGEPOffset(User *GEP) {
   return llvm::EmitGEPOffset(&Builder, DL, GEP);
 }
@@ -2931,6 +2951,8 @@ bool InstCombiner::run() {
   while (!Worklist.isEmpty()) {
     Instruction *I = Worklist.RemoveOne();
     if (I == nullptr) continue;  // skip null values.
+    ++NumVisited;
+    ++VisitCount;
 
     // Check to see if we can DCE the instruction.
     if (isInstructionTriviallyDead(I, &TLI)) {
@@ -3250,7 +3272,8 @@ static bool combineInstructionsOverFunction(
     MadeIRChange = LowerDbgDeclare(F);
 
   // Iterate while there is work to do.
-  int Iteration = 0;
+  unsigned Iteration = 0;
+  unsigned Visits = 0;
   while (true) {
     ++Iteration;
     DEBUG(dbgs() << "\n\nINSTCOMBINE ITERATION #" << Iteration << " on "
@@ -3258,14 +3281,53 @@ static bool combineInstructionsOverFunction(
 
     MadeIRChange |= prepareICWorklistFromFunction(F, DL, &TLI, Worklist);
 
+    KnownBitsCache KBCache;
     InstCombiner IC(Worklist, Builder, F.optForMinSize(), ExpensiveCombines, AA,
-                    AC, TLI, DT, ORE, DL, LI);
+                    AC, TLI, DT, ORE, DL, LI,
+                    CacheKnownBits ? &KBCache : nullptr);
     IC.MaxArraySizeForCombine = MaxArraySize;
 
-    if (!IC.run())
+    bool Changed = IC.run();
+    Visits += IC.VisitCount;
+    if (!Changed)
+      break;
+
+    // The worklist is seeded with the users and operands of every changed
+    // instruction, so any change found by a later sweep is a missed push.
+    if (Iteration > 1) {
+      ++NumMissedFixpoint;
+      ORE.emit([&]() {
+        return OptimizationRemarkMissed(DEBUG_TYPE, "MissedFixpoint",
+                                        F.getSubprogram(), &F.getEntryBlock())
+               << "iteration " << ore::NV("Iteration", Iteration)
+               << " found changes missed by the worklist";
+      });
+    }
+
+    if (MaxIterations && Iteration == MaxIterations) {
+      DEBUG(dbgs() << "\n\nINSTCOMBINE: stopping after " << Iteration
+                   << " iterations on " << F.getName() << "\n");
+      MadeIRChange = true;
       break;
+    }
   }
 
+  if (Iteration == 1)
+    ++NumOneIteration;
+  else if (Iteration == 2)
+    ++NumTwoIterations;
+  else if (Iteration == 3)
+    ++NumThreeIterations;
+  else
+    ++NumFourOrMoreIterations;
+
+  ORE.emit([&]() {
+    return OptimizationRemarkAnalysis(DEBUG_TYPE, "Fixpoint",
+                                      F.getSubprogram(), &F.getEntryBlock())
+           << "stopped after " << ore::NV("Iterations", Iteration)
+           << " iterations and " << ore::NV("Visits", Visits) << " visits";
+  });
+
   return MadeIRChange || Iteration > 1;
 }
 
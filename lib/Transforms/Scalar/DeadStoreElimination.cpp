@@ -18,6 +18,8 @@
 #include "llvm/Transforms/Scalar/DeadStoreElimination.h"
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
@@ -29,6 +31,9 @@
 #include "llvm/Analysis/MemoryBuiltins.h"
 #include "llvm/Analysis/MemoryDependenceAnalysis.h"
 #include "llvm/Analysis/MemoryLocation.h"
+#include "llvm/Analysis/MemorySSA.h"
+#include "llvm/Analysis/MemorySSAUpdater.h"
+#include "llvm/Analysis/PostDominators.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/Argument.h"
@@ -85,6 +90,15 @@ EnablePartialStoreMerging("enable-dse-partial-store-merging",
   cl::init(true), cl::Hidden,
   cl::desc("Enable partial store merging in DSE"));
 
+static cl::opt<bool>
+EnableMemorySSA("enable-dse-memoryssa", cl::init(false), cl::Hidden,
+  cl::desc("Use MemorySSA instead of MemoryDependenceAnalysis in DSE"));
+
+static cl::opt<unsigned>
+MemorySSAScanLimit("dse-memoryssa-scanlimit", cl::init(150), cl::Hidden,
+  cl::desc("The number of memory accesses to visit in the uses of a store "
+           "before giving up on it in MemorySSA-based DSE (default = 150)"));
+
 //===----------------------------------------------------------------------===//
 // Helper functions
 //===----------------------------------------------------------------------===//
@@ -1285,15 +1299,258 @@ static bool eliminateDeadStores(Function &F, AliasAnalysis *AA,
   return MadeChange;
 }
 
+//===----------------------------------------------------------------------===//
+// MemorySSA-based DSE
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+/// Dead store elimination on top of MemorySSA. Instead of scanning backwards
+/// from every store with MemoryDependenceAnalysis, walk forward over the
+/// MemorySSA uses of each write, looking for reads of the written location and
+/// for later writes that completely overwrite it. The walk visits at most
+/// MemorySSAScanLimit accesses per write.
+class MemorySSADSE {
+  Function &F;
+  AliasAnalysis &AA;
+  MemorySSA &MSSA;
+  MemorySSAUpdater Updater;
+  DominatorTree &DT;
+  PostDominatorTree &PDT;
+  const TargetLibraryInfo &TLI;
+  const DataLayout &DL;
+
+  /// Blocks that are part of a cycle in the CFG. The walk from a write in such
+  /// a block can come back to the write through a back edge, where alias
+  /// queries against its pointer may not hold across iterations.
+  SmallPtrSet<BasicBlock *, 16> CyclicBlocks;
+
+  /// Blocks containing an instruction that may throw.
+  SmallPtrSet<BasicBlock *, 16> ThrowingBlocks;
+
+  /// The instructions deleted so far.
+  SmallPtrSet<Instruction *, 16> Deleted;
+
+public:
+  MemorySSADSE(Function &F, AliasAnalysis &AA, MemorySSA &MSSA,
+               DominatorTree &DT, PostDominatorTree &PDT,
+               const TargetLibraryInfo &TLI)
+      : F(F), AA(AA), MSSA(MSSA), Updater(&MSSA), DT(DT), PDT(PDT), TLI(TLI),
+        DL(F.getParent()->getDataLayout()) {}
+
+  bool run();
+
+private:
+  bool isNoopStore(StoreInst *SI);
+  bool isDeadWrite(Instruction *I, const MemoryLocation &Loc);
+  bool mayThrowBetween(Instruction *Earlier, Instruction *Later);
+  void deleteDeadInstruction(Instruction *I);
+};
+
+} // end anonymous namespace
+
+/// Return true if \p SI stores back a value loaded from the same pointer, and
+/// nothing writes to it in between.
+bool MemorySSADSE::isNoopStore(StoreInst *SI) {
+  auto *LI = dyn_cast<LoadInst>(SI->getValueOperand());
+  if (!LI || LI->getPointerOperand() != SI->getPointerOperand() ||
+      !isRemovable(SI) || !DT.dominates(LI, SI))
+    return false;
+
+  // Both accesses are to the same location, so they have the same clobber if
+  // and only if nothing between them may write to it.
+  MemorySSAWalker *Walker = MSSA.getWalker();
+  return Walker->getClobberingMemoryAccess(SI) ==
+         Walker->getClobberingMemoryAccess(LI);
+}
+
+/// Return true if the memory \p I writes to \p Loc is never read: every
+/// path from \p I either ends the lifetime of the underlying stack object, or
+/// overwrites \p Loc before reading it.
+bool MemorySSADSE::isDeadWrite(Instruction *I, const MemoryLocation &Loc) {
+  BasicBlock *BB = I->getParent();
+  bool InCycle = CyclicBlocks.count(BB);
+
+  SmallVector<MemoryAccess *, 16> WorkList;
+  SmallPtrSet<MemoryAccess *, 16> Visited;
+  auto PushUsers = [&](MemoryAccess *MA) {
+    for (User *U : MA->users())
+      if (Visited.insert(cast<MemoryAccess>(U)).second)
+        WorkList.push_back(cast<MemoryAccess>(U));
+  };
+  PushUsers(MSSA.getMemoryAccess(I));
+
+  SmallVector<Instruction *, 4> KillingWrites;
+  unsigned NumVisited = 0;
+  while (!WorkList.empty()) {
+    MemoryAccess *MA = WorkList.pop_back_val();
+    if (++NumVisited > MemorySSAScanLimit)
+      return false;
+
+    if (isa<MemoryPhi>(MA)) {
+      if (InCycle)
+        return false;
+      PushUsers(MA);
+      continue;
+    }
+
+    Instruction *UseInst = cast<MemoryUseOrDef>(MA)->getMemoryInst();
+    if (isRefSet(AA.getModRefInfo(UseInst, Loc)))
+      return false;
+    if (isa<MemoryUse>(MA))
+      continue;
+
+    // Stop at writes that overwrite the whole location; anything reading it
+    // later reads the new value.
+    if (hasMemoryWrite(UseInst, TLI)) {
+      MemoryLocation LaterLoc = getLocForWrite(UseInst, AA);
+      int64_t EarlierOff = 0, LaterOff = 0;
+      InstOverlapIntervalsTy IOL;
+      if (LaterLoc.Ptr && isOverwrite(LaterLoc, Loc, DL, TLI, EarlierOff,
+                                      LaterOff, I, IOL) == OW_Complete) {
+        KillingWrites.push_back(UseInst);
+        continue;
+      }
+    }
+    PushUsers(MA);
+  }
+
+  // Nothing reads the location anymore, and stack objects die when the
+  // function returns or unwinds.
+  if (isa<AllocaInst>(GetUnderlyingObject(Loc.Ptr, DL)))
+    return true;
+
+  // Otherwise the caller may read the location, so it must be overwritten on
+  // all paths from I.
+  return any_of(KillingWrites, [&](Instruction *Later) {
+    return (Later->getParent() == BB || PDT.dominates(Later->getParent(), BB)) &&
+           !mayThrowBetween(I, Later);
+  });
+}
+
+/// Return true if an instruction may throw between \p Earlier and \p Later,
+/// which would let the caller observe the memory written by \p Earlier.
+bool MemorySSADSE::mayThrowBetween(Instruction *Earlier, Instruction *Later) {
+  if (ThrowingBlocks.empty())
+    return false;
+  if (Earlier->getParent() != Later->getParent())
+    return true;
+  for (Instruction *I = Earlier->getNextNode(); I != Later; I = I->getNextNode())
+    if (I->mayThrow())
+      return true;
+  return false;
+}
+
+void MemorySSADSE::deleteDeadInstruction(Instruction *I) {
+  SmallVector<Instruction *, 32> NowDeadInsts;
+
+  NowDeadInsts.push_back(I);
+  --NumFastOther;
+
+  do {
+    Instruction *DeadInst = NowDeadInsts.pop_back_val();
+    ++NumFastOther;
+
+    if (MemoryAccess *MA = MSSA.getMemoryAccess(DeadInst))
+      Updater.removeMemoryAccess(MA);
+
+    for (Use &Op : DeadInst->operands()) {
+      Value *V = Op.get();
+      Op.set(nullptr);
+
+      // If this operand just became dead, add it to the NowDeadInsts list.
+      if (!V->use_empty())
+        continue;
+
+      if (Instruction *OpI = dyn_cast<Instruction>(V))
+        if (isInstructionTriviallyDead(OpI, &TLI))
+          NowDeadInsts.push_back(OpI);
+    }
+
+    Deleted.insert(DeadInst);
+    DeadInst->eraseFromParent();
+  } while (!NowDeadInsts.empty());
+}
+
+bool MemorySSADSE::run() {
+  for (scc_iterator<Function *> I = scc_begin(&F); !I.isAtEnd(); ++I)
+    if (I.hasLoop())
+      CyclicBlocks.insert(I->begin(), I->end());
+
+  SmallVector<Instruction *, 64> Writes;
+  for (BasicBlock &BB : F) {
+    // Only check non-dead blocks.  Dead blocks may have strange pointer
+    // cycles that will confuse alias analysis.
+    if (!DT.isReachableFromEntry(&BB))
+      continue;
+    for (Instruction &I : BB) {
+      if (I.mayThrow())
+        ThrowingBlocks.insert(&BB);
+      if (hasMemoryWrite(&I, TLI) && isRemovable(&I) &&
+          dyn_cast_or_null<MemoryDef>(MSSA.getMemoryAccess(&I)))
+        Writes.push_back(&I);
+    }
+  }
+
+  bool MadeChange = false;
+  for (Instruction *I : Writes) {
+    if (Deleted.count(I))
+      continue;
+
+    if (auto *SI = dyn_cast<StoreInst>(I))
+      if (isNoopStore(SI)) {
+        DEBUG(dbgs() << "DSE: Remove Store Of Load from same pointer:\n  STORE: "
+                     << *SI << '\n');
+        deleteDeadInstruction(SI);
+        ++NumRedundantStores;
+        MadeChange = true;
+        continue;
+      }
+
+    MemoryLocation Loc = getLocForWrite(I, AA);
+    if (!Loc.Ptr || Loc.Size == MemoryLocation::UnknownSize)
+      continue;
+
+    if (isDeadWrite(I, Loc)) {
+      DEBUG(dbgs() << "DSE: Remove Dead Store:\n  DEAD: " << *I << '\n');
+      deleteDeadInstruction(I);
+      ++NumFastStores;
+      MadeChange = true;
+    }
+  }
+
+  return MadeChange;
+}
+
+static bool eliminateDeadStoresMemorySSA(Function &F, AliasAnalysis &AA,
+                                         MemorySSA &MSSA, DominatorTree &DT,
+                                         PostDominatorTree &PDT,
+                                         const TargetLibraryInfo &TLI) {
+  return MemorySSADSE(F, AA, MSSA, DT, PDT, TLI).run();
+}
+
 //===----------------------------------------------------------------------===//
 // DSE Pass
 //===----------------------------------------------------------------------===//
 PreservedAnalyses DSEPass::run(Function &F, FunctionAnalysisManager &AM) {
   AliasAnalysis *AA = &AM.getResult<AAManager>(F);
   DominatorTree *DT = &AM.getResult<DominatorTreeAnalysis>(F);
-  MemoryDependenceResults *MD = &AM.getResult<MemoryDependenceAnalysis>(F);
   const TargetLibraryInfo *TLI = &AM.getResult<TargetLibraryAnalysis>(F);
 
+  if (EnableMemorySSA) {
+    MemorySSA &MSSA = AM.getResult<MemorySSAAnalysis>(F).getMSSA();
+    PostDominatorTree &PDT = AM.getResult<PostDominatorTreeAnalysis>(F);
+    if (!eliminateDeadStoresMemorySSA(F, *AA, MSSA, *DT, PDT, *TLI))
+      return PreservedAnalyses::all();
+
+    PreservedAnalyses PA;
+    PA.preserveSet<CFGAnalyses>();
+    PA.preserve<GlobalsAA>();
+    PA.preserve<MemorySSAAnalysis>();
+    return PA;
+  }
+
+  MemoryDependenceResults *MD = &AM.getResult<MemoryDependenceAnalysis>(F);
   if (!eliminateDeadStores(F, AA, MD, DT, TLI))
     return PreservedAnalyses::all();
 
@@ -1321,11 +1578,18 @@ public:
 
     DominatorTree *DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
     AliasAnalysis *AA = &getAnalysis<AAResultsWrapperPass>().getAAResults();
-    MemoryDependenceResults *MD =
-        &getAnalysis<MemoryDependenceWrapperPass>().getMemDep();
     const TargetLibraryInfo *TLI =
         &getAnalysis<TargetLibraryInfoWrapperPass>().getTLI();
 
+    if (EnableMemorySSA) {
+      MemorySSA &MSSA = getAnalysis<MemorySSAWrapperPass>().getMSSA();
+      PostDominatorTree &PDT =
+          getAnalysis<PostDominatorTreeWrapperPass>().getPostDomTree();
+      return eliminateDeadStoresMemorySSA(F, *AA, MSSA, *DT, PDT, *TLI);
+    }
+
+    MemoryDependenceResults *MD =
+        &getAnalysis<MemoryDependenceWrapperPass>().getMemDep();
     return eliminateDeadStores(F, AA, MD, DT, TLI);
   }
 
@@ -1333,11 +1597,18 @@ public:
     AU.setPreservesCFG();
     AU.addRequired<DominatorTreeWrapperPass>();
     AU.addRequired<AAResultsWrapperPass>();
-    AU.addRequired<MemoryDependenceWrapperPass>();
     AU.addRequired<TargetLibraryInfoWrapperPass>();
     AU.addPreserved<DominatorTreeWrapperPass>();
     AU.addPreserved<GlobalsAAWrapperPass>();
-    AU.addPreserved<MemoryDependenceWrapperPass>();
+    if (EnableMemorySSA) {
+      AU.addRequired<MemorySSAWrapperPass>();
+      AU.addRequired<PostDominatorTreeWrapperPass>();
+      AU.addPreserved<MemorySSAWrapperPass>();
+      AU.addPreserved<PostDominatorTreeWrapperPass>();
+    } else {
+      AU.addRequired<MemoryDependenceWrapperPass>();
+      AU.addPreserved<MemoryDependenceWrapperPass>();
+    }
   }
 };
 
@@ -1351,6 +1622,8 @@ INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(AAResultsWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(GlobalsAAWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(MemoryDependenceWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(MemorySSAWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(PostDominatorTreeWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(TargetLibraryInfoWrapperPass)
 INITIALIZE_PASS_END(DSELegacyPass, "dse", "Dead Store Elimination", false,
                     false)
@@ -136,6 +136,7 @@ namespace {
       AU.addRequired<AAResultsWrapperPass>();
       AU.addRequired<LazyValueInfoWrapperPass>();
       AU.addPreserved<GlobalsAAWrapperPass>();
+      AU.addPreserved<LazyValueInfoWrapperPass>();
       AU.addRequired<TargetLibraryInfoWrapperPass>();
     }
 
@@ -320,6 +321,7 @@ PreservedAnalyses JumpThreadingPass::run(Function &F,
     return PreservedAnalyses::all();
   PreservedAnalyses PA;
   PA.preserve<GlobalsAA>();
+  PA.preserve<LazyValueAnalysis>();
   return PA;
 }
 
@@ -332,6 +334,10 @@ bool JumpThreadingPass::runImpl(Function &F, TargetLibraryInfo *TLI_,
   TLI = TLI_;
   LVI = LVI_;
   AA = AA_;
+  // LVI is kept up to date through eraseBlock and threadEdge below, and is
+  // preserved for the passes that follow. The dominator tree isn't updated, so
+  // LVI must not use it.
+  LVI->setDominatorTree(nullptr);
   BFI.reset();
   BPI.reset();
   // When profile data is available, we need to update edge weights after
@@ -0,0 +1,463 @@
+//===- LoopFuse.cpp - Loop Fusion Pass ------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the Loop Fusion Pass. It fuses chains of adjacent
+// innermost loops that iterate the same number of times, such as the
+// successive loops over the same arrays of many numerical kernels, so that
+// the data produced by one loop is consumed while still in cache and the loop
+// overhead is paid once.
+//
+// Two loops are fused when:
+//  - they are adjacent: the exit block of the first loop is the preheader of
+//    the second one and holds nothing but a branch, so the second loop runs
+//    exactly when the first one does;
+//  - both are in loop-simplify form, exit only from their latch and access
+//    memory only through simple loads and stores;
+//  - ScalarEvolution computes the same backedge-taken count for both;
+//  - no dependence flows from an iteration of the first loop to an earlier
+//    iteration of the second one, since the fused loop runs the latter first.
+//    Pairs of accesses are checked with DependenceAnalysis, and with the
+//    distance between their SCEV add recurrences when it cannot prove them
+//    independent;
+//  - the fused loop does not keep more values live than the target has
+//    registers.
+//
+// Each iteration of the fused loop runs the body of the first loop and then
+// the body of the second one. The induction variables of the two loops are
+// left for IndVarSimplify to merge.
+//
+// Loops guarded by their own trip count checks are not fused yet.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Scalar/LoopFuse.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/DependenceAnalysis.h"
+#include "llvm/Analysis/GlobalsModRef.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Local.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "loop-fusion"
+
+STATISTIC(NumLoopsFused, "Number of loops fused");
+STATISTIC(NumCandidates, "Number of pairs of adjacent loops considered");
+STATISTIC(NumNotConforming, "Number of pairs not in a form fusion handles");
+STATISTIC(NumTripCountMismatch, "Number of pairs with different trip counts");
+STATISTIC(NumDependencePrevented,
+          "Number of pairs not fused because of a dependence");
+STATISTIC(NumRegisterPressure,
+          "Number of pairs not fused because of register pressure");
+
+static cl::opt<unsigned> RegisterBudget(
+    "loop-fusion-register-budget", cl::init(0), cl::Hidden,
+    cl::desc("Number of registers of each class the fused loop may keep "
+             "occupied (0 uses the register count of the target)"));
+
+namespace {
+
+/// Number of registers of each class that the body of a loop keeps occupied
+/// from one iteration to the next.
+struct RegisterPressure {
+  unsigned Scalar = 0;
+  unsigned Vector = 0;
+};
+
+class LoopFuser {
+public:
+  LoopFuser(Function &F, LoopInfo &LI, DominatorTree &DT, ScalarEvolution &SE,
+            DependenceInfo &DI, const TargetTransformInfo &TTI)
+      : F(F), LI(LI), DT(DT), SE(SE), DI(DI), TTI(TTI),
+        DL(F.getParent()->getDataLayout()) {}
+
+  bool run();
+
+private:
+  Loop *getAdjacentLoop(Loop *L);
+  bool isConforming(Loop *L, SmallVectorImpl<Instruction *> &MemInsts) const;
+  bool dependenceAllowsFusion(Instruction *I1, Loop *L1, Instruction *I2,
+                              Loop *L2);
+  bool registerPressureAllowsFusion(Loop *L1, Loop *L2) const;
+  bool canFuse(Loop *L1, Loop *L2);
+  void fuse(Loop *L1, Loop *L2);
+
+  Function &F;
+  LoopInfo &LI;
+  DominatorTree &DT;
+  ScalarEvolution &SE;
+  DependenceInfo &DI;
+  const TargetTransformInfo &TTI;
+  const DataLayout &DL;
+};
+
+} // end anonymous namespace
+
+static Value *getPointerOperand(Instruction *I) {
+  if (auto *Load = dyn_cast<LoadInst>(I))
+    return Load->getPointerOperand();
+  return cast<StoreInst>(I)->getPointerOperand();
+}
+
+/// Count the registers that \p Loops, run as a single loop, keep occupied:
+/// one for each value carried by a header phi, and one for each value defined
+/// outside of the loops and used inside.
+static RegisterPressure estimateRegisterPressure(ArrayRef<Loop *> Loops) {
+  auto IsInLoops = [&](const Instruction *I) {
+    return any_of(Loops, [&](const Loop *L) { return L->contains(I); });
+  };
+
+  SmallPtrSet<const Value *, 16> LiveThrough;
+  for (Loop *L : Loops)
+    for (BasicBlock *BB : L->blocks())
+      for (Instruction &I : *BB) {
+        if (isa<PHINode>(I) && BB == L->getHeader()) {
+          LiveThrough.insert(&I);
+          continue;
+        }
+        for (Value *Op : I.operands())
+          if (isa<Argument>(Op) ||
+              (isa<Instruction>(Op) && !IsInLoops(cast<Instruction>(Op))))
+            LiveThrough.insert(Op);
+      }
+
+  RegisterPressure RP;
+  for (const Value *V : LiveThrough)
+    if (V->getType()->isVectorTy() || V->getType()->isFloatingPointTy())
+      ++RP.Vector;
+    else
+      ++RP.Scalar;
+  return RP;
+}
+
+/// Return the loop that runs right after \p L exits, if \p L exits into its
+/// preheader and nothing else runs in between.
+Loop *LoopFuser::getAdjacentLoop(Loop *L) {
+  BasicBlock *Exit = L->getExitBlock();
+  if (!Exit || &Exit->front() != Exit->getTerminator())
+    return nullptr;
+  BasicBlock *Succ = Exit->getSingleSuccessor();
+  if (!Succ)
+    return nullptr;
+  Loop *Next = LI.getLoopFor(Succ);
+  if (!Next || Next->getHeader() != Succ ||
+      Next->getLoopPreheader() != Exit ||
+      Next->getParentLoop() != L->getParentLoop())
+    return nullptr;
+  return Next;
+}
+
+/// Check that \p L has a shape fusion handles, and collect its memory
+/// accesses in \p MemInsts.
+bool LoopFuser::isConforming(Loop *L,
+                             SmallVectorImpl<Instruction *> &MemInsts) const {
+  if (!L->empty() || !L->isLoopSimplifyForm())
+    return false;
+  BasicBlock *Latch = L->getLoopLatch();
+  if (L->getExitingBlock() != Latch || !L->getExitBlock())
+    return false;
+  auto *BI = dyn_cast<BranchInst>(Latch->getTerminator());
+  if (!BI || !BI->isConditional())
+    return false;
+
+  for (BasicBlock *BB : L->blocks())
+    for (Instruction &I : *BB) {
+      if (isa<DbgInfoIntrinsic>(I))
+        continue;
+      if (auto *Load = dyn_cast<LoadInst>(&I)) {
+        if (!Load->isSimple())
+          return false;
+        MemInsts.push_back(Load);
+      } else if (auto *Store = dyn_cast<StoreInst>(&I)) {
+        if (!Store->isSimple())
+          return false;
+        MemInsts.push_back(Store);
+      } else if (I.mayReadOrWriteMemory() || I.mayHaveSideEffects()) {
+        return false;
+      }
+    }
+  return true;
+}
+
+/// Return true if fusing \p L1 and \p L2 preserves the dependences between
+/// \p I1 in the former and \p I2 in the latter. The fused loop runs iteration
+/// j of \p L2 before iteration i of \p L1 whenever j < i, so the two accesses
+/// must not touch the same memory in such iterations.
+bool LoopFuser::dependenceAllowsFusion(Instruction *I1, Loop *L1,
+                                       Instruction *I2, Loop *L2) {
+  if (!DI.depends(I1, I2, /* PossiblyLoopIndependent */ true))
+    return true;
+
+  Value *Ptr1 = getPointerOperand(I1);
+  Value *Ptr2 = getPointerOperand(I2);
+  auto *PtrTy1 = cast<PointerType>(Ptr1->getType());
+  auto *PtrTy2 = cast<PointerType>(Ptr2->getType());
+  if (PtrTy1->getAddressSpace() != PtrTy2->getAddressSpace())
+    return false;
+  uint64_t Size = DL.getTypeStoreSize(PtrTy1->getElementType());
+  if (Size != DL.getTypeStoreSize(PtrTy2->getElementType()))
+    return false;
+
+  const SCEV *S1 = SE.getSCEV(Ptr1);
+  const SCEV *S2 = SE.getSCEV(Ptr2);
+
+  // Accesses to a fixed address conflict in every pair of iterations, unless
+  // they do not overlap at all.
+  if (SE.isLoopInvariant(S1, L1) && SE.isLoopInvariant(S2, L2)) {
+    auto *Dist = dyn_cast<SCEVConstant>(SE.getMinusSCEV(S2, S1));
+    return Dist && Dist->getAPInt().abs().uge(Size);
+  }
+
+  auto *AR1 = dyn_cast<SCEVAddRecExpr>(S1);
+  auto *AR2 = dyn_cast<SCEVAddRecExpr>(S2);
+  if (!AR1 || !AR2 || AR1->getLoop() != L1 || AR2->getLoop() != L2 ||
+      !AR1->isAffine() || !AR2->isAffine())
+    return false;
+  auto *Step1 = dyn_cast<SCEVConstant>(AR1->getStepRecurrence(SE));
+  auto *Step2 = dyn_cast<SCEVConstant>(AR2->getStepRecurrence(SE));
+  if (!Step1 || Step1 != Step2 || Step1->isZero())
+    return false;
+  auto *Dist = dyn_cast<SCEVConstant>(
+      SE.getMinusSCEV(AR2->getStart(), AR1->getStart()));
+  if (!Dist)
+    return false;
+
+  // I1 in iteration i and I2 in iteration j overlap when
+  //   |Start1 + i * Step - (Start2 + j * Step)| < Size.
+  // With Dist = Start2 - Start1 and a positive Step, this happens for some
+  // i > j exactly when Dist > Step - Size. A negative Step is the mirror case.
+  int64_t Step = Step1->getAPInt().getSExtValue();
+  int64_t Distance = Dist->getAPInt().getSExtValue();
+  if (Step < 0) {
+    Step = -Step;
+    Distance = -Distance;
+  }
+  return Distance <= Step - int64_t(Size);
+}
+
+bool LoopFuser::registerPressureAllowsFusion(Loop *L1, Loop *L2) const {
+  RegisterPressure RP = estimateRegisterPressure({L1, L2});
+  unsigned ScalarRegs =
+      RegisterBudget ? RegisterBudget : TTI.getNumberOfRegisters(false);
+  unsigned VectorRegs =
+      RegisterBudget ? RegisterBudget : TTI.getNumberOfRegisters(true);
+  DEBUG(dbgs() << "LF: Fused loop keeps " << RP.Scalar << "/" << ScalarRegs
+               << " scalar and " << RP.Vector << "/" << VectorRegs
+               << " vector registers occupied\n");
+  return RP.Scalar <= ScalarRegs && (!VectorRegs || RP.Vector <= VectorRegs);
+}
+
+bool LoopFuser::canFuse(Loop *L1, Loop *L2) {
+  ++NumCandidates;
+  DEBUG(dbgs() << "LF: Considering " << L1->getHeader()->getName() << " and "
+               << L2->getHeader()->getName() << "\n");
+
+  SmallVector<Instruction *, 16> MemInsts1, MemInsts2;
+  if (!isConforming(L1, MemInsts1) || !isConforming(L2, MemInsts2)) {
+    DEBUG(dbgs() << "LF: Loops not in a form fusion handles\n");
+    ++NumNotConforming;
+    return false;
+  }
+
+  const SCEV *TripCount1 = SE.getBackedgeTakenCount(L1);
+  if (isa<SCEVCouldNotCompute>(TripCount1) ||
+      TripCount1 != SE.getBackedgeTakenCount(L2)) {
+    DEBUG(dbgs() << "LF: Trip counts differ or are unknown\n");
+    ++NumTripCountMismatch;
+    return false;
+  }
+
+  // The second loop would see the values of the first loop as they are in the
+  // current iteration rather than in the last one. In LCSSA form, such uses go
+  // through phis in the exit block of the first loop, which is empty.
+  for (BasicBlock *BB : L2->blocks())
+    for (Instruction &I : *BB)
+      for (Value *Op : I.operands())
+        if (auto *OpI = dyn_cast<Instruction>(Op))
+          if (L1->contains(OpI)) {
+            DEBUG(dbgs() << "LF: Second loop uses " << *OpI << "\n");
+            ++NumNotConforming;
+            return false;
+          }
+
+  for (Instruction *I1 : MemInsts1)
+    for (Instruction *I2 : MemInsts2) {
+      if (isa<LoadInst>(I1) && isa<LoadInst>(I2))
+        continue;
+      if (!dependenceAllowsFusion(I1, L1, I2, L2)) {
+        DEBUG(dbgs() << "LF: Fusion would reverse a dependence between "
+                     << *I1 << " and " << *I2 << "\n");
+        ++NumDependencePrevented;
+        return false;
+      }
+    }
+
+  if (!registerPressureAllowsFusion(L1, L2)) {
+    ++NumRegisterPressure;
+    return false;
+  }
+  return true;
+}
+
+/// Fuse \p L2 into \p L1, which keeps its header and preheader and takes the
+/// latch and exit of \p L2.
+void LoopFuser::fuse(Loop *L1, Loop *L2) {
+  BasicBlock *Preheader1 = L1->getLoopPreheader();
+  BasicBlock *Header1 = L1->getHeader();
+  BasicBlock *Latch1 = L1->getLoopLatch();
+  BasicBlock *Between = L2->getLoopPreheader();
+  BasicBlock *Header2 = L2->getHeader();
+  BasicBlock *Latch2 = L2->getLoopLatch();
+  SE.forgetLoop(L1);
+  SE.forgetLoop(L2);
+
+  // The back edge of the fused loop is the one of the second loop, and the
+  // header phis of the second loop move to the fused header.
+  Latch1->replaceSuccessorsPhiUsesWith(Latch2);
+  Instruction *InsertPt = &*Header1->getFirstInsertionPt();
+  while (auto *PN = dyn_cast<PHINode>(&Header2->front())) {
+    PN->setIncomingBlock(PN->getBasicBlockIndex(Between), Preheader1);
+    PN->moveBefore(InsertPt);
+  }
+
+  // Each iteration runs the body of the first loop, then the one of the
+  // second loop.
+  auto *Br1 = cast<BranchInst>(Latch1->getTerminator());
+  Value *Cond1 = Br1->getCondition();
+  BranchInst::Create(Header2, Br1);
+  Br1->eraseFromParent();
+  RecursivelyDeleteTriviallyDeadInstructions(Cond1);
+
+  auto *Br2 = cast<BranchInst>(Latch2->getTerminator());
+  for (unsigned I = 0, E = Br2->getNumSuccessors(); I != E; ++I)
+    if (Br2->getSuccessor(I) == Header2)
+      Br2->setSuccessor(I, Header1);
+
+  LI.removeBlock(Between);
+  DeleteDeadBlock(Between);
+
+  for (BasicBlock *BB : L2->blocks()) {
+    L1->addBlockEntry(BB);
+    LI.changeLoopFor(BB, L1);
+  }
+  if (Loop *Parent = L2->getParentLoop())
+    Parent->removeChildLoop(L2);
+  else
+    LI.removeLoop(llvm::find(LI, L2));
+  LI.destroy(L2);
+
+  DT.recalculate(F);
+}
+
+bool LoopFuser::run() {
+  bool Changed = false;
+  SmallPtrSet<Loop *, 8> FusedAway;
+  for (Loop *L1 : LI.getLoopsInPreorder()) {
+    if (FusedAway.count(L1))
+      continue;
+    // Fuse the whole chain of loops that follow L1.
+    while (Loop *L2 = getAdjacentLoop(L1)) {
+      if (!canFuse(L1, L2))
+        break;
+      DEBUG(dbgs() << "LF: Fusing " << L2->getHeader()->getName() << " into "
+                   << L1->getHeader()->getName() << "\n");
+      fuse(L1, L2);
+      FusedAway.insert(L2);
+      ++NumLoopsFused;
+      Changed = true;
+    }
+  }
+  return Changed;
+}
+
+namespace {
+
+class LoopFuseLegacy : public FunctionPass {
+public:
+  static char ID;
+
+  LoopFuseLegacy() : FunctionPass(ID) {
+    initializeLoopFuseLegacyPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnFunction(Function &F) override {
+    if (skipFunction(F))
+      return false;
+
+    auto &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+    auto &DT = getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+    auto &SE = getAnalysis<ScalarEvolutionWrapperPass>().getSE();
+    auto &DI = getAnalysis<DependenceAnalysisWrapperPass>().getDI();
+    auto &TTI = getAnalysis<TargetTransformInfoWrapperPass>().getTTI(F);
+    return LoopFuser(F, LI, DT, SE, DI, TTI).run();
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.addPreserved<LoopInfoWrapperPass>();
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addPreserved<DominatorTreeWrapperPass>();
+    AU.addRequired<ScalarEvolutionWrapperPass>();
+    AU.addPreserved<ScalarEvolutionWrapperPass>();
+    AU.addRequired<DependenceAnalysisWrapperPass>();
+    AU.addRequired<TargetTransformInfoWrapperPass>();
+    AU.addPreserved<GlobalsAAWrapperPass>();
+  }
+};
+
+} // end anonymous namespace
+
+PreservedAnalyses LoopFusePass::run(Function &F, FunctionAnalysisManager &AM) {
+  auto &LI = AM.getResult<LoopAnalysis>(F);
+  auto &DT = AM.getResult<DominatorTreeAnalysis>(F);
+  auto &SE = AM.getResult<ScalarEvolutionAnalysis>(F);
+  auto &DI = AM.getResult<DependenceAnalysis>(F);
+  auto &TTI = AM.getResult<TargetIRAnalysis>(F);
+
+  if (!LoopFuser(F, LI, DT, SE, DI, TTI).run())
+    return PreservedAnalyses::all();
+  PreservedAnalyses PA;
+  PA.preserve<LoopAnalysis>();
+  PA.preserve<DominatorTreeAnalysis>();
+  PA.preserve<ScalarEvolutionAnalysis>();
+  PA.preserve<GlobalsAA>();
+  return PA;
+}
+
+char LoopFuseLegacy::ID = 0;
+
+INITIALIZE_PASS_BEGIN(LoopFuseLegacy, "loop-fusion", "Loop Fusion", false,
+                      false)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolutionWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(DependenceAnalysisWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(TargetTransformInfoWrapperPass)
+INITIALIZE_PASS_END(LoopFuseLegacy, "loop-fusion", "Loop Fusion", false, false)
+
+FunctionPass *llvm::createLoopFusePass() { return new LoopFuseLegacy(); }
@@ -0,0 +1,522 @@
+//===- LoopTiling.cpp - Loop Tiling Pass ----------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the Loop Tiling Pass. Each loop of a perfect loop nest
+// is strip-mined into a tile loop, which steps over the iteration space by
+// tiles, and a point loop, which runs the iterations of one tile. The tile
+// loops are placed outside of all the point loops, so that the nest runs tile
+// by tile:
+//
+//   for (i = 0; i < N; i++)          for (ii = 0; ii < N; ii += T)
+//     for (j = 0; j < M; j++)    =>    for (jj = 0; jj < M; jj += T)
+//       body(i, j);                      for (i = ii; i < min(ii + T, N); i++)
+//                                          for (j = jj; j < min(jj + T, M); j++)
+//                                            body(i, j);
+//
+// Only the innermost loop of the nest may access memory. Its loops must be
+// rotated, in loop-simplify form, and have a trip count that does not vary
+// within the nest, so that the tiles are rectangular. Tiling is legal when
+// DependenceAnalysis shows that no dependence is carried forward by a loop of
+// the nest and backward by another one.
+//
+// The tile size comes from the L1 data cache parameters that the target
+// reports through TargetTransformInfo: a square tile of each array accessed
+// in the nest should fit in half of the cache, and a side of the tile should
+// cover whole cache lines.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Scalar/LoopTiling.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/DependenceAnalysis.h"
+#include "llvm/Analysis/GlobalsModRef.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpander.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "loop-tiling"
+
+STATISTIC(NumNestsTiled, "Number of loop nests tiled");
+STATISTIC(NumLoopsStripMined, "Number of loops strip-mined");
+STATISTIC(NumDependencePrevented,
+          "Number of nests not tiled because of a dependence");
+STATISTIC(NumFitInCache, "Number of nests not tiled as they fit in a tile");
+
+static cl::opt<unsigned> TileSize(
+    "loop-tile-size", cl::init(0), cl::Hidden,
+    cl::desc("Number of iterations of each loop in a tile (0 derives it from "
+             "the data cache parameters of the target)"));
+
+namespace {
+
+/// A loop of a perfect nest.
+struct NestLevel {
+  Loop *L = nullptr;
+  /// The induction variable of L, which starts at a value invariant in the
+  /// nest and is incremented by one.
+  PHINode *IV = nullptr;
+  /// The number of iterations of L, in the type of IV.
+  const SCEV *TripCount = nullptr;
+};
+
+class LoopTiling {
+public:
+  LoopTiling(Function &F, LoopInfo &LI, DominatorTree &DT, ScalarEvolution &SE,
+             DependenceInfo &DI, const TargetTransformInfo &TTI)
+      : F(F), LI(LI), DT(DT), SE(SE), DI(DI), TTI(TTI),
+        DL(F.getParent()->getDataLayout()) {}
+
+  bool run();
+
+private:
+  bool analyzeLevel(Loop *L, Loop *Outermost, NestLevel &Level) const;
+  bool analyzeNest(Loop *Outermost, SmallVectorImpl<NestLevel> &Nest,
+                   SmallVectorImpl<Instruction *> &MemInsts) const;
+  bool dependencesAllowTiling(ArrayRef<NestLevel> Nest,
+                              ArrayRef<Instruction *> MemInsts);
+  unsigned getTileSize(ArrayRef<Instruction *> MemInsts) const;
+  void tile(ArrayRef<NestLevel> Nest, unsigned Size);
+
+  Function &F;
+  LoopInfo &LI;
+  DominatorTree &DT;
+  ScalarEvolution &SE;
+  DependenceInfo &DI;
+  const TargetTransformInfo &TTI;
+  const DataLayout &DL;
+};
+
+} // end anonymous namespace
+
+static Value *getPointerOperand(Instruction *I) {
+  if (auto *Load = dyn_cast<LoadInst>(I))
+    return Load->getPointerOperand();
+  return cast<StoreInst>(I)->getPointerOperand();
+}
+
+/// Check that \p L, a loop of the nest rooted at \p Outermost, is a rotated
+/// loop with a canonical induction variable and a trip count invariant in the
+/// nest, and describe it in \p Level.
+bool LoopTiling::analyzeLevel(Loop *L, Loop *Outermost,
+                              NestLevel &Level) const {
+  if (!L->isLoopSimplifyForm() || !L->getExitBlock() ||
+      L->getExitingBlock() != L->getLoopLatch())
+    return false;
+  auto *BI = dyn_cast<BranchInst>(L->getLoopLatch()->getTerminator());
+  if (!BI || !BI->isConditional())
+    return false;
+
+  const SCEV *BackedgeTakenCount = SE.getBackedgeTakenCount(L);
+  if (isa<SCEVCouldNotCompute>(BackedgeTakenCount) ||
+      !SE.isLoopInvariant(BackedgeTakenCount, Outermost))
+    return false;
+  const SCEV *TripCount = SE.getAddExpr(
+      BackedgeTakenCount, SE.getOne(BackedgeTakenCount->getType()));
+  if (!isSafeToExpand(TripCount, SE))
+    return false;
+
+  for (PHINode &PN : L->getHeader()->phis()) {
+    if (PN.getType() != TripCount->getType())
+      continue;
+    auto *AR = dyn_cast<SCEVAddRecExpr>(SE.getSCEV(&PN));
+    if (!AR || AR->getLoop() != L || !AR->isAffine() ||
+        !AR->getStepRecurrence(SE)->isOne() ||
+        !SE.isLoopInvariant(AR->getStart(), Outermost))
+      continue;
+    Level.L = L;
+    Level.IV = &PN;
+    Level.TripCount = TripCount;
+    return true;
+  }
+  return false;
+}
+
+/// Check that \p Outermost is the root of a perfect nest, at least two loops
+/// deep, that tiling handles. Collect the loops of the nest in \p Nest and the
+/// memory accesses of its innermost loop in \p MemInsts.
+bool LoopTiling::analyzeNest(Loop *Outermost, SmallVectorImpl<NestLevel> &Nest,
+                             SmallVectorImpl<Instruction *> &MemInsts) const {
+  for (Loop *L = Outermost;; L = *L->begin()) {
+    NestLevel Level;
+    if (!analyzeLevel(L, Outermost, Level))
+      return false;
+    Nest.push_back(Level);
+
+    if (L->empty()) {
+      for (BasicBlock *BB : L->blocks())
+        for (Instruction &I : *BB) {
+          if (isa<DbgInfoIntrinsic>(I))
+            continue;
+          if (isa<PHINode>(I) && BB == L->getHeader() && &I != Level.IV)
+            return false;
+          if (auto *Load = dyn_cast<LoadInst>(&I)) {
+            if (!Load->isSimple())
+              return false;
+            MemInsts.push_back(Load);
+          } else if (auto *Store = dyn_cast<StoreInst>(&I)) {
+            if (!Store->isSimple())
+              return false;
+            MemInsts.push_back(Store);
+          } else if (I.mayReadOrWriteMemory() || I.mayHaveSideEffects()) {
+            return false;
+          }
+        }
+      break;
+    }
+
+    // The inner loop runs to completion in every iteration of L, and the rest
+    // of L only computes values without side effects.
+    if (L->getSubLoops().size() != 1)
+      return false;
+    Loop *Inner = *L->begin();
+    for (BasicBlock *BB : L->blocks()) {
+      if (Inner->contains(BB))
+        continue;
+      if (BB != L->getLoopLatch() && !BB->getSingleSuccessor())
+        return false;
+      for (Instruction &I : *BB)
+        if ((isa<PHINode>(I) && &I != Level.IV) ||
+            I.mayReadOrWriteMemory() || I.mayHaveSideEffects())
+          return false;
+    }
+  }
+  if (Nest.size() < 2 || MemInsts.empty())
+    return false;
+
+  // After tiling, a loop stops at the end of a tile rather than after its last
+  // iteration, so its values must not be used outside of it.
+  for (BasicBlock *BB : Outermost->blocks()) {
+    Loop *Owner = LI.getLoopFor(BB);
+    for (Instruction &I : *BB)
+      for (User *U : I.users())
+        if (!Owner->contains(cast<Instruction>(U)))
+          return false;
+  }
+  return true;
+}
+
+/// Tiling runs the iterations of the nest in a different order. This preserves
+/// a dependence only if it is carried forward along all the loops of the nest
+/// at once, or backward along all of them, as a dependence carried forward by
+/// a loop and backward by another one could be reversed.
+bool LoopTiling::dependencesAllowTiling(ArrayRef<NestLevel> Nest,
+                                        ArrayRef<Instruction *> MemInsts) {
+  unsigned First = Nest.front().L->getLoopDepth();
+  unsigned Last = Nest.back().L->getLoopDepth();
+  for (unsigned I = 0, E = MemInsts.size(); I != E; ++I)
+    for (unsigned J = I; J != E; ++J) {
+      Instruction *Src = MemInsts[I];
+      Instruction *Dst = MemInsts[J];
+      if (isa<LoadInst>(Src) && isa<LoadInst>(Dst))
+        continue;
+      auto D = DI.depends(Src, Dst, /* PossiblyLoopIndependent */ true);
+      if (!D)
+        continue;
+      if (D->isConfused() || D->getLevels() < Last) {
+        DEBUG(dbgs() << "LT: Unknown dependence between " << *Src << " and "
+                     << *Dst << "\n");
+        return false;
+      }
+      bool MayBeForward = false, MayBeBackward = false;
+      for (unsigned Level = First; Level <= Last; ++Level) {
+        unsigned Direction = D->getDirection(Level);
+        bool Forward = Direction & Dependence::DVEntry::LT;
+        bool Backward = Direction & Dependence::DVEntry::GT;
+        if ((Forward && MayBeBackward) || (Backward && MayBeForward)) {
+          DEBUG(dbgs() << "LT: Tiling would reverse the dependence between "
+                       << *Src << " and " << *Dst << "\n");
+          return false;
+        }
+        MayBeForward |= Forward;
+        MayBeBackward |= Backward;
+      }
+    }
+  return true;
+}
+
+/// Return the number of iterations of each loop in a tile, or 0 if the target
+/// does not describe its data cache.
+unsigned LoopTiling::getTileSize(ArrayRef<Instruction *> MemInsts) const {
+  if (TileSize)
+    return TileSize;
+  Optional<unsigned> CacheSize =
+      TTI.getCacheSize(TargetTransformInfo::CacheLevel::L1D);
+  unsigned LineSize = TTI.getCacheLineSize();
+  if (!CacheSize || !LineSize)
+    return 0;
+
+  SmallPtrSet<Value *, 8> Arrays;
+  uint64_t ElementSize = 1;
+  for (Instruction *I : MemInsts) {
+    Value *Ptr = getPointerOperand(I);
+    Arrays.insert(GetUnderlyingObject(Ptr, DL));
+    ElementSize = std::max<uint64_t>(
+        ElementSize,
+        DL.getTypeStoreSize(cast<PointerType>(Ptr->getType())->getElementType()));
+  }
+
+  // Keep half of the cache for the lines of other data that map to the same
+  // sets as the tiles.
+  unsigned Side = unsigned(std::sqrt(double(*CacheSize / 2) /
+                                     double(Arrays.size() * ElementSize)));
+  unsigned ElementsPerLine = std::max<uint64_t>(LineSize / ElementSize, 1);
+  return std::max(Side / ElementsPerLine, 1u) * ElementsPerLine;
+}
+
+/// Strip-mine the loops of \p Nest by \p Size iterations and move the tile
+/// loops outside of the nest.
+void LoopTiling::tile(ArrayRef<NestLevel> Nest, unsigned Size) {
+  Loop *Outermost = Nest.front().L;
+  BasicBlock *Preheader = Outermost->getLoopPreheader();
+  BasicBlock *Header = Outermost->getHeader();
+  BasicBlock *Latch = Outermost->getLoopLatch();
+  BasicBlock *Exit = Outermost->getExitBlock();
+  LLVMContext &Ctx = F.getContext();
+  unsigned Depth = Nest.size();
+
+  SCEVExpander Expander(SE, DL, "tile");
+  SmallVector<Value *, 4> TripCounts;
+  for (const NestLevel &Level : Nest)
+    TripCounts.push_back(Expander.expandCodeFor(
+        Level.TripCount, Level.IV->getType(), Preheader->getTerminator()));
+  SE.forgetLoop(Outermost);
+
+  // Create the tile loops, from the outermost one, between the preheader of
+  // the nest and its header, and between its latch and its exit.
+  SmallVector<BasicBlock *, 4> TileHeaders(Depth), TileLatches(Depth);
+  SmallVector<PHINode *, 4> TileIVs(Depth);
+  for (unsigned K = 0; K != Depth; ++K)
+    TileHeaders[K] = BasicBlock::Create(
+        Ctx, Nest[K].IV->getName() + ".tile.header", &F, Header);
+  for (unsigned K = Depth; K-- != 0;)
+    TileLatches[K] = BasicBlock::Create(
+        Ctx, Nest[K].IV->getName() + ".tile.latch", &F, Exit);
+
+  for (unsigned K = 0; K != Depth; ++K) {
+    StringRef Name = Nest[K].IV->getName();
+    Type *Ty = Nest[K].IV->getType();
+    IRBuilder<> B(TileHeaders[K]);
+    TileIVs[K] = B.CreatePHI(Ty, 2, Name + ".tile");
+    TileIVs[K]->addIncoming(ConstantInt::get(Ty, 0),
+                            K == 0 ? Preheader : TileHeaders[K - 1]);
+    B.CreateBr(K + 1 == Depth ? Header : TileHeaders[K + 1]);
+
+    // The tile IV is below the trip count, so the iterations left after it
+    // never wrap, unlike the start of the next tile when the trip count is
+    // close to the maximum of the type.
+    B.SetInsertPoint(TileLatches[K]);
+    Value *SizeC = ConstantInt::get(Ty, Size);
+    Value *Left = B.CreateSub(TripCounts[K], TileIVs[K], Name + ".tile.left");
+    Value *More = B.CreateICmpUGT(Left, SizeC, Name + ".tile.more");
+    Value *Next = B.CreateAdd(TileIVs[K], SizeC, Name + ".tile.next");
+    B.CreateCondBr(More, TileHeaders[K], K == 0 ? Exit : TileLatches[K - 1]);
+    TileIVs[K]->addIncoming(Next, TileLatches[K]);
+  }
+
+  Preheader->getTerminator()->replaceUsesOfWith(Header, TileHeaders[0]);
+  for (PHINode &PN : Header->phis())
+    PN.setIncomingBlock(PN.getBasicBlockIndex(Preheader), TileHeaders.back());
+  Latch->getTerminator()->replaceUsesOfWith(Exit, TileLatches.back());
+  for (PHINode &PN : Exit->phis())
+    PN.setIncomingBlock(PN.getBasicBlockIndex(Latch), TileLatches[0]);
+
+  // Each point loop runs the iterations of the current tile, which are fewer
+  // than the tile size for the last tile. Counting them from the iterations
+  // left keeps the bound from wrapping.
+  for (unsigned K = 0; K != Depth; ++K) {
+    const NestLevel &Level = Nest[K];
+    StringRef Name = Level.IV->getName();
+    BasicBlock *PointPreheader = Level.L->getLoopPreheader();
+    IRBuilder<> B(PointPreheader->getTerminator());
+    Value *Start = Level.IV->getIncomingValueForBlock(PointPreheader);
+    Value *TileStart = B.CreateAdd(Start, TileIVs[K], Name + ".tile.start");
+    Value *SizeC = ConstantInt::get(Level.IV->getType(), Size);
+    Value *Rem = B.CreateSub(TripCounts[K], TileIVs[K], Name + ".tile.rem");
+    Value *Count = B.CreateSelect(B.CreateICmpULT(Rem, SizeC), Rem, SizeC,
+                                  Name + ".tile.count");
+    Value *TileEnd = B.CreateAdd(TileIVs[K], Count);
+    Value *End = B.CreateAdd(Start, TileEnd, Name + ".tile.end");
+    Level.IV->setIncomingValue(Level.IV->getBasicBlockIndex(PointPreheader),
+                               TileStart);
+
+    BasicBlock *PointLatch = Level.L->getLoopLatch();
+    auto *BI = cast<BranchInst>(PointLatch->getTerminator());
+    BasicBlock *PointExit = BI->getSuccessor(0) == Level.L->getHeader()
+                                ? BI->getSuccessor(1)
+                                : BI->getSuccessor(0);
+    Value *OldCond = BI->getCondition();
+    B.SetInsertPoint(BI);
+    Value *Cond =
+        B.CreateICmpNE(Level.IV->getIncomingValueForBlock(PointLatch), End);
+    B.CreateCondBr(Cond, Level.L->getHeader(), PointExit);
+    BI->eraseFromParent();
+    RecursivelyDeleteTriviallyDeadInstructions(OldCond);
+  }
+
+  // The tile loops take the place of the nest in the loop tree.
+  SmallVector<Loop *, 4> TileLoops;
+  for (unsigned K = 0; K != Depth; ++K)
+    TileLoops.push_back(LI.AllocateLoop());
+  if (Loop *Parent = Outermost->getParentLoop())
+    Parent->replaceChildLoopWith(Outermost, TileLoops[0]);
+  else
+    LI.changeTopLevelLoop(Outermost, TileLoops[0]);
+  for (unsigned K = 1; K != Depth; ++K)
+    TileLoops[K - 1]->addChildLoop(TileLoops[K]);
+  TileLoops.back()->addChildLoop(Outermost);
+
+  for (unsigned K = 0; K != Depth; ++K)
+    TileLoops[K]->addBasicBlockToLoop(TileHeaders[K], LI);
+  for (Loop *TileLoop : TileLoops)
+    for (BasicBlock *BB : Outermost->blocks())
+      TileLoop->addBlockEntry(BB);
+  for (unsigned K = 0; K != Depth; ++K)
+    TileLoops[K]->addBasicBlockToLoop(TileLatches[K], LI);
+
+  DT.recalculate(F);
+}
+
+bool LoopTiling::run() {
+  bool Changed = false;
+  SmallVector<Loop *, 8> Worklist(LI.begin(), LI.end());
+  while (!Worklist.empty()) {
+    Loop *L = Worklist.pop_back_val();
+    SmallVector<NestLevel, 4> Nest;
+    SmallVector<Instruction *, 16> MemInsts;
+    if (L->empty() || !analyzeNest(L, Nest, MemInsts)) {
+      Worklist.append(L->begin(), L->end());
+      continue;
+    }
+
+    DEBUG(dbgs() << "LT: Found a perfect nest of depth " << Nest.size()
+                 << " at " << L->getHeader()->getName() << "\n");
+    if (!dependencesAllowTiling(Nest, MemInsts)) {
+      ++NumDependencePrevented;
+      continue;
+    }
+
+    unsigned Size = getTileSize(MemInsts);
+    if (!Size)
+      continue;
+    // A tile size that does not fit in an induction variable would wrap.
+    if (any_of(Nest, [&](const NestLevel &Level) {
+          return !isUIntN(Level.IV->getType()->getIntegerBitWidth(), Size);
+        }))
+      continue;
+    if (all_of(Nest, [&](const NestLevel &Level) {
+          auto *C = dyn_cast<SCEVConstant>(Level.TripCount);
+          return C && C->getAPInt().ule(Size);
+        })) {
+      ++NumFitInCache;
+      continue;
+    }
+
+    DEBUG(dbgs() << "LT: Tiling by " << Size << " iterations\n");
+    tile(Nest, Size);
+    ++NumNestsTiled;
+    NumLoopsStripMined += Nest.size();
+    Changed = true;
+  }
+  return Changed;
+}
+
+namespace {
+
+class LoopTilingLegacy : public FunctionPass {
+public:
+  static char ID;
+
+  LoopTilingLegacy() : FunctionPass(ID) {
+    initializeLoopTilingLegacyPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnFunction(Function &F) override {
+    if (skipFunction(F))
+      return false;
+
+    auto &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+    auto &DT = getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+    auto &SE = getAnalysis<ScalarEvolutionWrapperPass>().getSE();
+    auto &DI = getAnalysis<DependenceAnalysisWrapperPass>().getDI();
+    auto &TTI = getAnalysis<TargetTransformInfoWrapperPass>().getTTI(F);
+    return LoopTiling(F, LI, DT, SE, DI, TTI).run();
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.addPreserved<LoopInfoWrapperPass>();
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addPreserved<DominatorTreeWrapperPass>();
+    AU.addRequired<ScalarEvolutionWrapperPass>();
+    AU.addPreserved<ScalarEvolutionWrapperPass>();
+    AU.addRequired<DependenceAnalysisWrapperPass>();
+    AU.addRequired<TargetTransformInfoWrapperPass>();
+    AU.addPreserved<GlobalsAAWrapperPass>();
+  }
+};
+
+} // end anonymous namespace
+
+PreservedAnalyses LoopTilingPass::run(Function &F,
+                                      FunctionAnalysisManager &AM) {
+  auto &LI = AM.getResult<LoopAnalysis>(F);
+  auto &DT = AM.getResult<DominatorTreeAnalysis>(F);
+  auto &SE = AM.getResult<ScalarEvolutionAnalysis>(F);
+  auto &DI = AM.getResult<DependenceAnalysis>(F);
+  auto &TTI = AM.getResult<TargetIRAnalysis>(F);
+
+  if (!LoopTiling(F, LI, DT, SE, DI, TTI).run())
+    return PreservedAnalyses::all();
+  PreservedAnalyses PA;
+  PA.preserve<LoopAnalysis>();
+  PA.preserve<DominatorTreeAnalysis>();
+  PA.preserve<ScalarEvolutionAnalysis>();
+  PA.preserve<GlobalsAA>();
+  return PA;
+}
+
+char LoopTilingLegacy::ID = 0;
+
+INITIALIZE_PASS_BEGIN(LoopTilingLegacy, "loop-tiling", "Loop Tiling", false,
+                      false)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolutionWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(DependenceAnalysisWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(TargetTransformInfoWrapperPass)
+INITIALIZE_PASS_END(LoopTilingLegacy, "loop-tiling", "Loop Tiling", false,
+                    false)
+
+FunctionPass *llvm::createLoopTilingPass() { return new LoopTilingLegacy(); }
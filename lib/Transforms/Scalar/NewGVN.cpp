@@ -63,6 +63,7 @@
 #include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/PointerIntPair.h"
 #include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/SparseBitVector.h"
@@ -76,9 +77,12 @@
 #include "llvm/Analysis/InstructionSimplify.h"
 #include "llvm/Analysis/MemoryBuiltins.h"
 #include "llvm/Analysis/MemorySSA.h"
+#include "llvm/Analysis/MemorySSAUpdater.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/Argument.h"
 #include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/CFG.h"
 #include "llvm/IR/Constant.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Dominators.h"
@@ -140,6 +144,8 @@ STATISTIC(NumGVNDeadStores, "Number of redundant/dead stores eliminated");
 STATISTIC(NumGVNPHIOfOpsCreated, "Number of PHI of ops created");
 STATISTIC(NumGVNPHIOfOpsEliminations,
           "Number of things eliminated using PHI of ops");
+STATISTIC(NumGVNPRE, "Number of instructions PRE'd");
+STATISTIC(NumGVNPRELoad, "Number of loads PRE'd");
 DEBUG_COUNTER(VNCounter, "newgvn-vn",
               "Controls which instructions are value numbered");
 DEBUG_COUNTER(PHIOfOpsCounter, "newgvn-phi",
@@ -154,6 +160,20 @@ static cl::opt<bool> EnableStoreRefinement("enable-store-refinement",
 static cl::opt<bool> EnablePhiOfOps("enable-phi-of-ops", cl::init(true),
                                     cl::Hidden);
 
+/// Partial redundancy elimination of scalars and loads. The values computed in
+/// all but one predecessor of a block are made fully redundant by inserting the
+/// computation into the remaining predecessor, so that value numbering can
+/// replace them by a phi.
+static cl::opt<bool> EnablePRE("newgvn-enable-pre", cl::init(false),
+                               cl::Hidden);
+static cl::opt<bool> EnableLoadPRE("newgvn-enable-load-pre", cl::init(true),
+                                   cl::Hidden);
+/// The maximum number of earlier loads whose clobber is queried when looking
+/// for a load available in a predecessor.
+static cl::opt<unsigned>
+    MaxLoadPRECandidates("newgvn-max-load-pre-candidates", cl::init(8),
+                         cl::Hidden);
+
 //===----------------------------------------------------------------------===//
 //                                GVN Pass
 //===----------------------------------------------------------------------===//
@@ -488,6 +508,7 @@ namespace {
 class NewGVN {
   Function &F;
   DominatorTree *DT;
+  AssumptionCache *AC;
   const TargetLibraryInfo *TLI;
   AliasAnalysis *AA;
   MemorySSA *MSSA;
@@ -651,13 +672,17 @@ class NewGVN {
   // Deletion info.
   SmallPtrSet<Instruction *, 8> InstructionsToErase;
 
+  // PRE candidates, valid while performPRE runs. Scalars are bucketed by a hash
+  // of their opcode, type and operands, simple loads by pointer and type.
+  DenseMap<unsigned, SmallVector<Instruction *, 2>> PREScalars;
+  DenseMap<std::pair<Value *, Type *>, SmallVector<LoadInst *, 2>> PRELoads;
+
 public:
   NewGVN(Function &F, DominatorTree *DT, AssumptionCache *AC,
          TargetLibraryInfo *TLI, AliasAnalysis *AA, MemorySSA *MSSA,
          const DataLayout &DL)
-      : F(F), DT(DT), TLI(TLI), AA(AA), MSSA(MSSA), DL(DL),
-        PredInfo(make_unique<PredicateInfo>(F, *DT, *AC)), SQ(DL, TLI, DT, AC) {
-  }
+      : F(F), DT(DT), AC(AC), TLI(TLI), AA(AA), MSSA(MSSA), DL(DL),
+        SQ(DL, TLI, DT, AC) {}
 
   bool runGVN();
 
@@ -795,6 +820,17 @@ private:
   Value *findPHIOfOpsLeader(const Expression *, const Instruction *,
                             const BasicBlock *) const;
 
+  // Partial redundancy elimination.
+  bool performPRE();
+  bool performScalarPRE(Instruction *);
+  bool performLoadPRE(LoadInst *, MemorySSAUpdater &);
+  Value *findAvailableLoad(LoadInst *, Value *, MemoryAccess *,
+                           BasicBlock *) const;
+  PHINode *createPREPhi(Instruction *, const DenseMap<BasicBlock *, Value *> &,
+                        ArrayRef<Instruction *>);
+  void addPRECandidate(Instruction *);
+  void removePRECandidate(Instruction *);
+
   // New instruction creation.
   void handleNewInstruction(Instruction *) {}
 
@@ -3396,6 +3432,9 @@ bool NewGVN::runGVN() {
   bool Changed = false;
   NumFuncArgs = F.arg_size();
   MSSAWalker = MSSA->getWalker();
+  if (EnablePRE)
+    Changed |= performPRE();
+  PredInfo = make_unique<PredicateInfo>(F, *DT, *AC);
   SingletonDeadExpression = new (ExpressionAllocator) DeadExpression();
 
   // Count number of instructions for sizing of hash tables, and come
@@ -3694,6 +3733,324 @@ static void patchAndReplaceAllUsesWith(Instruction *I, Value *Repl) {
   I->replaceAllUsesWith(Repl);
 }
 
+// Return true if I is executed whenever its block is entered.
+static bool isGuaranteedToExecuteInBlock(const Instruction *I) {
+  for (const Instruction &Prev : make_range(I->getParent()->begin(),
+                                            I->getIterator()))
+    if (!isGuaranteedToTransferExecutionToSuccessor(&Prev))
+      return false;
+  return true;
+}
+
+static bool isPREScalar(const Instruction *I) {
+  return isa<BinaryOperator>(I) || isa<CmpInst>(I) || isa<CastInst>(I) ||
+         isa<GetElementPtrInst>(I) || isa<SelectInst>(I);
+}
+
+// Instructions that are identical when defined hash to the same bucket.
+static unsigned getPREHash(const Instruction *I) {
+  return hash_combine(I->getOpcode(), I->getType(),
+                      hash_combine_range(I->value_op_begin(),
+                                         I->value_op_end()));
+}
+
+void NewGVN::addPRECandidate(Instruction *I) {
+  if (auto *LI = dyn_cast<LoadInst>(I)) {
+    if (LI->isSimple())
+      PRELoads[{LI->getPointerOperand(), LI->getType()}].push_back(LI);
+  } else if (isPREScalar(I)) {
+    PREScalars[getPREHash(I)].push_back(I);
+  }
+}
+
+template <typename BucketT, typename InstT>
+static void eraseFromBucket(BucketT &Bucket, InstT *Inst) {
+  auto It = find(Bucket, Inst);
+  if (It != Bucket.end())
+    Bucket.erase(It);
+}
+
+void NewGVN::removePRECandidate(Instruction *I) {
+  if (auto *LI = dyn_cast<LoadInst>(I)) {
+    auto It = PRELoads.find({LI->getPointerOperand(), LI->getType()});
+    if (It != PRELoads.end())
+      eraseFromBucket(It->second, LI);
+  } else if (isPREScalar(I)) {
+    auto It = PREScalars.find(getPREHash(I));
+    if (It != PREScalars.end())
+      eraseFromBucket(It->second, I);
+  }
+}
+
+// Replace I by a phi of the values available for it in each predecessor of its
+// block. The Equivalent instructions are the available values that now stand
+// for I, and get its flags and metadata combined in. The caller is responsible
+// for erasing I.
+PHINode *NewGVN::createPREPhi(Instruction *I,
+                              const DenseMap<BasicBlock *, Value *> &Avail,
+                              ArrayRef<Instruction *> Equivalent) {
+  BasicBlock *BB = I->getParent();
+  auto *Phi = PHINode::Create(I->getType(),
+                              std::distance(pred_begin(BB), pred_end(BB)),
+                              I->getName() + ".pre-phi", &BB->front());
+  for (BasicBlock *Pred : predecessors(BB))
+    Phi->addIncoming(Avail.lookup(Pred), Pred);
+  for (Instruction *AvailInst : Equivalent)
+    patchReplacementInstruction(I, AvailInst);
+  Phi->setDebugLoc(I->getDebugLoc());
+  // The users of I are indexed by their operands, which are about to change.
+  SmallSetVector<Instruction *, 8> Users;
+  for (User *U : I->users())
+    if (auto *UI = dyn_cast<Instruction>(U))
+      if (Users.insert(UI))
+        removePRECandidate(UI);
+  I->replaceAllUsesWith(Phi);
+  for (Instruction *UI : Users)
+    addPRECandidate(UI);
+  return Phi;
+}
+
+// Perform scalar PRE of I. For each predecessor of the block of I, I is
+// translated through the phis of the block, and an identical instruction
+// dominating the end of the predecessor is looked for. If one is found in all
+// predecessors but one, a copy of I is inserted in that predecessor, and I is
+// replaced by a phi.
+bool NewGVN::performScalarPRE(Instruction *I) {
+  if (!isPREScalar(I))
+    return false;
+  BasicBlock *BB = I->getParent();
+  // Operands computed in the block itself cannot be translated into the
+  // predecessors.
+  for (Value *Op : I->operand_values()) {
+    auto *OpInst = dyn_cast<Instruction>(Op);
+    if (OpInst && OpInst->getParent() == BB && !isa<PHINode>(OpInst))
+      return false;
+  }
+
+  auto TranslateInto = [&](BasicBlock *Pred) {
+    Instruction *Trans = I->clone();
+    for (auto &Op : Trans->operands())
+      Op = Op->DoPHITranslation(BB, Pred);
+    return Trans;
+  };
+  auto FindAvailable = [&](BasicBlock *Pred) -> Instruction * {
+    Instruction *Trans = TranslateInto(Pred);
+    Instruction *Found = nullptr;
+    auto It = PREScalars.find(getPREHash(Trans));
+    if (It != PREScalars.end())
+      for (Instruction *Cand : It->second)
+        if (Cand != I && Cand->isIdenticalToWhenDefined(Trans) &&
+            DT->dominates(Cand, Pred->getTerminator())) {
+          Found = Cand;
+          break;
+        }
+    Trans->deleteValue();
+    return Found;
+  };
+
+  DenseMap<BasicBlock *, Value *> Avail;
+  SmallVector<Instruction *, 4> Equivalent;
+  BasicBlock *Unavail = nullptr;
+  for (BasicBlock *Pred : predecessors(BB)) {
+    if (Avail.count(Pred) || Pred == Unavail)
+      continue;
+    if (!DT->isReachableFromEntry(Pred))
+      return false;
+    if (Instruction *Cand = FindAvailable(Pred)) {
+      Avail[Pred] = Cand;
+      Equivalent.push_back(Cand);
+      continue;
+    }
+    if (Unavail)
+      return false;
+    Unavail = Pred;
+  }
+  if (Avail.empty())
+    return false;
+
+  if (Unavail) {
+    // Only insert on edges that are not critical.
+    if (Unavail == BB || Unavail->getSingleSuccessor() != BB)
+      return false;
+    Instruction *PREInst = TranslateInto(Unavail);
+    if (!isSafeToSpeculativelyExecute(PREInst) &&
+        !isGuaranteedToExecuteInBlock(I)) {
+      PREInst->deleteValue();
+      return false;
+    }
+    PREInst->insertBefore(Unavail->getTerminator());
+    PREInst->setName(I->getName() + ".pre");
+    PREInst->setDebugLoc(I->getDebugLoc());
+    addPRECandidate(PREInst);
+    Avail[Unavail] = PREInst;
+  } else {
+    // A value available along every edge already dominates I; value numbering
+    // takes care of that.
+    Value *First = Avail.begin()->second;
+    if (all_of(Avail, [&](const std::pair<BasicBlock *, Value *> &KV) {
+          return KV.second == First;
+        }))
+      return false;
+  }
+
+  DEBUG(dbgs() << "PRE: replacing " << *I << " by a phi\n");
+  createPREPhi(I, Avail, Equivalent);
+  removePRECandidate(I);
+  I->eraseFromParent();
+  ++NumGVNPRE;
+  return true;
+}
+
+// Find the value LI would load from Ptr at the end of Pred, where Incoming is
+// the memory state at that point. This is either the value stored by the
+// clobbering store, or an earlier load of Ptr with the same clobber.
+Value *NewGVN::findAvailableLoad(LoadInst *LI, Value *Ptr,
+                                 MemoryAccess *Incoming,
+                                 BasicBlock *Pred) const {
+  if (isa<ConstantData>(Ptr))
+    return nullptr;
+  MemoryLocation Loc = MemoryLocation::get(LI).getWithNewPtr(Ptr);
+  MemoryAccess *Clobber = MSSAWalker->getClobberingMemoryAccess(Incoming, Loc);
+  if (auto *MD = dyn_cast<MemoryDef>(Clobber))
+    if (auto *SI = dyn_cast_or_null<StoreInst>(MD->getMemoryInst()))
+      if (SI->isSimple() && SI->getPointerOperand() == Ptr &&
+          SI->getValueOperand()->getType() == LI->getType() &&
+          DT->dominates(SI, Pred->getTerminator()))
+        return SI->getValueOperand();
+
+  auto It = PRELoads.find({Ptr, LI->getType()});
+  if (It == PRELoads.end())
+    return nullptr;
+  unsigned Queries = 0;
+  for (LoadInst *Cand : It->second) {
+    if (Cand == LI || !DT->dominates(Cand, Pred->getTerminator()))
+      continue;
+    if (MSSAWalker->getClobberingMemoryAccess(Cand) == Clobber)
+      return Cand;
+    if (++Queries == MaxLoadPRECandidates)
+      break;
+  }
+  return nullptr;
+}
+
+// Perform load PRE of LI. This only applies to loads in a block with a
+// MemoryPhi that are not clobbered within the block, so that the memory state
+// of each predecessor can be queried independently.
+bool NewGVN::performLoadPRE(LoadInst *LI, MemorySSAUpdater &MSSAU) {
+  if (!LI->isSimple())
+    return false;
+  // The inserted load may not be checked by the sanitizers.
+  if (F.hasFnAttribute(Attribute::SanitizeAddress) ||
+      F.hasFnAttribute(Attribute::SanitizeHWAddress))
+    return false;
+  BasicBlock *BB = LI->getParent();
+  MemoryPhi *MP = getMemoryAccess(BB);
+  if (!MP)
+    return false;
+  MemoryAccess *Clobber = MSSAWalker->getClobberingMemoryAccess(LI);
+  if (Clobber != MP && Clobber->getBlock() == BB)
+    return false;
+
+  // We only translate the pointer through a phi of this block.
+  Value *Ptr = LI->getPointerOperand();
+  auto *PtrInst = dyn_cast<Instruction>(Ptr);
+  auto *PtrPHI = dyn_cast<PHINode>(Ptr);
+  if (PtrInst && PtrInst->getParent() == BB && !PtrPHI)
+    return false;
+  if (PtrPHI && PtrPHI->getParent() != BB)
+    PtrPHI = nullptr;
+
+  DenseMap<BasicBlock *, Value *> Avail;
+  SmallVector<Instruction *, 4> Equivalent;
+  BasicBlock *Unavail = nullptr;
+  for (BasicBlock *Pred : predecessors(BB)) {
+    if (Avail.count(Pred) || Pred == Unavail)
+      continue;
+    if (!DT->isReachableFromEntry(Pred))
+      return false;
+    Value *PredPtr = PtrPHI ? PtrPHI->getIncomingValueForBlock(Pred) : Ptr;
+    auto *Incoming = cast<MemoryAccess>(MP->getIncomingValueForBlock(Pred));
+    if (Value *V = findAvailableLoad(LI, PredPtr, Incoming, Pred)) {
+      Avail[Pred] = V;
+      // An earlier load of the same pointer stands for LI; a stored value of
+      // some other computation does not.
+      auto *AvailLoad = dyn_cast<LoadInst>(V);
+      if (AvailLoad && AvailLoad->getPointerOperand() == PredPtr)
+        Equivalent.push_back(AvailLoad);
+      continue;
+    }
+    if (Unavail)
+      return false;
+    Unavail = Pred;
+  }
+  if (Avail.empty())
+    return false;
+
+  if (Unavail) {
+    // The load is inserted on a path that would reach LI, so it must not be
+    // executed where LI would not be.
+    if (Unavail == BB || Unavail->getSingleSuccessor() != BB ||
+        !isGuaranteedToExecuteInBlock(LI))
+      return false;
+    Value *PredPtr = PtrPHI ? PtrPHI->getIncomingValueForBlock(Unavail) : Ptr;
+    auto *NewLoad = new LoadInst(PredPtr, LI->getName() + ".pre",
+                                 LI->isVolatile(), LI->getAlignment(),
+                                 Unavail->getTerminator());
+    AAMDNodes Tags;
+    LI->getAAMetadata(Tags);
+    if (Tags)
+      NewLoad->setAAMetadata(Tags);
+    if (auto *MD = LI->getMetadata(LLVMContext::MD_invariant_load))
+      NewLoad->setMetadata(LLVMContext::MD_invariant_load, MD);
+    if (auto *MD = LI->getMetadata(LLVMContext::MD_range))
+      NewLoad->setMetadata(LLVMContext::MD_range, MD);
+    NewLoad->setDebugLoc(LI->getDebugLoc());
+    auto *Incoming = cast<MemoryAccess>(MP->getIncomingValueForBlock(Unavail));
+    MSSAU.createMemoryAccessInBB(NewLoad, Incoming, Unavail, MemorySSA::End);
+    addPRECandidate(NewLoad);
+    Avail[Unavail] = NewLoad;
+  }
+
+  DEBUG(dbgs() << "PRE: replacing load " << *LI << " by a phi\n");
+  createPREPhi(LI, Avail, Equivalent);
+  removePRECandidate(LI);
+  MSSAU.removeMemoryAccess(MSSA->getMemoryAccess(LI));
+  LI->eraseFromParent();
+  ++NumGVNPRELoad;
+  return true;
+}
+
+// Make partially redundant scalars and loads fully redundant. This runs before
+// value numbering, which then folds the phis created here with the rest of the
+// program.
+bool NewGVN::performPRE() {
+  bool Changed = false;
+  MemorySSAUpdater MSSAU(MSSA);
+  ReversePostOrderTraversal<Function *> RPOT(&F);
+  // Index the candidates once, so that looking for an available value does not
+  // scan the users of the operands or pointer again for every instruction.
+  for (BasicBlock *BB : RPOT)
+    for (Instruction &I : *BB)
+      addPRECandidate(&I);
+  for (BasicBlock *BB : RPOT) {
+    // Everything available in a single predecessor dominates the block.
+    if (BB->getSinglePredecessor() || pred_empty(BB) || BB->isEHPad())
+      continue;
+    for (auto II = BB->begin(), IE = BB->end(); II != IE;) {
+      Instruction *I = &*II++;
+      if (auto *LI = dyn_cast<LoadInst>(I)) {
+        if (EnableLoadPRE)
+          Changed |= performLoadPRE(LI, MSSAU);
+        continue;
+      }
+      Changed |= performScalarPRE(I);
+    }
+  }
+  PREScalars.clear();
+  PRELoads.clear();
+  return Changed;
+}
+
 void NewGVN::deleteInstructionsInBlock(BasicBlock *BB) {
   DEBUG(dbgs() << "  BasicBlock Dead:" << *BB);
   ++NumGVNBlocksDeleted;
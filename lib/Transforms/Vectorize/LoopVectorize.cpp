@@ -144,6 +144,7 @@ using namespace llvm;
 
 STATISTIC(LoopsVectorized, "Number of loops vectorized");
 STATISTIC(LoopsAnalyzed, "Number of loops analyzed for vectorization");
+STATISTIC(LoopEpiloguesVectorized, "Number of epilogue loops vectorized");
 
 static cl::opt<bool>
     EnableIfConversion("enable-if-conversion", cl::init(true), cl::Hidden,
@@ -252,6 +253,23 @@ static cl::opt<unsigned> PragmaVectorizeSCEVCheckThreshold(
     cl::desc("The maximum number of SCEV checks allowed with a "
              "vectorize(enable) pragma"));
 
+static cl::opt<bool> EnableEpilogueVectorization(
+    "enable-epilogue-vectorization", cl::init(false), cl::Hidden,
+    cl::desc("Vectorize the remainder loop of a vectorized loop at a "
+             "narrower vectorization factor."));
+
+/// The remainder loop runs fewer than VF * IC iterations of the vectorized
+/// loop; it is not worth vectorizing unless that is large enough.
+static cl::opt<unsigned> EpilogueVectorizationMinRemainder(
+    "epilogue-vectorization-min-remainder", cl::init(16), cl::Hidden,
+    cl::desc("The minimum VF * IC of a vectorized loop for its remainder "
+             "loop to be vectorized."));
+
+static cl::opt<unsigned> EpilogueVectorizationForceVF(
+    "epilogue-vectorization-force-VF", cl::init(0), cl::Hidden,
+    cl::desc("When vectorizing the remainder loop, use this VF instead of the "
+             "one selected by the cost model."));
+
 /// Create an analysis remark that explains why vectorization failed
 ///
 /// \p PassName is the name of the pass (e.g. can be AlwaysPrint).  \p
@@ -1003,14 +1021,7 @@ public:
                         DominatorTree *DT, LoopInfo *LI)
       : PSE(PSE), TheLoop(L), DT(DT), LI(LI) {}
 
-  ~InterleavedAccessInfo() {
-    SmallSet<InterleaveGroup *, 4> DelSet;
-    // Avoid releasing a pointer twice.
-    for (auto &I : InterleaveGroupMap)
-      DelSet.insert(I.second);
-    for (auto *Ptr : DelSet)
-      delete Ptr;
-  }
+  ~InterleavedAccessInfo() { invalidateGroups(); }
 
   /// \brief Analyze the interleaved accesses and collect them in interleave
   /// groups. Substitute symbolic strides using \p Strides.
@@ -1034,6 +1045,19 @@ public:
   /// out-of-bounds requires a scalar epilogue iteration for correctness.
   bool requiresScalarEpilogue() const { return RequiresScalarEpilogue; }
 
+  /// \brief Release all the interleave groups, so that their members are
+  /// vectorized individually.
+  void invalidateGroups() {
+    SmallSet<InterleaveGroup *, 4> DelSet;
+    // Avoid releasing a pointer twice.
+    for (auto &I : InterleaveGroupMap)
+      DelSet.insert(I.second);
+    for (auto *Ptr : DelSet)
+      delete Ptr;
+    InterleaveGroupMap.clear();
+    RequiresScalarEpilogue = false;
+  }
+
   /// \brief Initialize the LoopAccessInfo used for dependence checking.
   void setLAI(const LoopAccessInfo *Info) { LAI = Info; }
 
@@ -1605,6 +1629,22 @@ public:
   /// to be vectorized.
   bool blockNeedsPredication(BasicBlock *BB);
 
+  /// Return true if the block BB is conditionally executed within an
+  /// iteration of the original loop.
+  bool blockIsConditional(BasicBlock *BB) {
+    return LoopAccessInfo::blockNeedsPredication(BB, TheLoop, DT);
+  }
+
+  /// Returns true if the vector loop executes all the iterations of the loop,
+  /// masking off the lanes past the trip count instead of leaving them to a
+  /// scalar epilogue. Every block then needs predication.
+  bool foldTailByMasking() const { return FoldTailByMasking; }
+
+  /// Check that every block of the loop, including the header, can be
+  /// predicated and if so commit to folding the tail by masking. Returns false
+  /// and leaves the legality state unchanged otherwise.
+  bool prepareToFoldTailByMasking();
+
   /// Check if this pointer is consecutive when vectorizing. This happens
   /// when the last index of the GEP is the induction variable, or that the
   /// pointer itself is an induction variable.
@@ -1758,6 +1798,9 @@ private:
 
   unsigned NumPredStores = 0;
 
+  /// True if the tail of the loop is folded into the vector loop by masking.
+  bool FoldTailByMasking = false;
+
   /// The loop that we evaluate.
   Loop *TheLoop;
 
@@ -2307,9 +2350,10 @@ public:
                            LoopVectorizationCostModel &CM)
       : OrigLoop(L), LI(LI), TLI(TLI), TTI(TTI), Legal(Legal), CM(CM) {}
 
-  /// Plan how to best vectorize, return the best VF and its cost.
-  LoopVectorizationCostModel::VectorizationFactor plan(bool OptForSize,
-                                                       unsigned UserVF);
+  /// Plan how to best vectorize, return the best VF and its cost. If
+  /// \p MaxVFLimit is not zero, only VFs up to it are considered.
+  LoopVectorizationCostModel::VectorizationFactor
+  plan(bool OptForSize, unsigned UserVF, unsigned MaxVFLimit = 0);
 
   /// Finalize the best decision and dispose of all other VPlans.
   void setBestPlan(unsigned VF, unsigned UF);
@@ -3456,12 +3500,26 @@ Value *InnerLoopVectorizer::getOrCreateVectorTripCount(Loop *L) {
   Value *TC = getOrCreateTripCount(L);
   IRBuilder<> Builder(L->getLoopPreheader()->getTerminator());
 
+  Type *Ty = TC->getType();
+  Constant *Step = ConstantInt::get(Ty, VF * UF);
+
+  // If the tail is to be folded by masking, round the number of iterations N
+  // up to a multiple of Step instead of rounding down. This is done by first
+  // adding Step-1 and then rounding down. Note that it's ok if this addition
+  // overflows: the vector induction variable will eventually wrap to zero given
+  // that it starts at zero and its Step is a power of two; the loop will then
+  // exit, with the last early-exit vector comparison also producing all-true.
+  if (Legal->foldTailByMasking()) {
+    assert(isPowerOf2_32(VF * UF) &&
+           "VF*UF must be a power of 2 when folding tail by masking");
+    TC = Builder.CreateAdd(TC, ConstantInt::get(Ty, VF * UF - 1), "n.rnd.up");
+  }
+
   // Now we need to generate the expression for the part of the loop that the
   // vectorized body will execute. This is equal to N - (N % Step) if scalar
   // iterations are not required for correctness, or N - Step, otherwise. Step
   // is equal to the vectorization factor (number of SIMD elements) times the
   // unroll factor (number of SIMD instructions).
-  Constant *Step = ConstantInt::get(TC->getType(), VF * UF);
   Value *R = Builder.CreateURem(TC, Step, "n.mod.vf");
 
   // If there is a non-reversed interleaved group that may speculatively access
@@ -3522,10 +3580,14 @@ void InnerLoopVectorizer::emitMinimumIterationCountCheck(Loop *L,
   // vector trip count is zero. This check also covers the case where adding one
   // to the backedge-taken count overflowed leading to an incorrect trip count
   // of zero. In this case we will also jump to the scalar loop.
+  // If the tail is folded by masking, the vector loop handles any trip count.
   auto P = Legal->requiresScalarEpilogue() ? ICmpInst::ICMP_ULE
                                            : ICmpInst::ICMP_ULT;
-  Value *CheckMinIters = Builder.CreateICmp(
-      P, Count, ConstantInt::get(Count->getType(), VF * UF), "min.iters.check");
+  Value *CheckMinIters = Builder.getFalse();
+  if (!Legal->foldTailByMasking())
+    CheckMinIters = Builder.CreateICmp(
+        P, Count, ConstantInt::get(Count->getType(), VF * UF),
+        "min.iters.check");
 
   BasicBlock *NewBB = BB->splitBasicBlock(BB->getTerminator(), "vector.ph");
   // Update dominator tree immediately if the generated block is a
@@ -3760,9 +3822,12 @@ BasicBlock *InnerLoopVectorizer::createVectorizedLoopSkeleton() {
   // Add a check in the middle block to see if we have completed
   // all of the iterations in the first vector loop.
   // If (N - N%VF) == N, then we *don't* need to run the remainder.
-  Value *CmpN =
-      CmpInst::Create(Instruction::ICmp, CmpInst::ICMP_EQ, Count,
-                      CountRoundDown, "cmp.n", MiddleBlock->getTerminator());
+  // If the tail is folded by masking, all the iterations have completed.
+  Value *CmpN = Builder.getTrue();
+  if (!Legal->foldTailByMasking())
+    CmpN = CmpInst::Create(Instruction::ICmp, CmpInst::ICMP_EQ, Count,
+                           CountRoundDown, "cmp.n",
+                           MiddleBlock->getTerminator());
   ReplaceInstWithInst(MiddleBlock->getTerminator(),
                       BranchInst::Create(ExitBlock, ScalarPH, CmpN));
 
@@ -4963,15 +5028,17 @@ void InnerLoopVectorizer::updateAnalysis() {
   // Forget the original basic block.
   PSE.getSE()->forgetLoop(OrigLoop);
 
-  // Update the dominator tree information.
-  assert(DT->properlyDominates(LoopBypassBlocks.front(), LoopExitBlock) &&
-         "Entry does not dominate exit.");
+  // Update the dominator tree information. The exit block is also reached
+  // from outside the loop when the loop is the remainder of another vectorized
+  // loop, in which case its dominator does not change.
+  BasicBlock *ExitIDom = DT->findNearestCommonDominator(
+      DT->getNode(LoopExitBlock)->getIDom()->getBlock(), LoopBypassBlocks[0]);
 
   DT->addNewBlock(LoopMiddleBlock,
                   LI->getLoopFor(LoopVectorBody)->getLoopLatch());
   DT->addNewBlock(LoopScalarPreHeader, LoopBypassBlocks[0]);
   DT->changeImmediateDominator(LoopScalarBody, LoopScalarPreHeader);
-  DT->changeImmediateDominator(LoopExitBlock, LoopBypassBlocks[0]);
+  DT->changeImmediateDominator(LoopExitBlock, ExitIDom);
   DEBUG(DT->verifyDomTree());
 }
 
@@ -5587,6 +5654,11 @@ void LoopVectorizationCostModel::collectLoopScalars(unsigned VF) {
     if (Induction.second.getKind() == InductionDescriptor::IK_PtrInduction)
       continue;
 
+    // If the tail is folded by masking, the primary induction feeds the
+    // vector compare forming the header mask.
+    if (Legal->foldTailByMasking() && Ind == Legal->getPrimaryInduction())
+      continue;
+
     // Determine if all users of the induction variable are scalar after
     // vectorization.
     auto ScalarInd = llvm::all_of(Ind->users(), [&](User *U) -> bool {
@@ -5798,6 +5870,11 @@ void LoopVectorizationCostModel::collectLoopUniforms(unsigned VF) {
     auto *Ind = Induction.first;
     auto *IndUpdate = cast<Instruction>(Ind->getIncomingValueForBlock(Latch));
 
+    // If the tail is folded by masking, the primary induction feeds the
+    // vector compare forming the header mask.
+    if (Legal->foldTailByMasking() && Ind == Legal->getPrimaryInduction())
+      continue;
+
     // Determine if all users of the induction variable are uniform after
     // vectorization.
     auto UniformInd = llvm::all_of(Ind->users(), [&](User *U) -> bool {
@@ -5878,7 +5955,70 @@ bool LoopVectorizationLegality::isFirstOrderRecurrence(const PHINode *Phi) {
 }
 
 bool LoopVectorizationLegality::blockNeedsPredication(BasicBlock *BB) {
-  return LoopAccessInfo::blockNeedsPredication(BB, TheLoop, DT);
+  return FoldTailByMasking || blockIsConditional(BB);
+}
+
+bool LoopVectorizationLegality::prepareToFoldTailByMasking() {
+  assert(!FoldTailByMasking && "Tail already folded");
+
+  // The header mask compares the primary induction, which counts iterations
+  // from zero, against the backedge-taken count.
+  if (!PrimaryInduction) {
+    DEBUG(dbgs() << "LV: Cannot fold tail by masking: no primary induction.\n");
+    return false;
+  }
+
+  // Reductions are not supported under tail folding: the masked-off lanes
+  // would feed them.
+  if (!Reductions.empty()) {
+    DEBUG(dbgs() << "LV: Cannot fold tail by masking: loop has reductions.\n");
+    return false;
+  }
+
+  // Values live out of the loop are taken from the last vector lane or from
+  // the end value of the inductions, neither of which is right if the last
+  // lanes are masked off.
+  for (Value *V : AllowedExit)
+    for (User *U : V->users())
+      if (!TheLoop->contains(cast<Instruction>(U))) {
+        DEBUG(dbgs() << "LV: Cannot fold tail by masking: loop has an "
+                        "outside user for " << *V << ".\n");
+        return false;
+      }
+
+  // No access is known to be safe past the trip count, so every load and
+  // store has to be masked, including those in the header. Only consecutive
+  // accesses are certain to be widened into masked loads and stores rather
+  // than scalarized; loads from a uniform address only access the first lane,
+  // which is always active.
+  auto IsMaskedWidened = [&](Instruction &I) {
+    if (!isa<LoadInst>(I) && !isa<StoreInst>(I))
+      return true;
+    Value *Ptr = getPointerOperand(&I);
+    return (isa<LoadInst>(I) && isUniform(Ptr)) ||
+           (MaskedOp.count(&I) && isConsecutivePtr(Ptr));
+  };
+  SmallPtrSet<const Instruction *, 8> SavedMaskedOp(MaskedOp.begin(),
+                                                    MaskedOp.end());
+  unsigned SavedNumPredStores = NumPredStores;
+  SmallPtrSet<Value *, 8> SafePointers;
+  for (BasicBlock *BB : TheLoop->blocks()) {
+    if (!blockCanBePredicated(BB, SafePointers) ||
+        !llvm::all_of(*BB, IsMaskedWidened)) {
+      DEBUG(dbgs() << "LV: Cannot fold tail by masking: block " << BB->getName()
+                   << " cannot be predicated.\n");
+      MaskedOp = std::move(SavedMaskedOp);
+      NumPredStores = SavedNumPredStores;
+      return false;
+    }
+  }
+
+  // Interleave groups are not masked, and may require a scalar epilogue.
+  InterleaveInfo.invalidateGroups();
+
+  DEBUG(dbgs() << "LV: Folding the tail by masking.\n");
+  FoldTailByMasking = true;
+  return true;
 }
 
 bool LoopVectorizationLegality::blockCanBePredicated(
@@ -6276,8 +6416,11 @@ Optional<unsigned> LoopVectorizationCostModel::computeMaxVF(bool OptForSize) {
   // If we optimize the program for size, avoid creating the tail loop.
   DEBUG(dbgs() << "LV: Found trip count: " << TC << '\n');
 
-  // If we don't know the precise trip count, don't try to vectorize.
+  // If we don't know the precise trip count, try to fold the tail into the
+  // vector loop, and otherwise don't try to vectorize.
   if (TC < 2) {
+    if (Legal->prepareToFoldTailByMasking())
+      return computeFeasibleMaxVF(OptForSize, TC);
     ORE->emit(
         createMissedAnalysis("UnknownLoopCountComplexCFG")
         << "unable to calculate the loop count due to complex control flow");
@@ -6289,7 +6432,11 @@ Optional<unsigned> LoopVectorizationCostModel::computeMaxVF(bool OptForSize) {
 
   if (TC % MaxVF != 0) {
     // If the trip count that we found modulo the vectorization factor is not
-    // zero then we require a tail.
+    // zero then we require a tail, unless it can be folded into the vector
+    // loop by masking.
+    if (Legal->prepareToFoldTailByMasking())
+      return MaxVF;
+
     // FIXME: look for a smaller MaxVF that does divide TC rather than give up.
     // FIXME: return None if loop requiresScalarEpilog(<MaxVF>), or look for a
     //        smaller MaxVF that does not require a scalar epilog.
@@ -6965,7 +7112,7 @@ LoopVectorizationCostModel::expectedCost(unsigned VF) {
     // unconditionally executed. For the scalar case, we may not always execute
     // the predicated block. Thus, scale the block's cost by the probability of
     // executing it.
-    if (VF == 1 && Legal->blockNeedsPredication(BB))
+    if (VF == 1 && Legal->blockIsConditional(BB))
       BlockCost.first /= getReciprocalPredBlockProb();
 
     Cost.first += BlockCost.first;
@@ -7592,7 +7739,8 @@ void LoopVectorizationCostModel::collectValuesToIgnore() {
 }
 
 LoopVectorizationCostModel::VectorizationFactor
-LoopVectorizationPlanner::plan(bool OptForSize, unsigned UserVF) {
+LoopVectorizationPlanner::plan(bool OptForSize, unsigned UserVF,
+                               unsigned MaxVFLimit) {
   // Width 1 means no vectorize, cost 0 means uncomputed cost.
   const LoopVectorizationCostModel::VectorizationFactor NoVectorization = {1U,
                                                                            0U};
@@ -7613,6 +7761,8 @@ LoopVectorizationPlanner::plan(bool OptForSize, unsigned UserVF) {
 
   unsigned MaxVF = MaybeMaxVF.getValue();
   assert(MaxVF != 0 && "MaxVF is zero.");
+  if (MaxVFLimit)
+    MaxVF = std::min(MaxVF, MaxVFLimit);
 
   for (unsigned VF = 1; VF <= MaxVF; VF *= 2) {
     // Collect Uniform and Scalar instructions after vectorization with VF.
@@ -7655,6 +7805,7 @@ void LoopVectorizationPlanner::executePlan(InnerLoopVectorizer &ILV,
                          DT,     ILV.Builder, ILV.VectorLoopValueMap,
                          &ILV,   CallbackILV};
   State.CFG.PrevBB = ILV.createVectorizedLoopSkeleton();
+  State.TripCount = ILV.getOrCreateTripCount(nullptr);
 
   //===------------------------------------------------===//
   //
@@ -7798,6 +7949,11 @@ void LoopVectorizationPlanner::buildVPlans(unsigned MinVF, unsigned MaxVF) {
       NeedDef.insert(Branch->getCondition());
   }
 
+  // If the tail is to be folded by masking, the primary induction variable
+  // needs to be represented in VPlan for it to model early-exit masking.
+  if (Legal->foldTailByMasking())
+    NeedDef.insert(Legal->getPrimaryInduction());
+
   for (unsigned VF = MinVF; VF < MaxVF + 1;) {
     VFRange SubRange = {VF, MaxVF + 1};
     VPlans.push_back(buildVPlan(SubRange, NeedDef));
@@ -7850,9 +8006,18 @@ VPValue *LoopVectorizationPlanner::createBlockInMask(BasicBlock *BB,
   // load/store/gather/scatter. Initialize BlockMask to no-mask.
   VPValue *BlockMask = nullptr;
 
-  // Loop incoming mask is all-one.
-  if (OrigLoop->getHeader() == BB)
+  if (OrigLoop->getHeader() == BB) {
+    // Loop incoming mask is all-one, unless the tail is folded by masking.
+    if (!Legal->foldTailByMasking())
+      return BlockMaskCache[BB] = BlockMask;
+
+    // Introduce the early-exit compare IV <= BTC to form the header block mask.
+    // This is used instead of IV < TC because TC may wrap, unlike BTC.
+    VPValue *IV = Plan->getVPValue(Legal->getPrimaryInduction());
+    VPValue *BTC = Plan->getOrCreateBackedgeTakenCount();
+    BlockMask = Builder.createICmpULE(IV, BTC);
     return BlockMaskCache[BB] = BlockMask;
+  }
 
   // This is the block mask. We OR all incoming edges.
   for (auto *Predecessor : predecessors(BB)) {
@@ -8521,9 +8686,22 @@ bool LoopVectorizePass::processLoop(Loop *L) {
 
   PredicatedScalarEvolution PSE(*SE, *L);
 
+  // A loop whose hints force a width is only vectorized with that width, so
+  // its dependence analysis can stop as soon as it rules the width out. That
+  // analysis is incomplete for the other passes, so it is not cached.
+  unsigned UserVF = Hints.getWidth();
+  std::unique_ptr<LoopAccessInfo> UserVFLAI;
+  std::function<const LoopAccessInfo &(Loop &)> GetUserVFLAA =
+      [&](Loop &Lp) -> const LoopAccessInfo & {
+    UserVFLAI =
+        llvm::make_unique<LoopAccessInfo>(&Lp, SE, TLI, AA, DT, LI, UserVF);
+    return *UserVFLAI;
+  };
+
   // Check if it is legal to vectorize the loop.
   LoopVectorizationRequirements Requirements(*ORE);
-  LoopVectorizationLegality LVL(L, PSE, DT, TLI, AA, F, TTI, GetLAA, LI, ORE,
+  LoopVectorizationLegality LVL(L, PSE, DT, TLI, AA, F, TTI,
+                                UserVF > 1 ? &GetUserVFLAA : GetLAA, LI, ORE,
                                 &Requirements, &Hints, DB, AC);
   if (!LVL.canVectorize()) {
     DEBUG(dbgs() << "LV: Not vectorizing: Cannot prove legality.\n");
@@ -8600,9 +8778,6 @@ bool LoopVectorizePass::processLoop(Loop *L) {
   // Use the planner for vectorization.
   LoopVectorizationPlanner LVP(L, LI, TLI, TTI, &LVL, CM);
 
-  // Get user vectorization factor.
-  unsigned UserVF = Hints.getWidth();
-
   // Plan how to best vectorize, return the best VF and its cost.
   LoopVectorizationCostModel::VectorizationFactor VF =
       LVP.plan(OptForSize, UserVF);
@@ -8732,6 +8907,11 @@ bool LoopVectorizePass::processLoop(Loop *L) {
              << NV("VectorizationFactor", VF.Width)
              << ", interleaved count: " << NV("InterleaveCount", IC) << ")";
     });
+
+    // L is now the remainder loop.
+    if (EnableEpilogueVectorization && !OptForSize &&
+        !LVL.foldTailByMasking())
+      vectorizeEpilogue(L, VF.Width, IC);
   }
 
   // Mark the loop as already vectorized to avoid vectorizing again.
@@ -8741,6 +8921,78 @@ bool LoopVectorizePass::processLoop(Loop *L) {
   return true;
 }
 
+bool LoopVectorizePass::vectorizeEpilogue(Loop *L, unsigned MainVF,
+                                          unsigned MainIC) {
+  // The remainder loop runs fewer than MainVF * MainIC iterations.
+  if (MainVF * MainIC < EpilogueVectorizationMinRemainder) {
+    DEBUG(dbgs() << "LV: Not vectorizing the epilogue: at most "
+                 << MainVF * MainIC - 1 << " iterations remain.\n");
+    return false;
+  }
+
+  DEBUG(dbgs() << "LV: Checking the epilogue of a loop vectorized with VF "
+               << MainVF << " and IC " << MainIC << ".\n");
+
+  // The remainder loop shares its exit block with the middle block of the
+  // vector loop. Split a dedicated exit again, since the runtime checks version
+  // the loop and need it in simplified form.
+  simplifyLoop(L, DT, LI, SE, AC, /*PreserveLCSSA=*/true);
+
+  Function *F = L->getHeader()->getParent();
+  LoopVectorizeHints Hints(L, /*DisableInterleaving=*/true, *ORE);
+  PredicatedScalarEvolution PSE(*SE, *L);
+
+  // The access analysis cached for L describes it before vectorization; its
+  // accesses now start where the vector loop left off. The epilogue is
+  // entered both from the vector loop and when its runtime checks fail, so it
+  // emits its own checks.
+  std::unique_ptr<LoopAccessInfo> LAI;
+  std::function<const LoopAccessInfo &(Loop &)> GetEpilogueLAA =
+      [&](Loop &Lp) -> const LoopAccessInfo & {
+    LAI = llvm::make_unique<LoopAccessInfo>(&Lp, SE, TLI, AA, DT, LI,
+                                            EpilogueVectorizationForceVF);
+    return *LAI;
+  };
+
+  LoopVectorizationRequirements Requirements(*ORE);
+  LoopVectorizationLegality LVL(L, PSE, DT, TLI, AA, F, TTI, &GetEpilogueLAA,
+                                LI, ORE, &Requirements, &Hints, DB, AC);
+  if (!LVL.canVectorize() || Requirements.doesNotMeet(F, L, Hints)) {
+    DEBUG(dbgs() << "LV: Not vectorizing the epilogue: Cannot prove "
+                    "legality.\n");
+    return false;
+  }
+
+  LoopVectorizationCostModel CM(L, PSE, LI, &LVL, *TTI, TLI, DB, AC, ORE, F,
+                                &Hints);
+  CM.collectValuesToIgnore();
+  LoopVectorizationPlanner LVP(L, LI, TLI, TTI, &LVL, CM);
+
+  // Only consider VFs narrower than the vector loop's.
+  LoopVectorizationCostModel::VectorizationFactor VF = LVP.plan(
+      /*OptForSize=*/false, EpilogueVectorizationForceVF, MainVF / 2);
+  if (VF.Width == 1) {
+    DEBUG(dbgs() << "LV: Not vectorizing the epilogue: not beneficial.\n");
+    return false;
+  }
+
+  DEBUG(dbgs() << "LV: Vectorizing the epilogue with VF " << VF.Width
+               << ".\n");
+  LVP.setBestPlan(VF.Width, 1);
+  InnerLoopVectorizer LB(L, PSE, LI, DT, TLI, TTI, AC, ORE, VF.Width, 1, &LVL,
+                         &CM);
+  LVP.executePlan(LB, DT);
+  ++LoopEpiloguesVectorized;
+
+  ORE->emit([&]() {
+    return OptimizationRemark(LV_NAME, "EpilogueVectorized", L->getStartLoc(),
+                              L->getHeader())
+           << "vectorized epilogue loop (vectorization width: "
+           << ore::NV("VectorizationFactor", VF.Width) << ")";
+  });
+  return true;
+}
+
 bool LoopVectorizePass::runImpl(
     Function &F, ScalarEvolution &SE_, LoopInfo &LI_, TargetTransformInfo &TTI_,
     DominatorTree &DT_, BlockFrequencyInfo &BFI_, TargetLibraryInfo *TLI_,
@@ -84,6 +84,7 @@
 #include "llvm/Support/KnownBits.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/Transforms/Utils/LoopUtils.h"
 #include "llvm/Transforms/Vectorize.h"
 #include <algorithm>
@@ -144,6 +145,30 @@ static cl::opt<unsigned> MinTreeSize(
     "slp-min-tree-size", cl::init(3), cl::Hidden,
     cl::desc("Only vectorize small trees if they are fully vectorizable"));
 
+/// Limits the number of nodes of a vectorizable tree. The depth limit alone
+/// still allows trees that are exponential in the depth, and building them
+/// dominates the compile time.
+static cl::opt<unsigned> MaxTreeSize(
+    "slp-max-tree-size", cl::init(1024), cl::Hidden,
+    cl::desc("Gather the operands of a vectorizable tree once it has this "
+             "many nodes"));
+
+static cl::opt<bool> MixedReductionValues(
+    "slp-mixed-reduction-values", cl::init(false), cl::Hidden,
+    cl::desc("Allow the values of a horizontal reduction to be computed by "
+             "different operations, such as extensions from different "
+             "widths"));
+
+static cl::opt<bool> SpeculateDiamonds(
+    "slp-speculate-diamonds", cl::init(false), cl::Hidden,
+    cl::desc("Speculate small if-then-else diamonds into selects to form "
+             "straight-line code for the vectorizer"));
+
+static cl::opt<unsigned> SpeculateDiamondsMaxInsts(
+    "slp-speculate-diamonds-max-insts", cl::init(4), cl::Hidden,
+    cl::desc("The maximum number of instructions in each arm of a speculated "
+             "diamond"));
+
 static cl::opt<bool>
     ViewSLPTree("view-slp-tree", cl::Hidden,
                 cl::desc("Display the SLP trees with Graphviz"));
@@ -1393,6 +1418,12 @@ void BoUpSLP::buildTree_rec(ArrayRef<Value *> VL, unsigned Depth,
     return;
   }
 
+  if (VectorizableTree.size() >= MaxTreeSize) {
+    DEBUG(dbgs() << "SLP: Gathering due to max tree size.\n");
+    newTreeEntry(VL, false, UserTreeIdx);
+    return;
+  }
+
   // Don't handle vectors.
   if (S.OpValue->getType()->isVectorTy()) {
     DEBUG(dbgs() << "SLP: Gathering due to vector type.\n");
@@ -4130,7 +4161,8 @@ struct SLPVectorizer : public FunctionPass {
     AU.addPreserved<DominatorTreeWrapperPass>();
     AU.addPreserved<AAResultsWrapperPass>();
     AU.addPreserved<GlobalsAAWrapperPass>();
-    AU.setPreservesCFG();
+    if (!SpeculateDiamonds)
+      AU.setPreservesCFG();
   }
 };
 
@@ -4152,7 +4184,11 @@ PreservedAnalyses SLPVectorizerPass::run(Function &F, FunctionAnalysisManager &A
     return PreservedAnalyses::all();
 
   PreservedAnalyses PA;
-  PA.preserveSet<CFGAnalyses>();
+  if (CFGChanged) {
+    PA.preserve<DominatorTreeAnalysis>();
+    PA.preserve<LoopAnalysis>();
+  } else
+    PA.preserveSet<CFGAnalyses>();
   PA.preserve<AAManager>();
   PA.preserve<GlobalsAA>();
   return PA;
@@ -4176,6 +4212,7 @@ bool SLPVectorizerPass::runImpl(Function &F, ScalarEvolution *SE_,
 
   Stores.clear();
   GEPs.clear();
+  CFGChanged = false;
   bool Changed = false;
 
   // If the target claims to have no vector registers don't attempt
@@ -4187,6 +4224,9 @@ bool SLPVectorizerPass::runImpl(Function &F, ScalarEvolution *SE_,
   if (F.hasFnAttribute(Attribute::NoImplicitFloat))
     return false;
 
+  if (SpeculateDiamonds)
+    Changed = CFGChanged = speculateDiamonds(F);
+
   DEBUG(dbgs() << "SLP: Analyzing blocks in " << F.getName() << ".\n");
 
   // Use the bottom up slp vectorizer to construct chains that start with
@@ -4228,6 +4268,111 @@ bool SLPVectorizerPass::runImpl(Function &F, ScalarEvolution *SE_,
   return Changed;
 }
 
+/// \brief Speculate the arms of the if-then-else diamond or if-then triangle
+/// joined at \p BB into their head block, and merge \p BB into the head.
+/// \returns the head block if the CFG was changed, and null otherwise.
+static BasicBlock *speculateDiamond(BasicBlock *BB, DominatorTree *DT,
+                                    LoopInfo *LI, ScalarEvolution *SE) {
+  BasicBlock *IfTrue, *IfFalse;
+  Value *Cond = GetIfCondition(BB, IfTrue, IfFalse);
+  if (!Cond || BB->hasAddressTaken() || LI->isLoopHeader(BB))
+    return nullptr;
+
+  // In a triangle, the head is one of the incoming blocks.
+  BasicBlock *Head;
+  if (IfTrue->getTerminator()->getNumSuccessors() > 1)
+    Head = IfTrue;
+  else if (IfFalse->getTerminator()->getNumSuccessors() > 1)
+    Head = IfFalse;
+  else
+    Head = IfTrue->getSinglePredecessor();
+  if (!Head || LI->getLoopFor(Head) != LI->getLoopFor(BB))
+    return nullptr;
+
+  // Each arm may only hold a few instructions that are safe to execute
+  // unconditionally.
+  SmallVector<BasicBlock *, 2> Arms;
+  for (BasicBlock *Arm : {IfTrue, IfFalse}) {
+    if (Arm == Head)
+      continue;
+    if (Arm->hasAddressTaken() || Arm->getSinglePredecessor() != Head ||
+        Arm->getSingleSuccessor() != BB)
+      return nullptr;
+    unsigned NumInsts = 0;
+    for (Instruction &I : *Arm) {
+      if (isa<TerminatorInst>(I) || isa<DbgInfoIntrinsic>(I))
+        continue;
+      if (isa<PHINode>(I) || !isSafeToSpeculativelyExecute(&I) ||
+          ++NumInsts > SpeculateDiamondsMaxInsts)
+        return nullptr;
+    }
+    Arms.push_back(Arm);
+  }
+
+  DEBUG(dbgs() << "SLP: Speculating the diamond joined at " << BB->getName()
+               << " into " << Head->getName() << ".\n");
+
+  TerminatorInst *HeadTerm = Head->getTerminator();
+  for (BasicBlock *Arm : Arms)
+    for (auto It = Arm->begin(); It != Arm->end();) {
+      Instruction &I = *It++;
+      if (isa<TerminatorInst>(I))
+        continue;
+      // Metadata that holds on the arm may not hold on the other path.
+      I.dropUnknownNonDebugMetadata();
+      I.moveBefore(HeadTerm);
+    }
+
+  // Select between the incoming values of the phis.
+  while (auto *PN = dyn_cast<PHINode>(&BB->front())) {
+    auto *Sel = SelectInst::Create(Cond, PN->getIncomingValueForBlock(IfTrue),
+                                   PN->getIncomingValueForBlock(IfFalse), "",
+                                   HeadTerm);
+    Sel->takeName(PN);
+    PN->replaceAllUsesWith(Sel);
+    PN->eraseFromParent();
+  }
+
+  // The arms are now empty; branch straight to BB.
+  BranchInst::Create(BB, HeadTerm);
+  HeadTerm->eraseFromParent();
+  for (BasicBlock *Arm : Arms) {
+    // BB is dominated by Head, so the arms do not dominate any block.
+    DT->eraseNode(Arm);
+    LI->removeBlock(Arm);
+    Arm->eraseFromParent();
+  }
+  if (Loop *L = LI->getLoopFor(Head))
+    SE->forgetLoop(L);
+
+  MergeBlockIntoPredecessor(BB, DT, LI);
+  return Head;
+}
+
+bool SLPVectorizerPass::speculateDiamonds(Function &F) {
+  // Visit the blocks in layout order. Speculating a diamond merges its join
+  // block into the head, which may then be the arm of a diamond joined at one
+  // of its successors; revisit those. The blocks speculated away are dropped
+  // from the worklist by their handles.
+  SmallVector<WeakVH, 32> Worklist;
+  for (BasicBlock &BB : reverse(F))
+    Worklist.push_back(&BB);
+
+  bool Changed = false;
+  while (!Worklist.empty()) {
+    auto *BB = cast_or_null<BasicBlock>(Worklist.pop_back_val());
+    if (!BB)
+      continue;
+    BasicBlock *Head = speculateDiamond(BB, DT, LI, SE);
+    if (!Head)
+      continue;
+    Changed = true;
+    for (BasicBlock *Succ : successors(Head))
+      Worklist.push_back(Succ);
+  }
+  return Changed;
+}
+
 /// \brief Check that the Values in the slice in VL array are still existent in
 /// the WeakTrackingVH array.
 /// Vectorization of part of the VL array may cause later values in the VL array
@@ -5180,9 +5325,10 @@ public:
         // Continue analysis if the next operand is a reduction operation or
         // (possibly) a reduced value. If the reduced value opcode is not set,
         // the first met operation != reduction operation is considered as the
-        // reduced value class.
+        // reduced value class, unless reduced values of mixed operations are
+        // allowed.
         if (I && (!ReducedValueData || OpData == ReducedValueData ||
-                  OpData == ReductionData)) {
+                  OpData == ReductionData || MixedReductionValues)) {
           const bool IsReductionOperation = OpData == ReductionData;
           // Only handle trees in the current basic block.
           if (!ReductionData.hasSameParent(I, B->getParent(),
@@ -5209,8 +5355,8 @@ public:
               markExtraArg(Stack.back(), I);
               continue;
             }
-          } else if (ReducedValueData &&
-                     ReducedValueData != OpData) {
+          } else if (ReducedValueData && ReducedValueData != OpData &&
+                     !MixedReductionValues) {
             // Make sure that the opcodes of the operations that we are going to
             // reduce match.
             // I is an extra argument for TreeN (its parent operation).
@@ -5242,14 +5388,21 @@ public:
     if (NumReducedVals < 4)
       return false;
 
-    unsigned ReduxWidth = PowerOf2Floor(NumReducedVals);
+    // Values computed by different operations, or extended from different
+    // widths, do not form a vectorizable tree together. Reduce each group of
+    // alike values separately, keeping the original order within a group.
+    MapVector<std::pair<unsigned, Type *>, SmallVector<Value *, 16>> Groups;
+    for (Value *RdxVal : ReducedVals) {
+      auto *I = cast<Instruction>(RdxVal);
+      Type *SrcTy = isa<CastInst>(I) ? I->getOperand(0)->getType() : nullptr;
+      Groups[std::make_pair(I->getOpcode(), SrcTy)].push_back(I);
+    }
 
     Value *VectorizedTree = nullptr;
     IRBuilder<> Builder(ReductionRoot);
     FastMathFlags Unsafe;
     Unsafe.setFast();
     Builder.setFastMathFlags(Unsafe);
-    unsigned i = 0;
 
     BoUpSLP::ExtraValueToDebugLocsMap ExternallyUsedValues;
     // The same extra argument may be used several time, so log each attempt
@@ -5259,67 +5412,77 @@ public:
     SmallVector<Value *, 16> IgnoreList;
     for (auto &V : ReductionOps)
       IgnoreList.append(V.begin(), V.end());
-    while (i < NumReducedVals - ReduxWidth + 1 && ReduxWidth > 2) {
-      auto VL = makeArrayRef(&ReducedVals[i], ReduxWidth);
-      V.buildTree(VL, ExternallyUsedValues, IgnoreList);
-      if (V.shouldReorder()) {
-        SmallVector<Value *, 8> Reversed(VL.rbegin(), VL.rend());
-        V.buildTree(Reversed, ExternallyUsedValues, IgnoreList);
-      }
-      if (V.isTreeTinyAndNotFullyVectorizable())
-        break;
 
-      V.computeMinimumValueSizes();
-
-      // Estimate cost.
-      int Cost =
-          V.getTreeCost() + getReductionCost(TTI, ReducedVals[i], ReduxWidth);
-      if (Cost >= -SLPCostThreshold) {
-          V.getORE()->emit([&]() {
-              return OptimizationRemarkMissed(
-                         SV_NAME, "HorSLPNotBeneficial", cast<Instruction>(VL[0]))
-                     << "Vectorizing horizontal reduction is possible"
-                     << "but not beneficial with cost "
-                     << ore::NV("Cost", Cost) << " and threshold "
-                     << ore::NV("Threshold", -SLPCostThreshold);
-          });
+    // The reduced values that are left scalar.
+    SmallVector<Value *, 16> ScalarVals;
+    for (auto &Group : Groups) {
+      ArrayRef<Value *> Vals = Group.second;
+      unsigned NumVals = Vals.size();
+      unsigned ReduxWidth = PowerOf2Floor(NumVals);
+      unsigned i = 0;
+      while (i < NumVals - ReduxWidth + 1 && ReduxWidth > 2) {
+        auto VL = Vals.slice(i, ReduxWidth);
+        V.buildTree(VL, ExternallyUsedValues, IgnoreList);
+        if (V.shouldReorder()) {
+          SmallVector<Value *, 8> Reversed(VL.rbegin(), VL.rend());
+          V.buildTree(Reversed, ExternallyUsedValues, IgnoreList);
+        }
+        if (V.isTreeTinyAndNotFullyVectorizable())
           break;
-      }
 
-      DEBUG(dbgs() << "SLP: Vectorizing horizontal reduction at cost:" << Cost
-                   << ". (HorRdx)\n");
-      V.getORE()->emit([&]() {
-          return OptimizationRemark(
-                     SV_NAME, "VectorizedHorizontalReduction", cast<Instruction>(VL[0]))
-          << "Vectorized horizontal reduction with cost "
-          << ore::NV("Cost", Cost) << " and with tree size "
-          << ore::NV("TreeSize", V.getTreeSize());
-      });
+        V.computeMinimumValueSizes();
+
+        // Estimate cost.
+        int Cost =
+            V.getTreeCost() + getReductionCost(TTI, Vals[i], ReduxWidth);
+        if (Cost >= -SLPCostThreshold) {
+            V.getORE()->emit([&]() {
+                return OptimizationRemarkMissed(
+                           SV_NAME, "HorSLPNotBeneficial", cast<Instruction>(VL[0]))
+                       << "Vectorizing horizontal reduction is possible"
+                       << "but not beneficial with cost "
+                       << ore::NV("Cost", Cost) << " and threshold "
+                       << ore::NV("Threshold", -SLPCostThreshold);
+            });
+            break;
+        }
+
+        DEBUG(dbgs() << "SLP: Vectorizing horizontal reduction at cost:"
+                     << Cost << ". (HorRdx)\n");
+        V.getORE()->emit([&]() {
+            return OptimizationRemark(
+                       SV_NAME, "VectorizedHorizontalReduction", cast<Instruction>(VL[0]))
+            << "Vectorized horizontal reduction with cost "
+            << ore::NV("Cost", Cost) << " and with tree size "
+            << ore::NV("TreeSize", V.getTreeSize());
+        });
 
-      // Vectorize a tree.
-      DebugLoc Loc = cast<Instruction>(ReducedVals[i])->getDebugLoc();
-      Value *VectorizedRoot = V.vectorizeTree(ExternallyUsedValues);
+        // Vectorize a tree.
+        DebugLoc Loc = cast<Instruction>(Vals[i])->getDebugLoc();
+        Value *VectorizedRoot = V.vectorizeTree(ExternallyUsedValues);
 
-      // Emit a reduction.
-      Value *ReducedSubTree =
-          emitReduction(VectorizedRoot, Builder, ReduxWidth, TTI);
-      if (VectorizedTree) {
-        Builder.SetCurrentDebugLocation(Loc);
-        OperationData VectReductionData(ReductionData.getOpcode(),
-                                        VectorizedTree, ReducedSubTree,
-                                        ReductionData.getKind());
-        VectorizedTree =
-            VectReductionData.createOp(Builder, "op.rdx", ReductionOps);
-      } else
-        VectorizedTree = ReducedSubTree;
-      i += ReduxWidth;
-      ReduxWidth = PowerOf2Floor(NumReducedVals - i);
+        // Emit a reduction.
+        Value *ReducedSubTree =
+            emitReduction(VectorizedRoot, Builder, ReduxWidth, TTI);
+        if (VectorizedTree) {
+          Builder.SetCurrentDebugLocation(Loc);
+          OperationData VectReductionData(ReductionData.getOpcode(),
+                                          VectorizedTree, ReducedSubTree,
+                                          ReductionData.getKind());
+          VectorizedTree =
+              VectReductionData.createOp(Builder, "op.rdx", ReductionOps);
+        } else
+          VectorizedTree = ReducedSubTree;
+        i += ReduxWidth;
+        ReduxWidth = PowerOf2Floor(NumVals - i);
+      }
+      ScalarVals.append(Vals.begin() + i, Vals.end());
     }
 
     if (VectorizedTree) {
       // Finish the reduction.
-      for (; i < NumReducedVals; ++i) {
-        auto *I = cast<Instruction>(ReducedVals[i]);
+      for (Value *RdxVal : ScalarVals) {
+        auto *I = cast<Instruction>(RdxVal);
         Builder.SetCurrentDebugLocation(I->getDebugLoc());
         OperationData VectReductionData(ReductionData.getOpcode(),
                                         VectorizedTree, I,
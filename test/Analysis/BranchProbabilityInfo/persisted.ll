@@ -0,0 +1,50 @@
+; RUN: opt < %s -passes=persist-analyses -S | FileCheck %s --check-prefix=PERSIST
+; RUN: opt < %s -passes=persist-analyses | opt -passes='print<branch-prob>' -disable-output 2>&1 | FileCheck %s --check-prefix=COMPUTED
+
+; Persisted probabilities are used as long as the function is unchanged, so
+; edit them to tell them apart from computed ones.
+; RUN: opt < %s -passes=persist-analyses -S \
+; RUN:   | sed -e 's/i32 67108864, i32 2080374784/i32 1073741824, i32 1073741824/' \
+; RUN:   | opt -passes='print<branch-prob>' -disable-output 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=LOADED
+; RUN: opt < %s -passes=persist-analyses -S \
+; RUN:   | sed -e 's/i32 67108864, i32 2080374784/i32 1073741824, i32 1073741824/' \
+; RUN:   | opt -analyze -branch-prob | FileCheck %s --check-prefix=LOADED
+; RUN: opt < %s -passes=persist-analyses -S \
+; RUN:   | sed -e 's/i32 67108864, i32 2080374784/i32 1073741824, i32 1073741824/' \
+; RUN:   | opt -passes='print<branch-prob>' -use-persisted-bpi=false \
+; RUN:     -disable-output 2>&1 | FileCheck %s --check-prefix=COMPUTED
+
+; Once the function changes, the persisted probabilities are stale.
+; RUN: opt < %s -passes=persist-analyses -S \
+; RUN:   | sed -e 's/i32 67108864, i32 2080374784/i32 1073741824, i32 1073741824/' \
+; RUN:   | sed -e 's/add i32 %iv, 1/add i32 %iv, 2/' \
+; RUN:   | opt -passes='print<branch-prob>' -disable-output 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=COMPUTED
+
+; PERSIST: define i32 @test(i32 %i, i32* %a) !persisted.bpi [[MD:![0-9]+]] {
+; PERSIST: [[MD]] = !{i32 1, i64 {{-?[0-9]+}}, i32 67108864, i32 2080374784}
+
+; COMPUTED: edge body -> exit probability is 0x04000000 / 0x80000000 = 3.12%
+; COMPUTED: edge body -> body probability is 0x7c000000 / 0x80000000 = 96.88% [HOT edge]
+
+; LOADED: edge body -> exit probability is 0x40000000 / 0x80000000 = 50.00%
+; LOADED: edge body -> body probability is 0x40000000 / 0x80000000 = 50.00%
+
+define i32 @test(i32 %i, i32* %a) {
+entry:
+  br label %body
+
+body:
+  %iv = phi i32 [ 0, %entry ], [ %next, %body ]
+  %base = phi i32 [ 0, %entry ], [ %sum, %body ]
+  %arrayidx = getelementptr inbounds i32, i32* %a, i32 %iv
+  %0 = load i32, i32* %arrayidx
+  %sum = add nsw i32 %0, %base
+  %next = add i32 %iv, 1
+  %exitcond = icmp eq i32 %next, %i
+  br i1 %exitcond, label %exit, label %body
+
+exit:
+  ret i32 %sum
+}
@@ -0,0 +1,60 @@
+; RUN: opt < %s -analyze -scalar-evolution | FileCheck %s
+; RUN: opt < %s -analyze -scalar-evolution -scalar-evolution-max-cache-size=2 \
+; RUN:   | FileCheck %s
+; RUN: opt < %s -analyze -scalar-evolution -scalar-evolution-budget=4 \
+; RUN:   | FileCheck %s --check-prefix=BUDGET
+; RUN: opt < %s -analyze -scalar-evolution -scalar-evolution-budget=4 \
+; RUN:   -scalar-evolution-max-cache-size=2 -stats 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=STATS
+; REQUIRES: asserts
+
+; A small cache limit must not change the results, while a small budget is
+; spent on the outer loop and gives conservative answers for the inner ones.
+
+; CHECK: Loop %loop.k: backedge-taken count is 99
+; CHECK: Loop %loop.j: backedge-taken count is 99
+; CHECK: Loop %loop.i: backedge-taken count is 99
+
+; BUDGET: Loop %loop.k: Unpredictable backedge-taken count.
+; BUDGET: Loop %loop.j: Unpredictable backedge-taken count.
+; BUDGET: Loop %loop.i: backedge-taken count is 99
+
+; STATS-DAG: 1 scalar-evolution - Number of functions where ScalarEvolution ran out of budget
+; STATS-DAG: {{[0-9]+}} scalar-evolution - Number of queries given up because of the ScalarEvolution budget
+; STATS-DAG: {{[0-9]+}} scalar-evolution - Number of ScalarEvolution caches evicted for reaching their limit
+
+define void @nest(i32* %p) {
+entry:
+  br label %loop.i
+
+loop.i:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %latch.i ]
+  br label %loop.j
+
+loop.j:
+  %j = phi i64 [ 0, %loop.i ], [ %j.next, %latch.j ]
+  %ij = add i64 %i, %j
+  br label %loop.k
+
+loop.k:
+  %k = phi i64 [ 0, %loop.j ], [ %k.next, %loop.k ]
+  %ijk = add i64 %ij, %k
+  %gep = getelementptr inbounds i32, i32* %p, i64 %ijk
+  store i32 0, i32* %gep
+  %k.next = add nuw nsw i64 %k, 1
+  %k.cmp = icmp ult i64 %k.next, 100
+  br i1 %k.cmp, label %loop.k, label %latch.j
+
+latch.j:
+  %j.next = add nuw nsw i64 %j, 1
+  %j.cmp = icmp ult i64 %j.next, 100
+  br i1 %j.cmp, label %loop.j, label %latch.i
+
+latch.i:
+  %i.next = add nuw nsw i64 %i, 1
+  %i.cmp = icmp ult i64 %i.next, 100
+  br i1 %i.cmp, label %loop.i, label %exit
+
+exit:
+  ret void
+}
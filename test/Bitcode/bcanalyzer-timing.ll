@@ -0,0 +1,19 @@
+; RUN: llvm-as < %s | llvm-bcanalyzer -timing | FileCheck %s
+; RUN: llvm-as < %s | llvm-bcanalyzer | FileCheck %s --check-prefix=NOTIMING
+
+; CHECK: Decode Timing:
+; CHECK-NEXT: Total time: {{[0-9.]+}} ms
+; CHECK: Block ID #12 (FUNCTION_BLOCK):
+; CHECK-NEXT: Decode time: {{[0-9.]+}} ms
+; CHECK-NEXT: Count  Unabbrev   Time (ms)    ns/Rec  Record Kind
+; CHECK: INST_RET
+; CHECK: Abbreviation Opportunities:
+
+; NOTIMING-NOT: Decode Timing:
+; NOTIMING-NOT: Abbreviation Opportunities:
+
+define i32 @f(i32 %a, i32 %b) {
+  %c = add i32 %a, %b
+  %d = mul i32 %c, %a
+  ret i32 %d
+}
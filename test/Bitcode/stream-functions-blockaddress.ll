@@ -0,0 +1,43 @@
+; Check that printing the functions one at a time keeps the blocks referred to
+; by a blockaddress, whether the blockaddress comes before or after the body of
+; its function.
+; RUN: llvm-as < %s > %t.bc
+; RUN: llvm-dis < %t.bc > %t.ll
+; RUN: llvm-dis -stream-functions < %t.bc > %t.stream.ll
+; RUN: diff %t.ll %t.stream.ll
+; RUN: llvm-as < %t.stream.ll | llvm-dis | FileCheck %s
+
+; CHECK: define i8* @backward_target(i1 %c)
+; CHECK: define i8* @backward_user()
+; CHECK-NEXT: ret i8* blockaddress(@backward_target, %bb)
+; CHECK: define i8* @forward_user()
+; CHECK-NEXT: ret i8* blockaddress(@forward_target, %bb)
+; CHECK: define i8* @forward_target(i1 %c)
+
+define i8* @backward_target(i1 %c) {
+  br i1 %c, label %bb, label %exit
+
+bb:
+  br label %exit
+
+exit:
+  ret i8* null
+}
+
+define i8* @backward_user() {
+  ret i8* blockaddress(@backward_target, %bb)
+}
+
+define i8* @forward_user() {
+  ret i8* blockaddress(@forward_target, %bb)
+}
+
+define i8* @forward_target(i1 %c) {
+  br i1 %c, label %bb, label %exit
+
+bb:
+  br label %exit
+
+exit:
+  ret i8* null
+}
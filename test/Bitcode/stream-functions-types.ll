@@ -0,0 +1,33 @@
+; Check that printing the functions one at a time still prints the types only
+; used inside function bodies, in the same order as for the fully materialized
+; module, and that the output assembles again.
+; RUN: llvm-as < %s > %t.bc
+; RUN: llvm-dis < %t.bc > %t.ll
+; RUN: llvm-dis -stream-functions < %t.bc > %t.stream.ll
+; RUN: diff %t.ll %t.stream.ll
+; RUN: llvm-as < %t.stream.ll | llvm-dis | FileCheck %s
+
+; CHECK: %sig = type { i32 }
+; CHECK-NEXT: %body.first = type { i64, %body.nested }
+; CHECK-NEXT: %body.nested = type { i8 }
+; CHECK-NEXT: %sig.later = type { i16 }
+; CHECK-NEXT: %body.second = type { i32, i32 }
+
+%sig = type { i32 }
+%sig.later = type { i16 }
+%body.first = type { i64, %body.nested }
+%body.nested = type { i8 }
+%body.second = type { i32, i32 }
+%0 = type { float }
+
+define void @f(%sig* %p) {
+  %a = alloca %body.first
+  %u = alloca %0
+  ret void
+}
+
+define void @g(%sig.later* %p) {
+  %a = alloca %body.second
+  %u = alloca %0
+  ret void
+}
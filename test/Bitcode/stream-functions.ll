@@ -0,0 +1,57 @@
+; Check that printing the functions one at a time gives the same output as
+; printing the fully materialized module.
+; RUN: llvm-as < %s > %t.bc
+; RUN: llvm-dis < %t.bc > %t.ll
+; RUN: llvm-dis -stream-functions < %t.bc > %t.stream.ll
+; RUN: diff %t.ll %t.stream.ll
+; RUN: llvm-dis -stream-functions -show-annotations < %t.bc | FileCheck %s
+; RUN: not llvm-dis -stream-functions -preserve-ll-uselistorder < %t.bc 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=USELIST
+
+; CHECK: define i32 @f(i32 %x) #0 !dbg ![[SPF:[0-9]+]]
+; CHECK: call i32 @g(i32 %x) #1{{.*}}[debug line = 2:3]
+; CHECK: define i32 @g(i32 %y) !dbg ![[SPG:[0-9]+]]
+; CHECK: define i8* @h(i1 %c)
+; CHECK: blockaddress(@h, %bb)
+; CHECK: attributes #0 = { nounwind }
+; CHECK: attributes #1 = { readnone }
+; CHECK: ![[SPF]] = distinct !DISubprogram(name: "f"
+; CHECK: ![[SPG]] = distinct !DISubprogram(name: "g"
+
+; USELIST: -stream-functions cannot be used with -preserve-ll-uselistorder
+
+define i32 @f(i32 %x) #0 !dbg !4 {
+  %r = call i32 @g(i32 %x) #1, !dbg !7
+  ret i32 %r, !dbg !8
+}
+
+define i32 @g(i32 %y) !dbg !9 {
+  %r = add i32 %y, 1, !dbg !10
+  ret i32 %r, !dbg !10
+}
+
+define i8* @h(i1 %c) {
+  br i1 %c, label %bb, label %exit
+
+bb:
+  br label %exit
+
+exit:
+  ret i8* blockaddress(@h, %bb)
+}
+
+attributes #0 = { nounwind }
+attributes #1 = { readnone }
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!2}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug)
+!1 = !DIFile(filename: "stream-functions.c", directory: "")
+!2 = !{i32 2, !"Debug Info Version", i32 3}
+!3 = !DISubroutineType(types: !{})
+!4 = distinct !DISubprogram(name: "f", scope: !1, file: !1, line: 1, type: !3, isLocal: false, isDefinition: true, scopeLine: 1, isOptimized: false, unit: !0)
+!7 = !DILocation(line: 2, column: 3, scope: !4)
+!8 = !DILocation(line: 3, column: 3, scope: !4)
+!9 = distinct !DISubprogram(name: "g", scope: !1, file: !1, line: 5, type: !3, isLocal: false, isDefinition: true, scopeLine: 5, isOptimized: false, unit: !0)
+!10 = !DILocation(line: 6, column: 3, scope: !9)
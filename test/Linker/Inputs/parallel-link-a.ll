@@ -0,0 +1,7 @@
+%T = type { i32, i8* }
+
+@order = appending global [1 x i32] [i32 1]
+
+define void @use_a(%T* %p) {
+  ret void
+}
@@ -0,0 +1,5 @@
+@order = appending global [1 x i32] [i32 2]
+
+define linkonce_odr i32 @pick() {
+  ret i32 2
+}
@@ -0,0 +1,11 @@
+%T = type { i32, i8* }
+
+@order = appending global [1 x i32] [i32 3]
+
+define i32 @c() {
+  ret i32 3
+}
+
+define void @use_c(%T* %p) {
+  ret void
+}
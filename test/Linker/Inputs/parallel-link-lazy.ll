@@ -0,0 +1,50 @@
+$used_comdat = comdat any
+$unused_comdat = comdat any
+
+define linkonce_odr i32 @lazy() {
+  %r = call i32 @lazy_callee()
+  ret i32 %r
+}
+
+define linkonce_odr i32 @lazy_callee() {
+  ret i32 1
+}
+
+define linkonce i32 @unused() {
+  %r = call i32 @unused_callee()
+  ret i32 %r
+}
+
+define linkonce_odr i32 @unused_callee() {
+  ret i32 2
+}
+
+define weak i32 @weak() {
+  ret i32 3
+}
+
+define available_externally i32 @avail() {
+  ret i32 4
+}
+
+define available_externally i32 @unused_avail() {
+  ret i32 5
+}
+
+define linkonce_odr i32 @in_used_comdat() comdat($used_comdat) {
+  ret i32 6
+}
+
+define linkonce_odr i32 @other_in_used_comdat() comdat($used_comdat) {
+  ret i32 7
+}
+
+define linkonce_odr i32 @unused_in_comdat() comdat($unused_comdat) {
+  %r = call i32 @unused_other_in_comdat()
+  ret i32 %r
+}
+
+define linkonce_odr i32 @unused_other_in_comdat() comdat($unused_comdat) {
+  %r = call i32 @unused_in_comdat()
+  ret i32 %r
+}
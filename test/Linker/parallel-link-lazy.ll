@@ -0,0 +1,33 @@
+; RUN: llvm-link -S %s %S/Inputs/parallel-link-lazy.ll | FileCheck %s
+; RUN: llvm-link -S -j 2 %s %S/Inputs/parallel-link-lazy.ll | FileCheck %s
+
+; The lazily linked definitions of a shard are kept for the uses in the other
+; shards, and the unreferenced ones and their comdats are dropped once the
+; shards are merged.
+
+; CHECK-NOT: unused
+; CHECK: $used_comdat = comdat any
+; CHECK-NOT: unused
+; CHECK: define linkonce_odr i32 @lazy()
+; CHECK: define linkonce_odr i32 @lazy_callee()
+; CHECK-NOT: unused
+; CHECK: define weak i32 @weak()
+; CHECK-NOT: unused
+; CHECK: define available_externally i32 @avail()
+; CHECK-NOT: unused
+; CHECK: define linkonce_odr i32 @in_used_comdat() comdat($used_comdat)
+; CHECK: define linkonce_odr i32 @other_in_used_comdat() comdat($used_comdat)
+; CHECK-NOT: unused
+
+declare i32 @lazy()
+declare i32 @avail()
+declare i32 @in_used_comdat()
+
+define i32 @main() {
+  %r = call i32 @lazy()
+  %a = call i32 @avail()
+  %c = call i32 @in_used_comdat()
+  %s = add i32 %r, %a
+  %t = add i32 %s, %c
+  ret i32 %t
+}
@@ -0,0 +1,41 @@
+; RUN: llvm-link -S %s %S/Inputs/parallel-link-a.ll %S/Inputs/parallel-link-b.ll \
+; RUN:   %S/Inputs/parallel-link-c.ll | FileCheck %s
+; RUN: llvm-link -S -j 2 %s %S/Inputs/parallel-link-a.ll \
+; RUN:   %S/Inputs/parallel-link-b.ll %S/Inputs/parallel-link-c.ll | FileCheck %s
+; RUN: llvm-link -S -j 4 %s %S/Inputs/parallel-link-a.ll \
+; RUN:   %S/Inputs/parallel-link-b.ll %S/Inputs/parallel-link-c.ll | FileCheck %s
+; RUN: not llvm-link -S -j 2 -only-needed %s %S/Inputs/parallel-link-a.ll 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=ERR
+
+; Linking the shards in parallel must give the same result as a serial link.
+
+; CHECK-NOT: %T.{{[0-9]+}} = type
+; CHECK: %T = type { i32, i8* }
+; CHECK-NOT: %T.{{[0-9]+}} = type
+; CHECK: @order = appending global [4 x i32] [i32 0, i32 1, i32 2, i32 3]
+
+; CHECK: define linkonce_odr i32 @pick()
+; CHECK-NEXT: ret i32 0
+
+; CHECK: define void @use_a(%T*
+; CHECK: define i32 @c()
+; CHECK: define void @use_c(%T*
+
+; ERR: -num-threads cannot be used with -only-needed or -internalize
+
+%T = type { i32, i8* }
+
+@order = appending global [1 x i32] [i32 0]
+
+define linkonce_odr i32 @pick() {
+  ret i32 0
+}
+
+declare i32 @c()
+
+define i32 @main(%T* %p) {
+  %r = call i32 @c()
+  %s = call i32 @pick()
+  %t = add i32 %r, %s
+  ret i32 %t
+}
@@ -0,0 +1,13 @@
+source_filename = "cache-function-content-hash.ll"
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @f(i32 %x) {
+  %r = add i32 %x, 1
+  ret i32 %r
+}
+
+define i32 @g(i32 %x) {
+  %r = mul i32 %x, 3
+  ret i32 %r
+}
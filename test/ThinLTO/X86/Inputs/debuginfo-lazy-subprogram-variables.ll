@@ -0,0 +1,46 @@
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; @bar was inlined in both @foo and @baz, its subprogram is emitted in the
+; module-level metadata block.
+define i32 @foo(i32 %x) !dbg !6 {
+entry:
+  call void @llvm.dbg.value(metadata i32 %x, metadata !8, metadata !DIExpression()), !dbg !15
+  call void @llvm.dbg.value(metadata i32 %x, metadata !12, metadata !DIExpression()), !dbg !16
+  ret i32 %x, !dbg !18
+}
+
+define i32 @baz(i32 %x) !dbg !19 {
+entry:
+  call void @llvm.dbg.value(metadata i32 %x, metadata !12, metadata !DIExpression()), !dbg !20
+  ret i32 %x, !dbg !22
+}
+
+declare void @llvm.dbg.value(metadata, metadata, metadata)
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!2, !3}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, isOptimized: true, runtimeVersion: 0, emissionKind: FullDebug)
+!1 = !DIFile(filename: "debuginfo-lazy-subprogram-variables.c", directory: "")
+!2 = !{i32 2, !"Dwarf Version", i32 4}
+!3 = !{i32 2, !"Debug Info Version", i32 3}
+!4 = !DISubroutineType(types: !5)
+!5 = !{!14, !14}
+!6 = distinct !DISubprogram(name: "foo", scope: !1, file: !1, line: 5, type: !4, isLocal: false, isDefinition: true, scopeLine: 5, isOptimized: true, unit: !0, variables: !7)
+!7 = !{!8}
+!8 = !DILocalVariable(name: "x", arg: 1, scope: !6, file: !1, line: 5, type: !14)
+!9 = distinct !DISubprogram(name: "bar", scope: !1, file: !1, line: 1, type: !4, isLocal: true, isDefinition: true, scopeLine: 1, isOptimized: true, unit: !0, variables: !10)
+!10 = !{!12, !13}
+!11 = !{}
+!12 = !DILocalVariable(name: "a", arg: 1, scope: !9, file: !1, line: 1, type: !14)
+!13 = !DILocalVariable(name: "unused", scope: !9, file: !1, line: 2, type: !14)
+!14 = !DIBasicType(name: "int", size: 32, encoding: DW_ATE_signed)
+!15 = !DILocation(line: 5, column: 1, scope: !6)
+!16 = !DILocation(line: 1, column: 1, scope: !9, inlinedAt: !17)
+!17 = distinct !DILocation(line: 6, column: 1, scope: !6)
+!18 = !DILocation(line: 7, column: 1, scope: !6)
+!19 = distinct !DISubprogram(name: "baz", scope: !1, file: !1, line: 10, type: !4, isLocal: false, isDefinition: true, scopeLine: 10, isOptimized: true, unit: !0, variables: !11)
+!20 = !DILocation(line: 1, column: 1, scope: !9, inlinedAt: !21)
+!21 = distinct !DILocation(line: 11, column: 1, scope: !19)
+!22 = !DILocation(line: 12, column: 1, scope: !19)
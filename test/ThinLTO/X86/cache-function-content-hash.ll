@@ -0,0 +1,46 @@
+; RUN: opt -module-hash -module-summary %s -o %t.bc
+; RUN: opt -module-hash -module-summary %S/Inputs/cache-function-content-hash1.ll -o %t1.bc
+; RUN: opt -module-hash -module-summary %S/Inputs/cache-function-content-hash2.ll -o %t2.bc
+
+; The two inputs only differ in the body of @g, which is not imported. Check
+; that the cache entry for this module, which imports @f, is shared between
+; the two links while the entries for the inputs are not.
+
+; RUN: rm -rf %t.cache
+; RUN: llvm-lto2 run -cache-dir %t.cache -o %t.o %t.bc %t1.bc -r=%t.bc,main,plx -r=%t.bc,f,lx -r=%t1.bc,f,plx -r=%t1.bc,g,plx
+; RUN: ls %t.cache | count 2
+; RUN: llvm-lto2 run -cache-dir %t.cache -o %t.o %t.bc %t2.bc -r=%t.bc,main,plx -r=%t.bc,f,lx -r=%t2.bc,f,plx -r=%t2.bc,g,plx
+; RUN: ls %t.cache | count 3
+
+; RUN: llvm-bcanalyzer -dump %t1.bc | FileCheck %s
+; CHECK: <GLOBALVAL_SUMMARY_BLOCK
+; CHECK: <CONTENT_HASH op0={{[0-9]+}} op1={{[0-9]+}} op2={{[0-9]+}} op3={{[0-9]+}} op4={{[0-9]+}}/>
+; CHECK-NEXT: <PERMODULE
+; CHECK: <CONTENT_HASH op0={{[0-9]+}} op1={{[0-9]+}} op2={{[0-9]+}} op3={{[0-9]+}} op4={{[0-9]+}}/>
+; CHECK-NEXT: <PERMODULE
+; CHECK: </GLOBALVAL_SUMMARY_BLOCK>
+
+; The thin link bitcode has no function bodies, but carries the content hashes
+; computed for the full bitcode.
+; RUN: opt -thinlto-bc -thin-link-bitcode-file=%t1.thinlink.bc %S/Inputs/cache-function-content-hash1.ll -o %t1.thin.bc
+; RUN: llvm-bcanalyzer -dump %t1.thin.bc > %t1.dump
+; RUN: llvm-bcanalyzer -dump %t1.thinlink.bc >> %t1.dump
+; RUN: FileCheck %s --check-prefix=THINLINK < %t1.dump
+; THINLINK: <CONTENT_HASH op0=[[F0:[0-9]+]] op1=[[F1:[0-9]+]] op2=[[F2:[0-9]+]] op3=[[F3:[0-9]+]] op4=[[F4:[0-9]+]]/>
+; THINLINK: <CONTENT_HASH op0=[[G0:[0-9]+]] op1=[[G1:[0-9]+]] op2=[[G2:[0-9]+]] op3=[[G3:[0-9]+]] op4=[[G4:[0-9]+]]/>
+; THINLINK-NOT: <FUNCTION_BLOCK
+; THINLINK: <GLOBALVAL_SUMMARY_BLOCK
+; THINLINK: <CONTENT_HASH op0=[[F0]] op1=[[F1]] op2=[[F2]] op3=[[F3]] op4=[[F4]]/>
+; THINLINK-NEXT: <PERMODULE
+; THINLINK: <CONTENT_HASH op0=[[G0]] op1=[[G1]] op2=[[G2]] op3=[[G3]] op4=[[G4]]/>
+; THINLINK-NEXT: <PERMODULE
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @main(i32 %x) {
+  %r = call i32 @f(i32 %x)
+  ret i32 %r
+}
+
+declare i32 @f(i32)
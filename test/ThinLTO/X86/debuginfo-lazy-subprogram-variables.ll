@@ -0,0 +1,32 @@
+; Test that the variables of the subprograms that are only reached through
+; inlined locations are not loaded when importing, while the ones of the
+; imported functions are.
+
+; RUN: opt -module-summary %s -o %t1.bc
+; RUN: opt -module-summary %p/Inputs/debuginfo-lazy-subprogram-variables.ll -o %t2.bc -bitcode-mdindex-threshold=0
+; RUN: llvm-lto -thinlto-action=thinlink -o %t.index.bc %t1.bc %t2.bc
+
+; RUN: llvm-lto -thinlto-action=import %t1.bc -thinlto-index=%t.index.bc -o - | llvm-dis -o - | FileCheck %s
+; CHECK-NOT: name: "unused"
+; CHECK: distinct !DISubprogram(name: "foo", {{.*}}, variables: ![[FOOVARS:[0-9]+]])
+; CHECK: ![[FOOVARS]] = !{![[X:[0-9]+]]}
+; CHECK: ![[X]] = !DILocalVariable(name: "x"
+; CHECK: distinct !DISubprogram(name: "bar", {{.*}}, unit: !{{[0-9]+}})
+; CHECK-NOT: name: "unused"
+
+; RUN: llvm-lto -thinlto-action=import %t1.bc -thinlto-index=%t.index.bc -o - \
+; RUN:     -import-all-subprogram-variables | llvm-dis -o - | FileCheck %s --check-prefix=ALL
+; ALL: distinct !DISubprogram(name: "bar", {{.*}}, variables: ![[BARVARS:[0-9]+]])
+; ALL: ![[BARVARS]] = !{!{{[0-9]+}}, ![[UNUSED:[0-9]+]]}
+; ALL: ![[UNUSED]] = !DILocalVariable(name: "unused"
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @main() {
+entry:
+  %r = call i32 @foo(i32 1)
+  ret i32 %r
+}
+
+declare i32 @foo(i32)
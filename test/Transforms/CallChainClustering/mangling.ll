@@ -0,0 +1,42 @@
+; RUN: opt -call-chain-clustering -call-chain-clustering-order-file=%t -disable-output < %s
+; RUN: FileCheck %s < %t
+; RUN: not opt -call-chain-clustering \
+; RUN:   -call-chain-clustering-order-file=%t.missing/order -disable-output \
+; RUN:   < %s 2>&1 | FileCheck %s --check-prefix=ERR
+
+; The order file lists the symbol names the linker sees: Mach-O prefixes them
+; with an underscore, except for the names starting with \01.
+
+target datalayout = "e-m:o-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-apple-macosx10.12.0"
+
+; CHECK:      {{^}}_caller{{$}}
+; CHECK-NEXT: {{^}}verbatim{{$}}
+
+; ERR: error: cannot open call-chain clustering order file '{{.*}}order'
+
+define void @caller() !prof !15 {
+  call void @"\01verbatim"()
+  ret void
+}
+
+define void @"\01verbatim"() !prof !15 {
+  ret void
+}
+
+!llvm.module.flags = !{!1}
+!1 = !{i32 1, !"ProfileSummary", !2}
+!2 = !{!3, !4, !5, !6, !7, !8, !9, !10}
+!3 = !{!"ProfileFormat", !"InstrProf"}
+!4 = !{!"TotalCount", i64 10000}
+!5 = !{!"MaxCount", i64 1000}
+!6 = !{!"MaxInternalCount", i64 1}
+!7 = !{!"MaxFunctionCount", i64 1000}
+!8 = !{!"NumCounts", i64 2}
+!9 = !{!"NumFunctions", i64 2}
+!10 = !{!"DetailedSummary", !11}
+!11 = !{!12, !13, !14}
+!12 = !{i32 10000, i64 100, i32 1}
+!13 = !{i32 999000, i64 100, i32 1}
+!14 = !{i32 999999, i64 1, i32 2}
+!15 = !{!"function_entry_count", i64 1000}
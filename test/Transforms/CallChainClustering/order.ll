@@ -0,0 +1,62 @@
+; RUN: opt -call-chain-clustering -call-chain-clustering-order-file=%t -disable-output < %s
+; RUN: FileCheck %s < %t
+; RUN: opt -passes=call-chain-clustering -call-chain-clustering-order-file=%t.npm -disable-output < %s
+; RUN: FileCheck %s < %t.npm
+
+; The callees are laid out right after their most frequent caller, and the
+; denser cluster of @a, @b and @c comes first. @cold never ran and is left out.
+
+; CHECK:      {{^}}a{{$}}
+; CHECK-NEXT: {{^}}b{{$}}
+; CHECK-NEXT: {{^}}c{{$}}
+; CHECK-NEXT: {{^}}e{{$}}
+; CHECK-NEXT: {{^}}d{{$}}
+; CHECK-NOT:  cold
+
+define void @a() !prof !15 {
+  call void @b()
+  call void @c()
+  ret void
+}
+
+define void @b() !prof !15 {
+  ret void
+}
+
+define void @c() !prof !16 {
+  ret void
+}
+
+define void @d() !prof !17 {
+  ret void
+}
+
+define void @e() !prof !17 {
+  call void @d()
+  ret void
+}
+
+define void @cold() !prof !18 {
+  call void @a()
+  ret void
+}
+
+!llvm.module.flags = !{!1}
+!1 = !{i32 1, !"ProfileSummary", !2}
+!2 = !{!3, !4, !5, !6, !7, !8, !9, !10}
+!3 = !{!"ProfileFormat", !"InstrProf"}
+!4 = !{!"TotalCount", i64 10000}
+!5 = !{!"MaxCount", i64 1000}
+!6 = !{!"MaxInternalCount", i64 1}
+!7 = !{!"MaxFunctionCount", i64 1000}
+!8 = !{!"NumCounts", i64 3}
+!9 = !{!"NumFunctions", i64 3}
+!10 = !{!"DetailedSummary", !11}
+!11 = !{!12, !13, !14}
+!12 = !{i32 10000, i64 100, i32 1}
+!13 = !{i32 999000, i64 100, i32 1}
+!14 = !{i32 999999, i64 1, i32 2}
+!15 = !{!"function_entry_count", i64 1000}
+!16 = !{!"function_entry_count", i64 10}
+!17 = !{!"function_entry_count", i64 500}
+!18 = !{!"function_entry_count", i64 0}
@@ -0,0 +1,67 @@
+; Check that the LazyValueInfo cache computed for jump threading is reused by
+; correlated value propagation instead of being computed again.
+;
+; RUN: opt < %s -jump-threading -correlated-propagation -disable-output \
+; RUN:   -debug-pass=Structure 2>&1 | FileCheck %s
+; RUN: opt < %s -passes='jump-threading,correlated-propagation,jump-threading' \
+; RUN:   -disable-output -debug-pass-manager 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=NEWPM
+; RUN: opt < %s -jump-threading -correlated-propagation -S | FileCheck %s \
+; RUN:   --check-prefix=IR
+
+; CHECK: Lazy Value Information Analysis
+; CHECK-NEXT: Jump Threading
+; CHECK-NEXT: Value Propagation
+
+; NEWPM: Running pass: JumpThreadingPass
+; NEWPM: Running analysis: LazyValueAnalysis
+; NEWPM-NOT: Invalidating analysis: LazyValueAnalysis
+; NEWPM-NOT: Running analysis: LazyValueAnalysis
+; NEWPM: Running pass: CorrelatedValuePropagationPass
+; NEWPM-NOT: Invalidating analysis: LazyValueAnalysis
+; NEWPM-NOT: Running analysis: LazyValueAnalysis
+; NEWPM: Running pass: JumpThreadingPass
+; NEWPM-NOT: Running analysis: LazyValueAnalysis
+
+; IR-LABEL: define i32 @f(
+; IR: [[COND:%.*]] = icmp eq i32 %x, 1
+; IR-NEXT: br i1 [[COND]], label %one, label %default
+; IR-LABEL: one:
+; IR-NEXT: ret i32 1
+
+define i32 @f(i1 %c, i32 %x) {
+entry:
+  br i1 %c, label %a, label %b
+
+a:
+  br label %merge
+
+b:
+  br label %merge
+
+merge:
+  %p = phi i1 [ true, %a ], [ false, %b ]
+  br i1 %p, label %check, label %exit
+
+check:
+  %small = icmp ult i32 %x, 2
+  br i1 %small, label %sw, label %exit
+
+sw:
+  switch i32 %x, label %default [
+    i32 1, label %one
+    i32 5, label %five
+  ]
+
+one:
+  ret i32 1
+
+five:
+  ret i32 5
+
+default:
+  ret i32 0
+
+exit:
+  ret i32 -1
+}
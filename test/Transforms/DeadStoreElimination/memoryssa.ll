@@ -0,0 +1,153 @@
+; RUN: opt < %s -basicaa -dse -enable-dse-memoryssa -S | FileCheck %s
+; RUN: opt < %s -aa-pipeline=basic-aa -passes=dse -enable-dse-memoryssa -S | FileCheck %s
+target datalayout = "e-m:e-i64:64-n32:64"
+
+declare void @unknown()
+declare void @may_throw() readnone
+declare void @use(i32*)
+
+; A store overwritten later in the same block.
+define void @same_block(i32* %P) {
+; CHECK-LABEL: @same_block(
+; CHECK-NEXT:    store i32 2, i32* %P
+; CHECK-NEXT:    ret void
+  store i32 1, i32* %P
+  store i32 2, i32* %P
+  ret void
+}
+
+; A store overwritten in a block post-dominating it.
+define void @post_dominated(i32* %P, i1 %c) {
+; CHECK-LABEL: @post_dominated(
+; CHECK-NEXT:  entry:
+; CHECK-NEXT:    br i1 %c
+; CHECK:       join:
+; CHECK-NEXT:    store i32 2, i32* %P
+entry:
+  store i32 1, i32* %P
+  br i1 %c, label %then, label %join
+then:
+  br label %join
+join:
+  store i32 2, i32* %P
+  ret void
+}
+
+; The store is read on one of the paths.
+define i32 @read_on_path(i32* %P, i1 %c) {
+; CHECK-LABEL: @read_on_path(
+; CHECK:         store i32 1, i32* %P
+; CHECK:         store i32 2, i32* %P
+entry:
+  store i32 1, i32* %P
+  br i1 %c, label %then, label %join
+then:
+  %v = load i32, i32* %P
+  br label %join
+join:
+  %r = phi i32 [ %v, %then ], [ 0, %entry ]
+  store i32 2, i32* %P
+  ret i32 %r
+}
+
+; The store is only overwritten on one of the paths.
+define void @not_post_dominated(i32* %P, i1 %c) {
+; CHECK-LABEL: @not_post_dominated(
+; CHECK:         store i32 1, i32* %P
+; CHECK:         store i32 2, i32* %P
+entry:
+  store i32 1, i32* %P
+  br i1 %c, label %then, label %exit
+then:
+  store i32 2, i32* %P
+  br label %exit
+exit:
+  ret void
+}
+
+; Stores to a local object that is not read anymore.
+define void @local_object(i1 %c) {
+; CHECK-LABEL: @local_object(
+; CHECK-NOT:     store
+; CHECK:         ret void
+entry:
+  %A = alloca i32
+  store i32 1, i32* %A
+  br i1 %c, label %then, label %exit
+then:
+  call void @unknown()
+  br label %exit
+exit:
+  ret void
+}
+
+; The local object escapes to a call that may read it.
+define void @local_object_escapes() {
+; CHECK-LABEL: @local_object_escapes(
+; CHECK:         store i32 1, i32* %A
+; CHECK-NEXT:    call void @use(i32* %A)
+  %A = alloca i32
+  store i32 1, i32* %A
+  call void @use(i32* %A)
+  ret void
+}
+
+; Storing back the value loaded from the same pointer.
+define void @noop_store(i32* %P, i32* noalias %Q) {
+; CHECK-LABEL: @noop_store(
+; CHECK-NEXT:    store i32 0, i32* %Q
+; CHECK-NEXT:    ret void
+  %v = load i32, i32* %P
+  store i32 0, i32* %Q
+  store i32 %v, i32* %P
+  ret void
+}
+
+; The pointer is written and read between the load and the store.
+define i32 @not_noop_store(i32* %P) {
+; CHECK-LABEL: @not_noop_store(
+; CHECK:         store i32 0, i32* %P
+; CHECK-NEXT:    [[W:%.*]] = load i32, i32* %P
+; CHECK-NEXT:    store i32 %v, i32* %P
+  %v = load i32, i32* %P
+  store i32 0, i32* %P
+  %w = load i32, i32* %P
+  store i32 %v, i32* %P
+  ret i32 %w
+}
+
+; The store is visible to the caller if @may_throw unwinds.
+define void @may_throw_between(i32* %P) {
+; CHECK-LABEL: @may_throw_between(
+; CHECK-NEXT:    store i32 1, i32* %P
+; CHECK-NEXT:    call void @may_throw()
+; CHECK-NEXT:    store i32 2, i32* %P
+  store i32 1, i32* %P
+  call void @may_throw()
+  store i32 2, i32* %P
+  ret void
+}
+
+; The store to A[i] is read through A[i - 1] in the next iteration.
+define i32 @loop_carried(i64 %n) {
+; CHECK-LABEL: @loop_carried(
+; CHECK:         store i32 %iv.trunc, i32* %cur
+entry:
+  %A = alloca [16 x i32]
+  br label %loop
+loop:
+  %iv = phi i64 [ 1, %entry ], [ %iv.next, %loop ]
+  %sum = phi i32 [ 0, %entry ], [ %sum.next, %loop ]
+  %prev.idx = sub i64 %iv, 1
+  %prev = getelementptr [16 x i32], [16 x i32]* %A, i64 0, i64 %prev.idx
+  %v = load i32, i32* %prev
+  %sum.next = add i32 %sum, %v
+  %cur = getelementptr [16 x i32], [16 x i32]* %A, i64 0, i64 %iv
+  %iv.trunc = trunc i64 %iv to i32
+  store i32 %iv.trunc, i32* %cur
+  %iv.next = add i64 %iv, 1
+  %cond = icmp ult i64 %iv.next, %n
+  br i1 %cond, label %loop, label %exit
+exit:
+  ret i32 %sum.next
+}
@@ -0,0 +1,146 @@
+; RUN: opt -hotcoldsplit -S < %s | FileCheck %s
+; RUN: opt -passes=hotcoldsplit -S < %s | FileCheck %s
+
+target triple = "x86_64-pc-linux-gnu"
+
+; The error path ends in unreachable: it is outlined, along with the block that
+; only leads to it.
+
+; CHECK-LABEL: define i32 @error_path(
+; CHECK:       entry:
+; CHECK:         br i1 %c, label %[[REPL:.*]], label %ok
+; CHECK:       [[REPL]]:
+; CHECK-NEXT:    call void @error_path_fail(i32 %x)
+; CHECK:       ok:
+; CHECK-NEXT:    ret i32 %x
+define i32 @error_path(i1 %c, i32 %x) {
+entry:
+  br i1 %c, label %fail, label %ok
+
+fail:
+  call void @log(i32 %x)
+  call void @log(i32 0)
+  br label %abort
+
+abort:
+  call void @log(i32 1)
+  call void @abort()
+  unreachable
+
+ok:
+  ret i32 %x
+}
+
+; A block calling a cold function is outlined too.
+
+; CHECK-LABEL: define void @cold_call(
+; CHECK:         call void @cold_call_if.then(i32 %x)
+define void @cold_call(i1 %c, i32 %x) {
+entry:
+  br i1 %c, label %if.then, label %if.end
+
+if.then:
+  call void @log(i32 %x)
+  call void @log(i32 2)
+  call void @report() cold
+  br label %if.end
+
+if.end:
+  ret void
+}
+
+; The cold branch is taken only once in the profile.
+
+; CHECK-LABEL: define void @profiled(
+; CHECK:         call void @profiled_if.then(i32 %x)
+define void @profiled(i1 %c, i32 %x) !prof !15 {
+entry:
+  br i1 %c, label %if.then, label %if.end, !prof !16
+
+if.then:
+  call void @log(i32 %x)
+  call void @log(i32 3)
+  call void @log(i32 4)
+  br label %if.end
+
+if.end:
+  ret void
+}
+
+; Small cold regions are not worth a call.
+
+; CHECK-LABEL: define void @too_small(
+; CHECK:       fail:
+; CHECK-NEXT:    call void @abort()
+define void @too_small(i1 %c) {
+entry:
+  br i1 %c, label %fail, label %ok
+
+fail:
+  call void @abort()
+  unreachable
+
+ok:
+  ret void
+}
+
+; All the cold regions of a function are outlined in one go.
+
+; CHECK-LABEL: define i32 @two_regions(
+; CHECK:         call void @two_regions_fail1(i32 %x)
+; CHECK:       mid:
+; CHECK:         call void @two_regions_fail2(i32 %y)
+; CHECK:       ok:
+; CHECK-NEXT:    ret i32 %x
+define i32 @two_regions(i1 %c1, i1 %c2, i32 %x, i32 %y) {
+entry:
+  br i1 %c1, label %fail1, label %mid
+
+fail1:
+  call void @log(i32 %x)
+  call void @log(i32 0)
+  call void @abort()
+  unreachable
+
+mid:
+  br i1 %c2, label %fail2, label %ok
+
+fail2:
+  call void @log(i32 %y)
+  call void @log(i32 1)
+  call void @abort()
+  unreachable
+
+ok:
+  ret i32 %x
+}
+
+; CHECK: define internal void @error_path_fail(i32 %x) [[ATTRS:#[0-9]+]] !section_prefix ![[UNLIKELY:[0-9]+]]
+; CHECK: define internal void @cold_call_if.then(i32 %x) [[ATTRS]] !section_prefix ![[UNLIKELY]]
+; CHECK: define internal void @profiled_if.then(i32 %x) [[ATTRS]] !prof {{.*}} !section_prefix ![[UNLIKELY]]
+; CHECK: define internal void @two_regions_fail2(i32 %y) [[ATTRS]] !section_prefix ![[UNLIKELY]]
+; CHECK: define internal void @two_regions_fail1(i32 %x) [[ATTRS]] !section_prefix ![[UNLIKELY]]
+; CHECK: attributes [[ATTRS]] = { cold minsize noinline }
+; CHECK: ![[UNLIKELY]] = !{!"function_section_prefix", !".unlikely"}
+
+declare void @log(i32)
+declare void @report()
+declare void @abort() noreturn
+
+!llvm.module.flags = !{!1}
+!1 = !{i32 1, !"ProfileSummary", !2}
+!2 = !{!3, !4, !5, !6, !7, !8, !9, !10}
+!3 = !{!"ProfileFormat", !"InstrProf"}
+!4 = !{!"TotalCount", i64 10000}
+!5 = !{!"MaxCount", i64 1000}
+!6 = !{!"MaxInternalCount", i64 1}
+!7 = !{!"MaxFunctionCount", i64 1000}
+!8 = !{!"NumCounts", i64 3}
+!9 = !{!"NumFunctions", i64 3}
+!10 = !{!"DetailedSummary", !11}
+!11 = !{!12, !13, !14}
+!12 = !{i32 10000, i64 100, i32 1}
+!13 = !{i32 999000, i64 100, i32 1}
+!14 = !{i32 999999, i64 1, i32 2}
+!15 = !{!"function_entry_count", i64 1000}
+!16 = !{!"branch_weights", i32 1, i32 1000}
@@ -0,0 +1,36 @@
+; REQUIRES: asserts
+; RUN: opt -S -inline < %s | FileCheck %s
+; RUN: opt -S -inline -inline-cost-cache=false < %s | FileCheck %s
+; RUN: opt -disable-output -inline -stats < %s 2>&1 \
+; RUN:   | FileCheck %s -check-prefix=STATS
+; RUN: opt -disable-output -inline -inline-cost-cache=false -stats < %s 2>&1 \
+; RUN:   | FileCheck %s -check-prefix=NOCACHE
+
+; The legacy inliner goes around its worklist again after inlining @small, and
+; the cost of the call to @big is reused as neither @caller nor @big changed
+; since it was computed.
+
+; CHECK-LABEL: define void @caller(
+; CHECK-NOT: call void @small
+; CHECK: call void @big
+
+; STATS: 1 inline - Number of inline costs reused from the cache
+; NOCACHE-NOT: Number of inline costs reused from the cache
+
+declare void @ext(i32)
+
+define void @small() {
+  call void @ext(i32 0)
+  ret void
+}
+
+define void @big() noinline {
+  call void @ext(i32 1)
+  ret void
+}
+
+define void @caller() {
+  call void @small()
+  call void @big()
+  ret void
+}
@@ -0,0 +1,36 @@
+; RUN: opt < %s -instcombine -S | FileCheck %s
+; RUN: opt < %s -instcombine -instcombine-cache-known-bits -S | FileCheck %s
+; RUN: opt < %s -instcombine -instcombine-cache-known-bits -disable-output -stats 2>&1 | FileCheck %s --check-prefix=STATS
+; RUN: opt < %s -instcombine -disable-output -stats 2>&1 | FileCheck %s --check-prefix=NOCACHE
+; REQUIRES: asserts
+
+; The cached known bits give the same result as the uncached ones.
+define i32 @test(i32 %x, i32 %y) {
+; CHECK-LABEL: @test(
+; CHECK-NEXT:    [[A:%.*]] = and i32 %x, 15
+; CHECK-NEXT:    [[B:%.*]] = and i32 %y, 240
+; CHECK-NEXT:    [[C:%.*]] = or i32 [[A]], [[B]]
+; CHECK-NEXT:    ret i32 [[C]]
+;
+  %a = and i32 %x, 15
+  %b = and i32 %y, 240
+  %c = add i32 %a, %b
+  %d = and i32 %c, 256
+  %e = or i32 %c, %d
+  ret i32 %e
+}
+
+; The recursive queries on the shared operand are answered from the cache.
+define i32 @shared(i32 %x) {
+; CHECK-LABEL: @shared(
+; CHECK-NEXT:    ret i32 0
+;
+  %a = and i32 %x, 15
+  %m = mul i32 %a, %a
+  %r = and i32 %m, 256
+  ret i32 %r
+}
+
+; STATS: {{[0-9]+}} value-tracking - Number of known bits queries answered from the cache
+; STATS: {{[0-9]+}} value-tracking - Number of known bits queries missing the cache
+; NOCACHE-NOT: value-tracking - Number of known bits queries
@@ -0,0 +1,17 @@
+; RUN: opt < %s -instcombine -S -pass-remarks-analysis=instcombine 2>&1 | FileCheck %s --check-prefixes=CHECK,DEFAULT
+; RUN: opt < %s -instcombine -instcombine-max-iterations=1 -S -pass-remarks-analysis=instcombine 2>&1 | FileCheck %s --check-prefixes=CHECK,ONE
+
+; DEFAULT: remark: {{.*}}stopped after 2 iterations and {{[0-9]+}} visits
+; ONE: remark: {{.*}}stopped after 1 iterations and {{[0-9]+}} visits
+
+; The worklist reaches the fixpoint on its own, so one sweep gives the same
+; result as sweeping until nothing changes.
+define i32 @test(i32 %x) {
+; CHECK-LABEL: @test(
+; CHECK-NEXT:    ret i32 %x
+;
+  %a = add i32 %x, 0
+  %b = mul i32 %a, 1
+  %c = or i32 %b, 0
+  ret i32 %c
+}
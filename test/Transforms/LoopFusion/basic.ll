@@ -0,0 +1,247 @@
+; RUN: opt -basicaa -loop-fusion -verify-loop-info -verify-dom-info -S < %s \
+; RUN:   | FileCheck %s
+; RUN: opt -basicaa -loop-fusion -loop-fusion-register-budget=4 -S < %s \
+; RUN:   | FileCheck %s --check-prefix=BUDGET
+; RUN: opt -aa-pipeline=basic-aa -passes=loop-fusion -S < %s | FileCheck %s
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; Three successive loops over the same arrays are fused into one:
+;   for (i = 0; i < 1024; i++) A[i] = B[i] * 2;
+;   for (i = 0; i < 1024; i++) C[i] = A[i] + 1;
+;   for (i = 0; i < 1024; i++) D[i] = C[i] + A[i - 1];
+
+; CHECK-LABEL: @chain(
+; CHECK:       l1:
+; CHECK:         store float %mul, float* %ap
+; CHECK-NEXT:    %i.next = add nuw nsw i64
+; CHECK-NEXT:    br label %l2
+; CHECK:       l2:
+; CHECK:         store float %add, float* %cp
+; CHECK-NEXT:    %j.next = add nuw nsw i64
+; CHECK-NEXT:    br label %l3
+; CHECK:       l3:
+; CHECK:         br i1 %c3, label %l1, label %exit
+
+; The two loops of the pair already keep five registers occupied.
+; BUDGET-LABEL: @chain(
+; BUDGET:         br i1 %c1, label %l1, label %l2.ph
+; BUDGET:         br i1 %c2, label %l2, label %l3.ph
+
+define void @chain(float* noalias %a, float* noalias %b, float* noalias %c,
+                   float* noalias %d) {
+entry:
+  br label %l1
+
+l1:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %l1 ]
+  %bp = getelementptr inbounds float, float* %b, i64 %i
+  %bv = load float, float* %bp
+  %mul = fmul float %bv, 2.0
+  %ap = getelementptr inbounds float, float* %a, i64 %i
+  store float %mul, float* %ap
+  %i.next = add nuw nsw i64 %i, 1
+  %c1 = icmp ne i64 %i.next, 1024
+  br i1 %c1, label %l1, label %l2.ph
+
+l2.ph:
+  br label %l2
+
+l2:
+  %j = phi i64 [ 0, %l2.ph ], [ %j.next, %l2 ]
+  %ap2 = getelementptr inbounds float, float* %a, i64 %j
+  %av = load float, float* %ap2
+  %add = fadd float %av, 1.0
+  %cp = getelementptr inbounds float, float* %c, i64 %j
+  store float %add, float* %cp
+  %j.next = add nuw nsw i64 %j, 1
+  %c2 = icmp ne i64 %j.next, 1024
+  br i1 %c2, label %l2, label %l3.ph
+
+l3.ph:
+  br label %l3
+
+l3:
+  %k = phi i64 [ 0, %l3.ph ], [ %k.next, %l3 ]
+  %cp3 = getelementptr inbounds float, float* %c, i64 %k
+  %cv = load float, float* %cp3
+  %km1 = add nsw i64 %k, -1
+  %ap3 = getelementptr float, float* %a, i64 %km1
+  %av3 = load float, float* %ap3
+  %sum = fadd float %cv, %av3
+  %dp = getelementptr inbounds float, float* %d, i64 %k
+  store float %sum, float* %dp
+  %k.next = add nuw nsw i64 %k, 1
+  %c3 = icmp ne i64 %k.next, 1024
+  br i1 %c3, label %l3, label %exit
+
+exit:
+  ret void
+}
+
+; The second loop reads A[i + 1] before the first loop would have written it.
+
+; CHECK-LABEL: @forward_read(
+; CHECK:         br i1 %c1, label %l1, label %l2.ph
+; CHECK:         br i1 %c2, label %l2, label %exit
+
+define void @forward_read(float* noalias %a, float* noalias %b,
+                          float* noalias %c) {
+entry:
+  br label %l1
+
+l1:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %l1 ]
+  %bp = getelementptr inbounds float, float* %b, i64 %i
+  %bv = load float, float* %bp
+  %ap = getelementptr inbounds float, float* %a, i64 %i
+  store float %bv, float* %ap
+  %i.next = add nuw nsw i64 %i, 1
+  %c1 = icmp ne i64 %i.next, 1024
+  br i1 %c1, label %l1, label %l2.ph
+
+l2.ph:
+  br label %l2
+
+l2:
+  %j = phi i64 [ 0, %l2.ph ], [ %j.next, %l2 ]
+  %jp1 = add nuw nsw i64 %j, 1
+  %ap2 = getelementptr inbounds float, float* %a, i64 %jp1
+  %av = load float, float* %ap2
+  %cp = getelementptr inbounds float, float* %c, i64 %j
+  store float %av, float* %cp
+  %j.next = add nuw nsw i64 %j, 1
+  %c2 = icmp ne i64 %j.next, 1024
+  br i1 %c2, label %l2, label %exit
+
+exit:
+  ret void
+}
+
+; The second loop overwrites B[i + 1] before the first loop would have read
+; it.
+
+; CHECK-LABEL: @anti_dependence(
+; CHECK:         br i1 %c1, label %l1, label %l2.ph
+; CHECK:         br i1 %c2, label %l2, label %exit
+
+define void @anti_dependence(float* noalias %a, float* noalias %b) {
+entry:
+  br label %l1
+
+l1:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %l1 ]
+  %bp = getelementptr inbounds float, float* %b, i64 %i
+  %bv = load float, float* %bp
+  %ap = getelementptr inbounds float, float* %a, i64 %i
+  store float %bv, float* %ap
+  %i.next = add nuw nsw i64 %i, 1
+  %c1 = icmp ne i64 %i.next, 1024
+  br i1 %c1, label %l1, label %l2.ph
+
+l2.ph:
+  br label %l2
+
+l2:
+  %j = phi i64 [ 0, %l2.ph ], [ %j.next, %l2 ]
+  %jp1 = add nuw nsw i64 %j, 1
+  %bp2 = getelementptr inbounds float, float* %b, i64 %jp1
+  store float 0.0, float* %bp2
+  %j.next = add nuw nsw i64 %j, 1
+  %c2 = icmp ne i64 %j.next, 1024
+  br i1 %c2, label %l2, label %exit
+
+exit:
+  ret void
+}
+
+; CHECK-LABEL: @trip_count_mismatch(
+; CHECK:         br i1 %c1, label %l1, label %l2.ph
+; CHECK:         br i1 %c2, label %l2, label %exit
+
+define void @trip_count_mismatch(float* noalias %a, float* noalias %b) {
+entry:
+  br label %l1
+
+l1:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %l1 ]
+  %ap = getelementptr inbounds float, float* %a, i64 %i
+  store float 0.0, float* %ap
+  %i.next = add nuw nsw i64 %i, 1
+  %c1 = icmp ne i64 %i.next, 1024
+  br i1 %c1, label %l1, label %l2.ph
+
+l2.ph:
+  br label %l2
+
+l2:
+  %j = phi i64 [ 0, %l2.ph ], [ %j.next, %l2 ]
+  %bp = getelementptr inbounds float, float* %b, i64 %j
+  store float 0.0, float* %bp
+  %j.next = add nuw nsw i64 %j, 1
+  %c2 = icmp ne i64 %j.next, 512
+  br i1 %c2, label %l2, label %exit
+
+exit:
+  ret void
+}
+
+; The inner loops of a 2D kernel are fused within each outer iteration:
+;   for (i = 0; i < 64; i++) {
+;     for (j = 0; j < 64; j++) B[i][j] = A[i][j] * 2;
+;     for (j = 0; j < 64; j++) C[i][j] = B[i][j] + 1;
+;   }
+
+; CHECK-LABEL: @inner_siblings(
+; CHECK:       inner1:
+; CHECK:         store float %mul, float* %bp
+; CHECK-NEXT:    %j.next = add nuw nsw i64
+; CHECK-NEXT:    br label %inner2
+; CHECK:       inner2:
+; CHECK:         br i1 %c2, label %inner1, label %outer.latch
+; CHECK:       outer.latch:
+; CHECK:         br i1 %c3, label %outer, label %exit
+
+define void @inner_siblings([64 x float]* noalias %a, [64 x float]* noalias %b,
+                            [64 x float]* noalias %c) {
+entry:
+  br label %outer
+
+outer:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner1
+
+inner1:
+  %j = phi i64 [ 0, %outer ], [ %j.next, %inner1 ]
+  %ap = getelementptr inbounds [64 x float], [64 x float]* %a, i64 %i, i64 %j
+  %av = load float, float* %ap
+  %mul = fmul float %av, 2.0
+  %bp = getelementptr inbounds [64 x float], [64 x float]* %b, i64 %i, i64 %j
+  store float %mul, float* %bp
+  %j.next = add nuw nsw i64 %j, 1
+  %c1 = icmp ne i64 %j.next, 64
+  br i1 %c1, label %inner1, label %inner2.ph
+
+inner2.ph:
+  br label %inner2
+
+inner2:
+  %k = phi i64 [ 0, %inner2.ph ], [ %k.next, %inner2 ]
+  %bp2 = getelementptr inbounds [64 x float], [64 x float]* %b, i64 %i, i64 %k
+  %bv = load float, float* %bp2
+  %add = fadd float %bv, 1.0
+  %cp = getelementptr inbounds [64 x float], [64 x float]* %c, i64 %i, i64 %k
+  store float %add, float* %cp
+  %k.next = add nuw nsw i64 %k, 1
+  %c2 = icmp ne i64 %k.next, 64
+  br i1 %c2, label %inner2, label %outer.latch
+
+outer.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %c3 = icmp ne i64 %i.next, 64
+  br i1 %c3, label %outer, label %exit
+
+exit:
+  ret void
+}
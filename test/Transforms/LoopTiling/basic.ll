@@ -0,0 +1,213 @@
+; RUN: opt -basicaa -loop-tiling -verify-loop-info -verify-dom-info -S < %s \
+; RUN:   | FileCheck %s
+; RUN: opt -basicaa -loop-tiling -loop-tile-size=8 -S < %s \
+; RUN:   | FileCheck %s --check-prefix=SIZE
+; RUN: opt -aa-pipeline=basic-aa -passes=loop-tiling -S < %s | FileCheck %s
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; A tile of each of the three float matrices fits in half of the 32K L1 cache
+; of x86 with 32 iterations on a side.
+;   for (i = 0; i < 256; i++)
+;     for (j = 0; j < 256; j++)
+;       for (k = 0; k < 256; k++)
+;         C[i][j] += A[i][k] * B[k][j];
+
+; CHECK-LABEL: @matmul(
+; CHECK:       i.tile.header:
+; CHECK-NEXT:    %i.tile = phi i64 [ 0, %entry ], [ %i.tile.next, %i.tile.latch ]
+; CHECK-NEXT:    br label %j.tile.header
+; CHECK:       j.tile.header:
+; CHECK-NEXT:    %j.tile = phi i64 [ 0, %i.tile.header ], [ %j.tile.next, %j.tile.latch ]
+; CHECK-NEXT:    br label %k.tile.header
+; CHECK:       k.tile.header:
+; CHECK-NEXT:    %k.tile = phi i64 [ 0, %j.tile.header ], [ %k.tile.next, %k.tile.latch ]
+; CHECK-NEXT:    %i.tile.start = add i64 0, %i.tile
+; CHECK:         %i.tile.end = add i64 0,
+; CHECK-NEXT:    br label %i.header
+; CHECK:       i.header:
+; CHECK-NEXT:    %i = phi i64 [ %i.tile.start, %k.tile.header ], [ %i.next, %i.latch ]
+; CHECK:       k.body:
+; CHECK:         store float
+; CHECK:         [[KC:%.*]] = icmp ne i64 %k.next, %k.tile.end
+; CHECK-NEXT:    br i1 [[KC]], label %k.body, label %j.latch
+; CHECK:       i.latch:
+; CHECK:         [[IC:%.*]] = icmp ne i64 %i.next, %i.tile.end
+; CHECK-NEXT:    br i1 [[IC]], label %i.header, label %k.tile.latch
+; CHECK:       k.tile.latch:
+; CHECK-NEXT:    %k.tile.left = sub i64 256, %k.tile
+; CHECK-NEXT:    %k.tile.more = icmp ugt i64 %k.tile.left, 32
+; CHECK-NEXT:    %k.tile.next = add i64 %k.tile, 32
+; CHECK-NEXT:    br i1 %k.tile.more, label %k.tile.header, label %j.tile.latch
+; CHECK:       j.tile.latch:
+; CHECK:         br i1 %j.tile.more, label %j.tile.header, label %i.tile.latch
+; CHECK:       i.tile.latch:
+; CHECK-NEXT:    %i.tile.left = sub i64 256, %i.tile
+; CHECK-NEXT:    %i.tile.more = icmp ugt i64 %i.tile.left, 32
+; CHECK-NEXT:    %i.tile.next = add i64 %i.tile, 32
+; CHECK-NEXT:    br i1 %i.tile.more, label %i.tile.header, label %exit
+
+; SIZE-LABEL: @matmul(
+; SIZE:         %i.tile.next = add i64 %i.tile, 8
+
+define void @matmul([256 x float]* noalias %a, [256 x float]* noalias %b,
+                    [256 x float]* noalias %c) {
+entry:
+  br label %i.header
+
+i.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %i.latch ]
+  br label %j.header
+
+j.header:
+  %j = phi i64 [ 0, %i.header ], [ %j.next, %j.latch ]
+  br label %k.body
+
+k.body:
+  %k = phi i64 [ 0, %j.header ], [ %k.next, %k.body ]
+  %ap = getelementptr inbounds [256 x float], [256 x float]* %a, i64 %i, i64 %k
+  %av = load float, float* %ap
+  %bp = getelementptr inbounds [256 x float], [256 x float]* %b, i64 %k, i64 %j
+  %bv = load float, float* %bp
+  %mul = fmul float %av, %bv
+  %cp = getelementptr inbounds [256 x float], [256 x float]* %c, i64 %i, i64 %j
+  %cv = load float, float* %cp
+  %add = fadd float %cv, %mul
+  store float %add, float* %cp
+  %k.next = add nuw nsw i64 %k, 1
+  %kc = icmp ne i64 %k.next, 256
+  br i1 %kc, label %k.body, label %j.latch
+
+j.latch:
+  %j.next = add nuw nsw i64 %j, 1
+  %jc = icmp ne i64 %j.next, 256
+  br i1 %jc, label %j.header, label %i.latch
+
+i.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %ic = icmp ne i64 %i.next, 256
+  br i1 %ic, label %i.header, label %exit
+
+exit:
+  ret void
+}
+
+; An in-place stencil whose dependences all go forward in both loops:
+;   for (i = 1; i < 1024; i++)
+;     for (j = 1; j < 1024; j++)
+;       A[i][j] = A[i - 1][j] + A[i][j - 1];
+; A single double matrix fits with tiles of 45 iterations on a side, rounded
+; down to whole cache lines.
+
+; CHECK-LABEL: @seidel(
+; CHECK:       i.tile.header:
+; CHECK:       j.tile.header:
+; CHECK:         %i.tile.start = add i64 1, %i.tile
+; CHECK:       i.header:
+; CHECK-NEXT:    %i = phi i64 [ %i.tile.start, %j.tile.header ], [ %i.next, %i.latch ]
+; CHECK:       j.tile.latch:
+; CHECK-NEXT:    %j.tile.left = sub i64 1023, %j.tile
+; CHECK-NEXT:    %j.tile.more = icmp ugt i64 %j.tile.left, 40
+; CHECK-NEXT:    %j.tile.next = add i64 %j.tile, 40
+
+define void @seidel([1024 x double]* %a) {
+entry:
+  br label %i.header
+
+i.header:
+  %i = phi i64 [ 1, %entry ], [ %i.next, %i.latch ]
+  %im1 = add nsw i64 %i, -1
+  br label %j.body
+
+j.body:
+  %j = phi i64 [ 1, %i.header ], [ %j.next, %j.body ]
+  %jm1 = add nsw i64 %j, -1
+  %up = getelementptr inbounds [1024 x double], [1024 x double]* %a, i64 %im1, i64 %j
+  %upv = load double, double* %up
+  %left = getelementptr inbounds [1024 x double], [1024 x double]* %a, i64 %i, i64 %jm1
+  %leftv = load double, double* %left
+  %sum = fadd double %upv, %leftv
+  %p = getelementptr inbounds [1024 x double], [1024 x double]* %a, i64 %i, i64 %j
+  store double %sum, double* %p
+  %j.next = add nuw nsw i64 %j, 1
+  %jc = icmp ne i64 %j.next, 1024
+  br i1 %jc, label %j.body, label %i.latch
+
+i.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %ic = icmp ne i64 %i.next, 1024
+  br i1 %ic, label %i.header, label %exit
+
+exit:
+  ret void
+}
+
+; A[i][j] depends on A[i - 1][j + 1], which is computed in an earlier
+; iteration of the i loop but a later one of the j loop.
+
+; CHECK-LABEL: @skewed(
+; CHECK-NOT:     tile
+; CHECK:         ret void
+
+define void @skewed([1024 x double]* %a) {
+entry:
+  br label %i.header
+
+i.header:
+  %i = phi i64 [ 1, %entry ], [ %i.next, %i.latch ]
+  %im1 = add nsw i64 %i, -1
+  br label %j.body
+
+j.body:
+  %j = phi i64 [ 0, %i.header ], [ %j.next, %j.body ]
+  %jp1 = add nuw nsw i64 %j, 1
+  %src = getelementptr inbounds [1024 x double], [1024 x double]* %a, i64 %im1, i64 %jp1
+  %v = load double, double* %src
+  %p = getelementptr inbounds [1024 x double], [1024 x double]* %a, i64 %i, i64 %j
+  store double %v, double* %p
+  %j.next = add nuw nsw i64 %j, 1
+  %jc = icmp ne i64 %j.next, 1023
+  br i1 %jc, label %j.body, label %i.latch
+
+i.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %ic = icmp ne i64 %i.next, 1024
+  br i1 %ic, label %i.header, label %exit
+
+exit:
+  ret void
+}
+
+; The whole iteration space already fits in a tile.
+
+; CHECK-LABEL: @small(
+; CHECK-NOT:     tile
+; CHECK:         ret void
+
+define void @small([16 x float]* noalias %a, [16 x float]* noalias %b) {
+entry:
+  br label %i.header
+
+i.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %i.latch ]
+  br label %j.body
+
+j.body:
+  %j = phi i64 [ 0, %i.header ], [ %j.next, %j.body ]
+  %bp = getelementptr inbounds [16 x float], [16 x float]* %b, i64 %j, i64 %i
+  %bv = load float, float* %bp
+  %ap = getelementptr inbounds [16 x float], [16 x float]* %a, i64 %i, i64 %j
+  store float %bv, float* %ap
+  %j.next = add nuw nsw i64 %j, 1
+  %jc = icmp ne i64 %j.next, 16
+  br i1 %jc, label %j.body, label %i.latch
+
+i.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %ic = icmp ne i64 %i.next, 16
+  br i1 %ic, label %i.header, label %exit
+
+exit:
+  ret void
+}
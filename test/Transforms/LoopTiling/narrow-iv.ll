@@ -0,0 +1,76 @@
+; RUN: opt -basicaa -loop-tiling -loop-tile-size=16 -verify-loop-info \
+; RUN:   -verify-dom-info -S < %s | FileCheck %s
+; RUN: opt -basicaa -loop-tiling -loop-tile-size=249 -S < %s \
+; RUN:   | FileCheck %s --check-prefix=MAX
+; RUN: opt -basicaa -loop-tiling -loop-tile-size=256 -S < %s \
+; RUN:   | FileCheck %s --check-prefix=WIDE
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; The trip count of 250 leaves too little room in i8 for the start of the tile
+; after the last one, so the tile latch and the end of the point loops must be
+; computed from the iterations left in the loop.
+;   for (unsigned char i = 0; i != 250; i++)
+;     for (unsigned char j = 0; j != 250; j++)
+;       A[j][i] = i ^ j;
+
+; CHECK-LABEL: @transpose(
+; CHECK:       i.tile.header:
+; CHECK:       j.tile.header:
+; CHECK:         %i.tile.start = add i8 0, %i.tile
+; CHECK-NEXT:    %i.tile.rem = sub i8 -6, %i.tile
+; CHECK-NEXT:    [[ISMALL:%.*]] = icmp ult i8 %i.tile.rem, 16
+; CHECK-NEXT:    %i.tile.count = select i1 [[ISMALL]], i8 %i.tile.rem, i8 16
+; CHECK-NEXT:    [[IEND:%.*]] = add i8 %i.tile, %i.tile.count
+; CHECK-NEXT:    %i.tile.end = add i8 0, [[IEND]]
+; CHECK:       j.tile.latch:
+; CHECK-NEXT:    %j.tile.left = sub i8 -6, %j.tile
+; CHECK-NEXT:    %j.tile.more = icmp ugt i8 %j.tile.left, 16
+; CHECK-NEXT:    %j.tile.next = add i8 %j.tile, 16
+; CHECK-NEXT:    br i1 %j.tile.more, label %j.tile.header, label %i.tile.latch
+; CHECK:       i.tile.latch:
+; CHECK-NEXT:    %i.tile.left = sub i8 -6, %i.tile
+; CHECK-NEXT:    %i.tile.more = icmp ugt i8 %i.tile.left, 16
+; CHECK-NEXT:    %i.tile.next = add i8 %i.tile, 16
+; CHECK-NEXT:    br i1 %i.tile.more, label %i.tile.header, label %exit
+
+; A tile of 249 iterations leaves a last tile of one.
+
+; MAX-LABEL: @transpose(
+; MAX:         %i.tile.count = select i1 {{%.*}}, i8 %i.tile.rem, i8 -7
+; MAX:         %i.tile.more = icmp ugt i8 %i.tile.left, -7
+
+; A tile that does not fit in i8 is not.
+
+; WIDE-LABEL: @transpose(
+; WIDE-NOT:      tile
+; WIDE:          ret void
+
+define void @transpose([250 x i8]* noalias %a) {
+entry:
+  br label %i.header
+
+i.header:
+  %i = phi i8 [ 0, %entry ], [ %i.next, %i.latch ]
+  br label %j.body
+
+j.body:
+  %j = phi i8 [ 0, %i.header ], [ %j.next, %j.body ]
+  %v = xor i8 %i, %j
+  %i.wide = zext i8 %i to i64
+  %j.wide = zext i8 %j to i64
+  %p = getelementptr inbounds [250 x i8], [250 x i8]* %a, i64 %j.wide, i64 %i.wide
+  store i8 %v, i8* %p
+  %j.next = add nuw i8 %j, 1
+  %jc = icmp ne i8 %j.next, 250
+  br i1 %jc, label %j.body, label %i.latch
+
+i.latch:
+  %i.next = add nuw i8 %i, 1
+  %ic = icmp ne i8 %i.next, 250
+  br i1 %ic, label %i.header, label %exit
+
+exit:
+  ret void
+}
@@ -0,0 +1,115 @@
+; RUN: opt < %s -loop-vectorize -verify-loop-info -verify-dom-info -force-vector-width=16 -force-vector-interleave=4 -enable-epilogue-vectorization -epilogue-vectorization-force-VF=8 -S | FileCheck %s
+; RUN: opt < %s -loop-vectorize -force-vector-width=16 -force-vector-interleave=4 -S | FileCheck %s --check-prefix=DISABLED
+; RUN: opt < %s -loop-vectorize -force-vector-width=4 -force-vector-interleave=2 -enable-epilogue-vectorization -epilogue-vectorization-force-VF=2 -S | FileCheck %s --check-prefix=SMALL
+; RUN: opt < %s -loop-vectorize -force-vector-width=16 -force-vector-interleave=4 -enable-epilogue-vectorization -S | FileCheck %s --check-prefix=COST-SSE
+; RUN: opt < %s -loop-vectorize -mcpu=core-avx2 -force-vector-width=16 -force-vector-interleave=4 -enable-epilogue-vectorization -S | FileCheck %s --check-prefix=COST-AVX2
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; The vector loop leaves up to 63 iterations to the remainder loop, which is
+; vectorized in turn at VF 8, leaving at most 7 iterations to run scalar.
+;
+;   for (i = 0; i < n; i++)
+;     a[i] = b[i] + c[i];
+
+; CHECK-LABEL: @f(
+; CHECK:       vector.body:
+; CHECK:         load <16 x i32>
+; CHECK:       middle.block:
+; CHECK:       vector.body{{[0-9]+}}:
+; CHECK:         load <8 x i32>
+; CHECK:         load <8 x i32>
+; CHECK:         add nsw <8 x i32>
+; CHECK:         store <8 x i32>
+; CHECK:       middle.block{{[0-9]+}}:
+; CHECK:       for.body:
+; CHECK:         load i32
+; CHECK:         br i1 {{.*}}, label %for.end.loopexit.loopexit, label %for.body, !llvm.loop
+
+; DISABLED-LABEL: @f(
+; DISABLED:       load <16 x i32>
+; DISABLED-NOT:   load <8 x i32>
+
+; The vector loop leaves at most 7 iterations, too few to vectorize again.
+
+; SMALL-LABEL: @f(
+; SMALL:       load <4 x i32>
+; SMALL-NOT:   load <2 x i32>
+
+; Without a forced VF, the cost model picks the epilogue VF among the ones
+; narrower than 16: a full register of i32, 4 with SSE and 8 with AVX2.
+
+; COST-SSE-LABEL: @f(
+; COST-SSE:       vector.body:
+; COST-SSE:         load <16 x i32>
+; COST-SSE:       vector.body{{[0-9]+}}:
+; COST-SSE:         load <4 x i32>
+; COST-SSE:         store <4 x i32>
+; COST-SSE:       middle.block{{[0-9]+}}:
+
+; COST-AVX2-LABEL: @f(
+; COST-AVX2:       vector.body:
+; COST-AVX2:         load <16 x i32>
+; COST-AVX2:       vector.body{{[0-9]+}}:
+; COST-AVX2:         load <8 x i32>
+; COST-AVX2:         store <8 x i32>
+; COST-AVX2:       middle.block{{[0-9]+}}:
+
+define void @f(i32* noalias %a, i32* noalias %b, i32* noalias %c, i64 %n) {
+entry:
+  %cmp = icmp sgt i64 %n, 0
+  br i1 %cmp, label %for.body, label %for.end
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %arrayidx.b = getelementptr inbounds i32, i32* %b, i64 %i
+  %0 = load i32, i32* %arrayidx.b, align 4
+  %arrayidx.c = getelementptr inbounds i32, i32* %c, i64 %i
+  %1 = load i32, i32* %arrayidx.c, align 4
+  %add = add nsw i32 %1, %0
+  %arrayidx.a = getelementptr inbounds i32, i32* %a, i64 %i
+  store i32 %add, i32* %arrayidx.a, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; Without noalias, both vector loops need runtime checks. The remainder loop
+; gets a dedicated exit again to be versioned.
+
+; CHECK-LABEL: @g(
+; CHECK:       vector.memcheck:
+; CHECK:       vector.body:
+; CHECK:         load <16 x i32>
+; CHECK:       middle.block:
+; CHECK:       vector.memcheck{{[0-9]+}}:
+; CHECK:       vector.body{{[0-9]+}}:
+; CHECK:         load <8 x i32>
+; CHECK:         store <8 x i32>
+; CHECK:       middle.block{{[0-9]+}}:
+; CHECK:       for.body:
+; CHECK:         load i32
+
+define void @g(i32* %a, i32* %b, i64 %n) {
+entry:
+  %cmp = icmp sgt i64 %n, 0
+  br i1 %cmp, label %for.body, label %for.end
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %arrayidx.b = getelementptr inbounds i32, i32* %b, i64 %i
+  %0 = load i32, i32* %arrayidx.b, align 4
+  %add = add nsw i32 %0, 1
+  %arrayidx.a = getelementptr inbounds i32, i32* %a, i64 %i
+  store i32 %add, i32* %arrayidx.a, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
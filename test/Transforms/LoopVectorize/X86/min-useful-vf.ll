@@ -0,0 +1,101 @@
+; RUN: opt < %s -loop-vectorize -S | FileCheck %s
+; RUN: opt < %s -loop-vectorize -debug-only=loop-accesses -disable-output 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=DEBUG
+; REQUIRES: asserts
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; The dependence limits the vectorization factor to 4:
+;   for (i = 0; i < 1024; i++)
+;     A[i + 4] = A[i] * 2;
+; Without a width hint, the vectorizer picks a VF of 4.
+
+; CHECK-LABEL: @no_hint(
+; CHECK:         load <4 x i16>
+
+; A width of 8 is forced, which the dependence rules out: the dependence
+; analysis stops there.
+
+; CHECK-LABEL: @forced_width(
+; CHECK-NOT:     <8 x i16>
+; CHECK:         ret void
+
+; DEBUG-LABEL: LAA: Found a loop in forced_width:
+; DEBUG:         LAA: Stopped analyzing dependences, max VF = 4 is below the smallest useful VF 8
+; DEBUG-NEXT:    Total Dependences: 0
+
+define void @no_hint(i16* %a) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %arrayidx = getelementptr inbounds i16, i16* %a, i64 %i
+  %v = load i16, i16* %arrayidx, align 2
+  %mul = mul i16 %v, 2
+  %i.4 = add nuw nsw i64 %i, 4
+  %arrayidx.4 = getelementptr inbounds i16, i16* %a, i64 %i.4
+  store i16 %mul, i16* %arrayidx.4, align 2
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, 1024
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+define void @forced_width(i16* %a) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %arrayidx = getelementptr inbounds i16, i16* %a, i64 %i
+  %v = load i16, i16* %arrayidx, align 2
+  %mul = mul i16 %v, 2
+  %i.4 = add nuw nsw i64 %i, 4
+  %arrayidx.4 = getelementptr inbounds i16, i16* %a, i64 %i.4
+  store i16 %mul, i16* %arrayidx.4, align 2
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, 1024
+  br i1 %exitcond, label %for.end, label %for.body, !llvm.loop !0
+
+for.end:
+  ret void
+}
+
+; Another dependence of the loop has an unknown distance, so the loop is still
+; vectorized with the forced width, behind runtime checks.
+
+; CHECK-LABEL: @unknown_distance(
+; CHECK:       vector.memcheck:
+; CHECK:         load <8 x i16>
+
+define void @unknown_distance(i16* %a, i64 %n) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %arrayidx = getelementptr inbounds i16, i16* %a, i64 %i
+  %v = load i16, i16* %arrayidx, align 2
+  %mul = mul i16 %v, 2
+  %i.4 = add nuw nsw i64 %i, 4
+  %arrayidx.4 = getelementptr inbounds i16, i16* %a, i64 %i.4
+  store i16 %mul, i16* %arrayidx.4, align 2
+  %i.n = add nuw nsw i64 %i, %n
+  %arrayidx.n = getelementptr inbounds i16, i16* %a, i64 %i.n
+  %w = load i16, i16* %arrayidx.n, align 2
+  %add = add i16 %w, 1
+  store i16 %add, i16* %arrayidx.n, align 2
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, 1024
+  br i1 %exitcond, label %for.end, label %for.body, !llvm.loop !0
+
+for.end:
+  ret void
+}
+
+!0 = distinct !{!0, !1}
+!1 = !{!"llvm.loop.vectorize.width", i32 8}
@@ -0,0 +1,110 @@
+; RUN: opt < %s -loop-vectorize -force-vector-interleave=1 -force-vector-width=8 -S | FileCheck %s
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; A loop with a tiny trip count is vectorized as if optimizing for size. Rather
+; than leaving the 7 iterations to a scalar loop, fold the tail into a single
+; vector iteration by masking the loads and stores.
+;
+;   for (i = 0; i < 7; i++)
+;     a[i] = b[i] + c[i];
+
+; CHECK-LABEL: @tiny_trip_count(
+; CHECK:       vector.body:
+; CHECK:         [[VEC_IND:%.*]] = phi <8 x i64> [ <i64 0, i64 1, i64 2, i64 3, i64 4, i64 5, i64 6, i64 7>, %vector.ph ], [ [[VEC_IND_NEXT:%.*]], %vector.body ]
+; CHECK:         [[MASK:%.*]] = icmp ule <8 x i64> [[VEC_IND]], <i64 6, i64 6, i64 6, i64 6, i64 6, i64 6, i64 6, i64 6>
+; CHECK:         call <8 x i32> @llvm.masked.load.v8i32.p0v8i32(<8 x i32>* {{.*}}, i32 4, <8 x i1> [[MASK]], <8 x i32> undef)
+; CHECK:         call <8 x i32> @llvm.masked.load.v8i32.p0v8i32(<8 x i32>* {{.*}}, i32 4, <8 x i1> [[MASK]], <8 x i32> undef)
+; CHECK:         call void @llvm.masked.store.v8i32.p0v8i32(<8 x i32> {{.*}}, <8 x i32>* {{.*}}, i32 4, <8 x i1> [[MASK]])
+; CHECK:         [[INDEX_NEXT:%.*]] = add i64 {{%.*}}, 8
+; CHECK:         icmp eq i64 [[INDEX_NEXT]], 8
+; CHECK:       middle.block:
+; CHECK-NEXT:    br i1 true, label %for.end, label %scalar.ph
+define void @tiny_trip_count(i32* noalias %a, i32* noalias %b, i32* noalias %c) #0 {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %arrayidx.b = getelementptr inbounds i32, i32* %b, i64 %i
+  %0 = load i32, i32* %arrayidx.b, align 4
+  %arrayidx.c = getelementptr inbounds i32, i32* %c, i64 %i
+  %1 = load i32, i32* %arrayidx.c, align 4
+  %add = add nsw i32 %1, %0
+  %arrayidx.a = getelementptr inbounds i32, i32* %a, i64 %i
+  store i32 %add, i32* %arrayidx.a, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, 7
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; When optimizing for size, a loop of unknown trip count is vectorized with the
+; trip count rounded up to the vectorization factor and no minimum iteration
+; check.
+;
+;   for (i = 0; i < n; i++)
+;     a[i] = b[i] + c[i];
+
+; CHECK-LABEL: @unknown_trip_count(
+; CHECK-NOT:     min.iters.check
+; CHECK:         [[N_RND_UP:%.*]] = add i64 {{%.*}}, 7
+; CHECK:         [[N_MOD_VF:%.*]] = urem i64 [[N_RND_UP]], 8
+; CHECK:         [[N_VEC:%.*]] = sub i64 [[N_RND_UP]], [[N_MOD_VF]]
+; CHECK:         [[TC_MINUS_1:%.*]] = sub i64 {{%.*}}, 1
+; CHECK:       vector.body:
+; CHECK:         [[MASK:%.*]] = icmp ule <8 x i64> {{%.*}}, {{%.*}}
+; CHECK:         call <8 x i32> @llvm.masked.load.v8i32.p0v8i32(<8 x i32>* {{.*}}, i32 4, <8 x i1> [[MASK]], <8 x i32> undef)
+; CHECK:         call void @llvm.masked.store.v8i32.p0v8i32(<8 x i32> {{.*}}, <8 x i32>* {{.*}}, i32 4, <8 x i1> [[MASK]])
+; CHECK:       middle.block:
+; CHECK-NEXT:    br i1 true, label %for.end.loopexit, label %scalar.ph
+define void @unknown_trip_count(i32* noalias %a, i32* noalias %b, i32* noalias %c, i64 %n) #1 {
+entry:
+  %cmp = icmp sgt i64 %n, 0
+  br i1 %cmp, label %for.body, label %for.end
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %arrayidx.b = getelementptr inbounds i32, i32* %b, i64 %i
+  %0 = load i32, i32* %arrayidx.b, align 4
+  %arrayidx.c = getelementptr inbounds i32, i32* %c, i64 %i
+  %1 = load i32, i32* %arrayidx.c, align 4
+  %add = add nsw i32 %1, %0
+  %arrayidx.a = getelementptr inbounds i32, i32* %a, i64 %i
+  store i32 %add, i32* %arrayidx.a, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; Reductions are not folded: the masked-off lanes would feed the sum.
+
+; CHECK-LABEL: @reduction(
+; CHECK-NOT:     vector.body:
+; CHECK:         ret i32
+define i32 @reduction(i32* noalias %a) #0 {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %sum = phi i32 [ 0, %entry ], [ %sum.next, %for.body ]
+  %arrayidx = getelementptr inbounds i32, i32* %a, i64 %i
+  %0 = load i32, i32* %arrayidx, align 4
+  %sum.next = add nsw i32 %0, %sum
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, 7
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret i32 %sum.next
+}
+
+attributes #0 = { "target-cpu"="haswell" }
+attributes #1 = { optsize "target-cpu"="haswell" }
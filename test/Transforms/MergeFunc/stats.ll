@@ -0,0 +1,49 @@
+; RUN: opt -mergefunc -mergefunc-stats -disable-output < %s 2>&1 | FileCheck %s
+; RUN: opt -mergefunc -mergefunc-stats -mergefunc-parallel=false \
+; RUN:   -disable-output < %s 2>&1 | FileCheck %s
+; RUN: opt -S -mergefunc < %s | FileCheck %s --check-prefix=IR
+
+; @a, @b, @c and @d share a hash. @b is deleted, @d becomes a thunk to @c and
+; @e is not compared with anything.
+
+; CHECK: mergefunc: <stdin>: merged 2 of 5 functions (4 sharing a hash), 1 thunks written
+; CHECK: mergefunc: <stdin>: 17 -> 11 instructions, 6 saved (35.3%)
+
+; IR-LABEL: define internal i32 @a(
+; IR-NOT:   define internal i32 @b(
+; IR-LABEL: define i64 @c(
+; IR-LABEL: define i32 @e(
+; IR-LABEL: define i64 @d(
+; IR-NEXT:    tail call i64 @c(i64
+
+define internal i32 @a(i32 %x) {
+  %1 = add i32 %x, 1
+  %2 = mul i32 %1, 3
+  %3 = xor i32 %2, 7
+  ret i32 %3
+}
+
+define internal i32 @b(i32 %x) {
+  %1 = add i32 %x, 1
+  %2 = mul i32 %1, 3
+  %3 = xor i32 %2, 7
+  ret i32 %3
+}
+
+define i64 @c(i64 %x) {
+  %1 = add i64 %x, 1
+  %2 = mul i64 %1, 3
+  %3 = xor i64 %2, 7
+  ret i64 %3
+}
+
+define i64 @d(i64 %x) {
+  %1 = add i64 %x, 1
+  %2 = mul i64 %1, 3
+  %3 = xor i64 %2, 7
+  ret i64 %3
+}
+
+define i32 @e(i32 %x) {
+  ret i32 %x
+}
@@ -0,0 +1,196 @@
+; RUN: opt < %s -basicaa -newgvn -newgvn-enable-pre -S | FileCheck %s
+; RUN: opt < %s -basicaa -newgvn -newgvn-enable-pre -newgvn-enable-load-pre=false -S | FileCheck %s --check-prefix=NOLOAD
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; The add is available along %then, insert it in %else.
+define i32 @scalar(i1 %c, i32 %a, i32 %b) {
+; CHECK-LABEL: @scalar(
+; CHECK:       then:
+; CHECK-NEXT:    [[X:%.*]] = add i32 %a, %b
+; CHECK:       else:
+; CHECK-NEXT:    [[PRE:%.*]] = add i32 %a, %b
+; CHECK-NEXT:    br label %join
+; CHECK:       join:
+; CHECK-NEXT:    [[PHI:%.*]] = phi i32 [ [[PRE]], %else ], [ [[X]], %then ]
+; CHECK-NEXT:    ret i32 [[PHI]]
+;
+entry:
+  br i1 %c, label %then, label %else
+
+then:
+  %x = add i32 %a, %b
+  call void @use(i32 %x)
+  br label %join
+
+else:
+  br label %join
+
+join:
+  %y = add i32 %a, %b
+  ret i32 %y
+}
+
+; The operand is translated through the phi of the join block.
+define i32 @scalar_phi(i1 %c, i32 %a, i32 %b) {
+; CHECK-LABEL: @scalar_phi(
+; CHECK:       else:
+; CHECK-NEXT:    [[PRE:%.*]] = mul i32 %b, 3
+; CHECK:       join:
+; CHECK-NEXT:    [[PHI:%.*]] = phi i32 [ [[PRE]], %else ], [ %x, %then ]
+; CHECK-NOT:     mul
+; CHECK:         ret i32 [[PHI]]
+;
+entry:
+  br i1 %c, label %then, label %else
+
+then:
+  %x = mul i32 %a, 3
+  call void @use(i32 %x)
+  br label %join
+
+else:
+  br label %join
+
+join:
+  %p = phi i32 [ %a, %then ], [ %b, %else ]
+  %y = mul i32 %p, 3
+  ret i32 %y
+}
+
+; The load is available from the store in %then, insert a load in %else.
+define i32 @load_from_store(i1 %c, i32* %p, i32 %v) {
+; CHECK-LABEL: @load_from_store(
+; CHECK:       else:
+; CHECK-NEXT:    [[PRE:%.*]] = load i32, i32* %p
+; CHECK-NEXT:    br label %join
+; CHECK:       join:
+; CHECK-NEXT:    [[PHI:%.*]] = phi i32 [ [[PRE]], %else ], [ %v, %then ]
+; CHECK-NEXT:    ret i32 [[PHI]]
+;
+; NOLOAD-LABEL: @load_from_store(
+; NOLOAD:       join:
+; NOLOAD-NEXT:    [[L:%.*]] = load i32, i32* %p
+; NOLOAD-NEXT:    ret i32 [[L]]
+;
+entry:
+  br i1 %c, label %then, label %else
+
+then:
+  store i32 %v, i32* %p
+  br label %join
+
+else:
+  br label %join
+
+join:
+  %l = load i32, i32* %p
+  ret i32 %l
+}
+
+; The load in %then is not clobbered by the stores to %q, which does not alias
+; %p.
+define i32 @load_from_load(i1 %c, i32* noalias %p, i32* noalias %q) {
+; CHECK-LABEL: @load_from_load(
+; CHECK:       then:
+; CHECK-NEXT:    [[A:%.*]] = load i32, i32* %p
+; CHECK:       else:
+; CHECK-NEXT:    store i32 0, i32* %q
+; CHECK-NEXT:    [[PRE:%.*]] = load i32, i32* %p
+; CHECK:       join:
+; CHECK-NEXT:    [[PHI:%.*]] = phi i32 [ [[PRE]], %else ], [ [[A]], %then ]
+; CHECK-NEXT:    ret i32 [[PHI]]
+;
+entry:
+  br i1 %c, label %then, label %else
+
+then:
+  %a = load i32, i32* %p
+  store i32 %a, i32* %q
+  br label %join
+
+else:
+  store i32 0, i32* %q
+  br label %join
+
+join:
+  %l = load i32, i32* %p
+  ret i32 %l
+}
+
+; Nothing is inserted on a critical edge.
+define i32 @critical_edge(i1 %c, i32* %p, i32 %v) {
+; CHECK-LABEL: @critical_edge(
+; CHECK:       join:
+; CHECK-NEXT:    [[L:%.*]] = load i32, i32* %p
+; CHECK-NEXT:    ret i32 [[L]]
+;
+entry:
+  br i1 %c, label %then, label %join
+
+then:
+  store i32 %v, i32* %p
+  br label %join
+
+join:
+  %l = load i32, i32* %p
+  ret i32 %l
+}
+
+; The load may not execute once the block is entered, so it is not hoisted
+; into %else.
+define i32 @not_anticipated(i1 %c, i32* %p, i32 %v) {
+; CHECK-LABEL: @not_anticipated(
+; CHECK:       else:
+; CHECK-NEXT:    br label %join
+; CHECK:       join:
+; CHECK-NEXT:    call void @may_throw()
+; CHECK-NEXT:    [[L:%.*]] = load i32, i32* %p
+;
+entry:
+  br i1 %c, label %then, label %else
+
+then:
+  store i32 %v, i32* %p
+  br label %join
+
+else:
+  br label %join
+
+join:
+  call void @may_throw() readnone
+  %l = load i32, i32* %p
+  ret i32 %l
+}
+
+
+; The value stored in %then is a load of another pointer, which does not take
+; the range of %l.
+define i32 @stored_load_keeps_metadata(i1 %c, i32* noalias %p, i32* noalias %q) {
+; CHECK-LABEL: @stored_load_keeps_metadata(
+; CHECK:       then:
+; CHECK-NEXT:    [[V:%.*]] = load i32, i32* %q, !range ![[R:[0-9]+]]
+; CHECK:       join:
+; CHECK-NEXT:    [[PHI:%.*]] = phi i32 [ {{%.*}}, %else ], [ [[V]], %then ]
+; CHECK:       ![[R]] = !{i32 0, i32 10}
+;
+entry:
+  br i1 %c, label %then, label %else
+
+then:
+  %v = load i32, i32* %q, !range !0
+  store i32 %v, i32* %p
+  br label %join
+
+else:
+  br label %join
+
+join:
+  %l = load i32, i32* %p, !range !1
+  ret i32 %l
+}
+
+declare void @use(i32) readnone nounwind
+declare void @may_throw()
+
+!0 = !{i32 0, i32 10}
+!1 = !{i32 0, i32 100}
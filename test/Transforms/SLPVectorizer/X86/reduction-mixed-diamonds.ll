@@ -0,0 +1,136 @@
+; RUN: opt < %s -mtriple=x86_64-unknown-linux -mcpu=core-avx2 -slp-vectorizer -slp-mixed-reduction-values -S | FileCheck %s
+; RUN: opt < %s -mtriple=x86_64-unknown-linux -mcpu=core-avx2 -slp-vectorizer -S | FileCheck %s --check-prefix=NOMIXED
+; RUN: opt < %s -mtriple=x86_64-unknown-linux -mcpu=core-avx2 -slp-vectorizer -slp-speculate-diamonds -S | FileCheck %s --check-prefix=SPEC
+
+; A sum of values widened from i16 and of i32 values: each group of alike
+; values is reduced separately.
+
+; CHECK-LABEL: @mixed_widths(
+; CHECK-DAG:     [[A:%.*]] = load <4 x i16>, <4 x i16>*
+; CHECK-DAG:     [[SA:%.*]] = sext <4 x i16> [[A]] to <4 x i32>
+; CHECK-DAG:     [[B:%.*]] = load <4 x i32>, <4 x i32>*
+; CHECK:         ret i32
+
+; NOMIXED-LABEL: @mixed_widths(
+; NOMIXED-NOT:   load <4 x i32>
+; NOMIXED:       ret i32
+
+define i32 @mixed_widths(i16* %a, i32* %b) {
+entry:
+  %a1p = getelementptr inbounds i16, i16* %a, i64 1
+  %a2p = getelementptr inbounds i16, i16* %a, i64 2
+  %a3p = getelementptr inbounds i16, i16* %a, i64 3
+  %b1p = getelementptr inbounds i32, i32* %b, i64 1
+  %b2p = getelementptr inbounds i32, i32* %b, i64 2
+  %b3p = getelementptr inbounds i32, i32* %b, i64 3
+  %a0 = load i16, i16* %a, align 2
+  %a1 = load i16, i16* %a1p, align 2
+  %a2 = load i16, i16* %a2p, align 2
+  %a3 = load i16, i16* %a3p, align 2
+  %b0 = load i32, i32* %b, align 4
+  %b1 = load i32, i32* %b1p, align 4
+  %b2 = load i32, i32* %b2p, align 4
+  %b3 = load i32, i32* %b3p, align 4
+  %sa0 = sext i16 %a0 to i32
+  %sa1 = sext i16 %a1 to i32
+  %sa2 = sext i16 %a2 to i32
+  %sa3 = sext i16 %a3 to i32
+  %s0 = add i32 %sa0, %b0
+  %s1 = add i32 %s0, %sa1
+  %s2 = add i32 %s1, %b1
+  %s3 = add i32 %s2, %sa2
+  %s4 = add i32 %s3, %b2
+  %s5 = add i32 %s4, %sa3
+  %s6 = add i32 %s5, %b3
+  ret i32 %s6
+}
+
+; A maximum computed with branches, as in
+;   m = x[0]; if (x[1] > m) m = x[1]; ... if (x[7] > m) m = x[7];
+; Once the triangles are speculated into selects, the whole computation is a
+; horizontal max reduction in a single block.
+
+; CHECK-LABEL: @max_triangles(
+; CHECK-NOT:     load <8 x i32>
+; CHECK:         ret i32
+
+; SPEC-LABEL: @max_triangles(
+; SPEC:          load <8 x i32>, <8 x i32>*
+; SPEC-NOT:      br
+; SPEC:          ret i32
+
+define i32 @max_triangles(i32* %x) {
+entry:
+  %x1p = getelementptr inbounds i32, i32* %x, i64 1
+  %x2p = getelementptr inbounds i32, i32* %x, i64 2
+  %x3p = getelementptr inbounds i32, i32* %x, i64 3
+  %x4p = getelementptr inbounds i32, i32* %x, i64 4
+  %x5p = getelementptr inbounds i32, i32* %x, i64 5
+  %x6p = getelementptr inbounds i32, i32* %x, i64 6
+  %x7p = getelementptr inbounds i32, i32* %x, i64 7
+  %x0 = load i32, i32* %x, align 4
+  %x1 = load i32, i32* %x1p, align 4
+  %x2 = load i32, i32* %x2p, align 4
+  %x3 = load i32, i32* %x3p, align 4
+  %x4 = load i32, i32* %x4p, align 4
+  %x5 = load i32, i32* %x5p, align 4
+  %x6 = load i32, i32* %x6p, align 4
+  %x7 = load i32, i32* %x7p, align 4
+  %c1 = icmp sgt i32 %x1, %x0
+  br i1 %c1, label %then1, label %join1
+
+then1:
+  br label %join1
+
+join1:
+  %m1 = phi i32 [ %x1, %then1 ], [ %x0, %entry ]
+  %c2 = icmp sgt i32 %x2, %m1
+  br i1 %c2, label %then2, label %join2
+
+then2:
+  br label %join2
+
+join2:
+  %m2 = phi i32 [ %x2, %then2 ], [ %m1, %join1 ]
+  %c3 = icmp sgt i32 %x3, %m2
+  br i1 %c3, label %then3, label %join3
+
+then3:
+  br label %join3
+
+join3:
+  %m3 = phi i32 [ %x3, %then3 ], [ %m2, %join2 ]
+  %c4 = icmp sgt i32 %x4, %m3
+  br i1 %c4, label %then4, label %join4
+
+then4:
+  br label %join4
+
+join4:
+  %m4 = phi i32 [ %x4, %then4 ], [ %m3, %join3 ]
+  %c5 = icmp sgt i32 %x5, %m4
+  br i1 %c5, label %then5, label %join5
+
+then5:
+  br label %join5
+
+join5:
+  %m5 = phi i32 [ %x5, %then5 ], [ %m4, %join4 ]
+  %c6 = icmp sgt i32 %x6, %m5
+  br i1 %c6, label %then6, label %join6
+
+then6:
+  br label %join6
+
+join6:
+  %m6 = phi i32 [ %x6, %then6 ], [ %m5, %join5 ]
+  %c7 = icmp sgt i32 %x7, %m6
+  br i1 %c7, label %then7, label %join7
+
+then7:
+  br label %join7
+
+join7:
+  %m7 = phi i32 [ %x7, %then7 ], [ %m6, %join6 ]
+  ret i32 %m7
+}
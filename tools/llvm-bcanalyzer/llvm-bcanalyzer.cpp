@@ -14,6 +14,7 @@
 //  Options:
 //      --help      - Output information about command line switches
 //      --dump      - Dump low-level bitcode structure in readable format
+//      --timing    - Report decode time and abbreviation opportunities
 //
 // This tool provides analytical information about a bitcode file. It is
 // intended as an aid to developers of bitcode reading and writing software. It
@@ -39,6 +40,7 @@
 #include "llvm/Support/SHA1.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/raw_ostream.h"
+#include <chrono>
 using namespace llvm;
 
 static cl::opt<std::string>
@@ -70,6 +72,11 @@ static cl::opt<std::string> CheckHash(
     "check-hash",
     cl::desc("Check module hash using the argument as a string table"));
 
+static cl::opt<bool>
+    Timing("timing",
+           cl::desc("Report the decode time per block and record code, and "
+                    "the records that new abbreviations would shrink"));
+
 namespace {
 
 /// CurStreamTypeType - A type for CurStreamType
@@ -322,6 +329,7 @@ static const char *GetCodeName(unsigned CodeID, unsigned BlockID,
       STRINGIFY_CODE(FS, VALUE_GUID)
       STRINGIFY_CODE(FS, CFI_FUNCTION_DEFS)
       STRINGIFY_CODE(FS, CFI_FUNCTION_DECLS)
+      STRINGIFY_CODE(FS, CONTENT_HASH)
     }
   case bitc::METADATA_ATTACHMENT_ID:
     switch(CodeID) {
@@ -402,12 +410,65 @@ static const char *GetCodeName(unsigned CodeID, unsigned BlockID,
 #undef STRINGIFY_CODE
 }
 
+/// Largest VBR width considered when estimating the size of the records
+/// encoded with a new abbreviation.
+static const unsigned MaxVBRWidth = 32;
+
+/// Return the number of bits used to emit \p Value as a VBR of \p Width.
+static unsigned getVBRSize(uint64_t Value, unsigned Width) {
+  unsigned NumChunks = 1;
+  for (Value >>= Width - 1; Value; Value >>= Width - 1)
+    ++NumChunks;
+  return NumChunks * Width;
+}
+
 struct PerRecordStats {
   unsigned NumInstances;
   unsigned NumAbbrev;
   uint64_t TotalBits;
 
-  PerRecordStats() : NumInstances(0), NumAbbrev(0), TotalBits(0) {}
+  /// Time spent decoding these records, only computed in -timing mode.
+  std::chrono::nanoseconds DecodeTime;
+
+  /// Size of the unabbreviated records and time spent decoding them.
+  uint64_t UnabbrevBits;
+  std::chrono::nanoseconds UnabbrevDecodeTime;
+
+  /// Estimated size of the unabbreviated records if they were emitted with an
+  /// abbreviation made of a literal code and an array of VBRs: the abbrev IDs
+  /// and array lengths, then the operands for each candidate VBR width.
+  uint64_t AbbrevIDAndLengthBits;
+  std::vector<uint64_t> OperandBitsByVBRWidth;
+
+  PerRecordStats()
+      : NumInstances(0), NumAbbrev(0), TotalBits(0), DecodeTime(0),
+        UnabbrevBits(0), UnabbrevDecodeTime(0), AbbrevIDAndLengthBits(0) {}
+
+  /// Add an unabbreviated record, with the abbrev ID width of its block.
+  void addUnabbrevRecord(ArrayRef<uint64_t> Record, uint64_t Bits,
+                         std::chrono::nanoseconds Time, unsigned AbbrevWidth) {
+    UnabbrevBits += Bits;
+    UnabbrevDecodeTime += Time;
+    AbbrevIDAndLengthBits += AbbrevWidth + getVBRSize(Record.size(), 6);
+    OperandBitsByVBRWidth.resize(MaxVBRWidth + 1);
+    for (uint64_t Op : Record)
+      for (unsigned Width = 2; Width <= MaxVBRWidth; ++Width)
+        OperandBitsByVBRWidth[Width] += getVBRSize(Op, Width);
+  }
+
+  /// Return the estimated number of bits that a new abbreviation would save
+  /// on the unabbreviated records, and the VBR width it would use.
+  std::pair<int64_t, unsigned> getAbbrevSavings() const {
+    if (OperandBitsByVBRWidth.empty())
+      return {0, 0};
+    unsigned BestWidth = 2;
+    for (unsigned Width = 3; Width <= MaxVBRWidth; ++Width)
+      if (OperandBitsByVBRWidth[Width] < OperandBitsByVBRWidth[BestWidth])
+        BestWidth = Width;
+    uint64_t AbbrevBits =
+        AbbrevIDAndLengthBits + OperandBitsByVBRWidth[BestWidth];
+    return {(int64_t)UnabbrevBits - (int64_t)AbbrevBits, BestWidth};
+  }
 };
 
 struct PerBlockIDStats {
@@ -430,13 +491,22 @@ struct PerBlockIDStats {
   /// CodeFreq - Keep track of the number of times we see each code.
   std::vector<PerRecordStats> CodeFreq;
 
+  /// DecodeTime - Time spent in these blocks, excluding their subblocks. Only
+  /// computed in -timing mode.
+  std::chrono::nanoseconds DecodeTime;
+
   PerBlockIDStats()
     : NumInstances(0), NumBits(0),
-      NumSubBlocks(0), NumAbbrevs(0), NumRecords(0), NumAbbreviatedRecords(0) {}
+      NumSubBlocks(0), NumAbbrevs(0), NumRecords(0), NumAbbreviatedRecords(0),
+      DecodeTime(0) {}
 };
 
 static std::map<unsigned, PerBlockIDStats> BlockIDStats;
 
+/// DumpTime - Time spent printing the -dump output, which is excluded from the
+/// decode times. Only computed in -timing mode.
+static std::chrono::nanoseconds DumpTime(0);
+
 
 
 /// ReportError - All bitcode analysis errors go through this function, making this a
@@ -494,6 +564,25 @@ static bool decodeBlob(unsigned Code, unsigned BlockID, StringRef Indent,
 static bool ParseBlock(BitstreamCursor &Stream, BitstreamBlockInfo &BlockInfo,
                        unsigned BlockID, unsigned IndentLevel,
                        CurStreamTypeType CurStreamType) {
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point BlockTimeStart;
+  if (Timing)
+    BlockTimeStart = Clock::now();
+
+  // Don't count the time spent printing the dump as decode time.
+  Clock::time_point DumpTimeStart;
+  auto StartDump = [&]() {
+    if (Timing)
+      DumpTimeStart = Clock::now();
+  };
+  auto EndDump = [&]() {
+    if (!Timing)
+      return;
+    std::chrono::nanoseconds Time = Clock::now() - DumpTimeStart;
+    DumpTime += Time;
+    BlockTimeStart += Time;
+  };
+
   std::string Indent(IndentLevel*2, ' ');
   uint64_t BlockBitStart = Stream.GetCurrentBitNo();
 
@@ -505,7 +594,11 @@ static bool ParseBlock(BitstreamCursor &Stream, BitstreamBlockInfo &BlockInfo,
   // BLOCKINFO is a special part of the stream.
   bool DumpRecords = Dump;
   if (BlockID == bitc::BLOCKINFO_BLOCK_ID) {
-    if (Dump) outs() << Indent << "<BLOCKINFO_BLOCK/>\n";
+    if (Dump) {
+      StartDump();
+      outs() << Indent << "<BLOCKINFO_BLOCK/>\n";
+      EndDump();
+    }
     Optional<BitstreamBlockInfo> NewBlockInfo =
         Stream.ReadBlockInfoBlock(/*ReadBlockInfoNames=*/true);
     if (!NewBlockInfo)
@@ -525,6 +618,7 @@ static bool ParseBlock(BitstreamCursor &Stream, BitstreamBlockInfo &BlockInfo,
 
   const char *BlockName = nullptr;
   if (DumpRecords) {
+    StartDump();
     outs() << Indent << "<";
     if ((BlockName = GetBlockName(BlockID, BlockInfo, CurStreamType)))
       outs() << BlockName;
@@ -536,6 +630,7 @@ static bool ParseBlock(BitstreamCursor &Stream, BitstreamBlockInfo &BlockInfo,
 
     outs() << " NumWords=" << NumWords
            << " BlockCodeSize=" << Stream.getAbbrevIDWidth() << ">\n";
+    EndDump();
   }
 
   SmallVector<uint64_t, 64> Record;
@@ -559,18 +654,25 @@ static bool ParseBlock(BitstreamCursor &Stream, BitstreamBlockInfo &BlockInfo,
     case BitstreamEntry::EndBlock: {
       uint64_t BlockBitEnd = Stream.GetCurrentBitNo();
       BlockStats.NumBits += BlockBitEnd-BlockBitStart;
+      if (Timing)
+        BlockStats.DecodeTime += Clock::now() - BlockTimeStart;
       if (DumpRecords) {
+        StartDump();
         outs() << Indent << "</";
         if (BlockName)
           outs() << BlockName << ">\n";
         else
           outs() << "UnknownBlock" << BlockID << ">\n";
+        EndDump();
       }
       return false;
     }
         
     case BitstreamEntry::SubBlock: {
       uint64_t SubBlockBitStart = Stream.GetCurrentBitNo();
+      Clock::time_point SubBlockTimeStart;
+      if (Timing)
+        SubBlockTimeStart = Clock::now();
       if (ParseBlock(Stream, BlockInfo, Entry.ID, IndentLevel + 1,
                      CurStreamType))
         return true;
@@ -579,6 +681,9 @@ static bool ParseBlock(BitstreamCursor &Stream, BitstreamBlockInfo &BlockInfo,
       
       // Don't include subblock sizes in the size of this block.
       BlockBitStart += SubBlockBitEnd-SubBlockBitStart;
+      // Nor their decode time.
+      if (Timing)
+        BlockTimeStart += Clock::now() - SubBlockTimeStart;
       continue;
     }
     case BitstreamEntry::Record:
@@ -598,20 +703,32 @@ static bool ParseBlock(BitstreamCursor &Stream, BitstreamBlockInfo &BlockInfo,
 
     StringRef Blob;
     unsigned CurrentRecordPos = Stream.GetCurrentBitNo();
+    Clock::time_point RecordTimeStart;
+    if (Timing)
+      RecordTimeStart = Clock::now();
     unsigned Code = Stream.readRecord(Entry.ID, Record, &Blob);
+    std::chrono::nanoseconds RecordTime(0);
+    if (Timing)
+      RecordTime = Clock::now() - RecordTimeStart;
+    uint64_t RecordBits = Stream.GetCurrentBitNo() - RecordStartBit;
 
     // Increment the # occurrences of this code.
     if (BlockStats.CodeFreq.size() <= Code)
       BlockStats.CodeFreq.resize(Code+1);
-    BlockStats.CodeFreq[Code].NumInstances++;
-    BlockStats.CodeFreq[Code].TotalBits +=
-      Stream.GetCurrentBitNo()-RecordStartBit;
+    PerRecordStats &RecStats = BlockStats.CodeFreq[Code];
+    RecStats.NumInstances++;
+    RecStats.TotalBits += RecordBits;
+    RecStats.DecodeTime += RecordTime;
     if (Entry.ID != bitc::UNABBREV_RECORD) {
-      BlockStats.CodeFreq[Code].NumAbbrev++;
+      RecStats.NumAbbrev++;
       ++BlockStats.NumAbbreviatedRecords;
+    } else if (Timing) {
+      RecStats.addUnabbrevRecord(Record, RecordBits, RecordTime,
+                                 Stream.getAbbrevIDWidth());
     }
 
     if (DumpRecords) {
+      StartDump();
       outs() << Indent << "  <";
       if (const char *CodeName =
               GetCodeName(Code, BlockID, BlockInfo, CurStreamType))
@@ -727,6 +844,7 @@ static bool ParseBlock(BitstreamCursor &Stream, BitstreamBlockInfo &BlockInfo,
       }
 
       outs() << "\n";
+      EndDump();
     }
 
     // Make sure that we can skip the current record.
@@ -806,6 +924,116 @@ static bool openBitcodeFile(StringRef Path,
   return false;
 }
 
+static double toMilliseconds(std::chrono::nanoseconds Time) {
+  return Time.count() / 1e6;
+}
+
+/// PrintTimingReport - Print the decode time of each block and record code,
+/// then rank the record codes by the size a new abbreviation would save on
+/// their unabbreviated instances.
+static void PrintTimingReport(const BitstreamBlockInfo &BlockInfo,
+                              CurStreamTypeType CurStreamType,
+                              uint64_t BufferSizeBits,
+                              std::chrono::nanoseconds TotalTime) {
+  outs() << "Decode Timing:\n";
+  outs() << "         Total time: "
+         << format("%.3f ms", toMilliseconds(TotalTime)) << "\n\n";
+  for (const auto &I : BlockIDStats) {
+    const PerBlockIDStats &Stats = I.second;
+    outs() << "  Block ID #" << I.first;
+    if (const char *BlockName = GetBlockName(I.first, BlockInfo, CurStreamType))
+      outs() << " (" << BlockName << ")";
+    outs() << ":\n";
+    double pct = TotalTime.count()
+                     ? (Stats.DecodeTime.count() * 100.0) / TotalTime.count()
+                     : 0.0;
+    outs() << format("      Decode time: %.3f ms (%2.4f%%)\n",
+                     toMilliseconds(Stats.DecodeTime), pct);
+
+    std::vector<std::pair<std::chrono::nanoseconds, unsigned>> TimePairs;
+    for (unsigned i = 0, e = Stats.CodeFreq.size(); i != e; ++i)
+      if (Stats.CodeFreq[i].NumInstances)
+        TimePairs.push_back(std::make_pair(Stats.CodeFreq[i].DecodeTime, i));
+    if (TimePairs.empty()) {
+      outs() << "\n";
+      continue;
+    }
+    std::stable_sort(TimePairs.begin(), TimePairs.end());
+    std::reverse(TimePairs.begin(), TimePairs.end());
+
+    outs() << "\t\t  Count  Unabbrev   Time (ms)    ns/Rec  Record Kind\n";
+    for (const auto &TP : TimePairs) {
+      const PerRecordStats &RecStats = Stats.CodeFreq[TP.second];
+      outs() << format("\t\t%7d %8.2f%% %11.3f %9.1f  ",
+                       RecStats.NumInstances,
+                       (double)(RecStats.NumInstances - RecStats.NumAbbrev) /
+                           RecStats.NumInstances * 100,
+                       toMilliseconds(RecStats.DecodeTime),
+                       (double)RecStats.DecodeTime.count() /
+                           RecStats.NumInstances);
+      if (const char *CodeName =
+              GetCodeName(TP.second, I.first, BlockInfo, CurStreamType))
+        outs() << CodeName << "\n";
+      else
+        outs() << "UnknownCode" << TP.second << "\n";
+    }
+    outs() << "\n";
+  }
+
+  // Rank the record codes that would benefit from a new abbreviation. The
+  // estimate assumes a [literal code, array of VBR] abbreviation at the best
+  // width, and a read time proportional to the number of bits decoded.
+  struct Opportunity {
+    unsigned BlockID;
+    unsigned Code;
+    int64_t SavedBits;
+    unsigned Width;
+    double SavedMs;
+  };
+  std::vector<Opportunity> Opportunities;
+  for (const auto &I : BlockIDStats) {
+    const PerBlockIDStats &Stats = I.second;
+    for (unsigned i = 0, e = Stats.CodeFreq.size(); i != e; ++i) {
+      const PerRecordStats &RecStats = Stats.CodeFreq[i];
+      auto Savings = RecStats.getAbbrevSavings();
+      if (Savings.first <= 0)
+        continue;
+      double SavedMs = toMilliseconds(RecStats.UnabbrevDecodeTime) *
+                       Savings.first / RecStats.UnabbrevBits;
+      Opportunities.push_back(
+          {I.first, i, Savings.first, Savings.second, SavedMs});
+    }
+  }
+  std::stable_sort(Opportunities.begin(), Opportunities.end(),
+                   [](const Opportunity &A, const Opportunity &B) {
+                     return A.SavedBits > B.SavedBits;
+                   });
+
+  outs() << "Abbreviation Opportunities:\n";
+  if (Opportunities.empty()) {
+    outs() << "  (none)\n\n";
+    return;
+  }
+  outs() << "\t Saved Bytes    % File  Read (ms)  VBR  Block / Record Kind\n";
+  for (const Opportunity &O : Opportunities) {
+    outs() << format("\t%12lu %8.4f%% %10.3f %4u  ",
+                     (unsigned long)(O.SavedBits / CHAR_BIT),
+                     (O.SavedBits * 100.0) / BufferSizeBits, O.SavedMs,
+                     O.Width);
+    if (const char *BlockName = GetBlockName(O.BlockID, BlockInfo, CurStreamType))
+      outs() << BlockName;
+    else
+      outs() << "Block" << O.BlockID;
+    outs() << " / ";
+    if (const char *CodeName =
+            GetCodeName(O.Code, O.BlockID, BlockInfo, CurStreamType))
+      outs() << CodeName << "\n";
+    else
+      outs() << "UnknownCode" << O.Code << "\n";
+  }
+  outs() << "\n";
+}
+
 /// AnalyzeBitcode - Analyze the bitcode file specified by InputFilename.
 static int AnalyzeBitcode() {
   std::unique_ptr<MemoryBuffer> StreamBuffer;
@@ -846,6 +1074,7 @@ static int AnalyzeBitcode() {
   }
 
   unsigned NumTopBlocks = 0;
+  auto DecodeStart = std::chrono::steady_clock::now();
 
   // Parse the top-level structure.  We only allow blocks at the top-level.
   while (!Stream.AtEndOfStream()) {
@@ -859,6 +1088,8 @@ static int AnalyzeBitcode() {
       return true;
     ++NumTopBlocks;
   }
+  std::chrono::nanoseconds DecodeTime =
+      std::chrono::steady_clock::now() - DecodeStart - DumpTime;
 
   if (Dump) outs() << "\n\n";
 
@@ -956,6 +1187,9 @@ static int AnalyzeBitcode() {
 
     }
   }
+
+  if (Timing)
+    PrintTimingReport(BlockInfo, CurStreamType, BufferSizeBits, DecodeTime);
   return 0;
 }
 
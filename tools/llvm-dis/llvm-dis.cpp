@@ -69,6 +69,11 @@ static cl::opt<bool>
                         cl::desc("Load module without materializing metadata, "
                                  "then materialize only the metadata"));
 
+static cl::opt<bool> StreamFunctions(
+    "stream-functions",
+    cl::desc("Materialize each function body right before printing it and "
+             "release it once printed, to bound memory on large modules"));
+
 namespace {
 
 static void printDebugLoc(const DebugLoc &DL, formatted_raw_ostream &OS) {
@@ -79,9 +84,16 @@ static void printDebugLoc(const DebugLoc &DL, formatted_raw_ostream &OS) {
   }
 }
 class CommentWriter : public AssemblyAnnotationWriter {
+  // Use counts are only known once every function is materialized.
+  bool ShowUses;
+
 public:
+  explicit CommentWriter(bool ShowUses = true) : ShowUses(ShowUses) {}
+
   void emitFunctionAnnot(const Function *F,
                          formatted_raw_ostream &OS) override {
+    if (!ShowUses)
+      return;
     OS << "; [#uses=" << F->getNumUses() << ']';  // Output # uses
     OS << '\n';
   }
@@ -91,7 +103,10 @@ public:
       OS.PadToColumn(50);
       Padded = true;
       // Output # uses and type
-      OS << "; [#uses=" << V.getNumUses() << " type=" << *V.getType() << "]";
+      OS << "; [";
+      if (ShowUses)
+        OS << "#uses=" << V.getNumUses() << ' ';
+      OS << "type=" << *V.getType() << "]";
     }
     if (const Instruction *I = dyn_cast<Instruction>(&V)) {
       if (const DebugLoc &DL = I->getDebugLoc()) {
@@ -148,13 +163,74 @@ struct LLVMDisDiagnosticHandler : public DiagnosticHandler {
 
 static ExitOnError ExitOnErr;
 
+namespace {
+/// Annotation writer that materializes each function right before its body
+/// gets walked, and releases the body once walked, so that only a few
+/// function bodies are in memory at a time. Each body is walked twice: once
+/// when the writer collects the types of the module, and once when it is
+/// printed. The slots of the metadata and attribute groups are assigned while
+/// printing the functions, so the output is the same as when printing the
+/// fully materialized module.
+class StreamingWriter : public AssemblyAnnotationWriter {
+  std::unique_ptr<AssemblyAnnotationWriter> Inner;
+  Function *LastPrinted = nullptr;
+
+  static void materialize(const Function *F) {
+    ExitOnErr(const_cast<Function *>(F)->materialize());
+  }
+
+  /// Release the body of \p F. The reader keeps it if a blockaddress refers
+  /// to its blocks, and reads it again if one is found later.
+  static void release(const Function *F) {
+    Function *MutF = const_cast<Function *>(F);
+    MutF->getParent()->dematerialize(MutF);
+  }
+
+public:
+  StreamingWriter(std::unique_ptr<AssemblyAnnotationWriter> Inner)
+      : Inner(std::move(Inner)) {}
+
+  void prepareFunctionBody(const Function *F) override { materialize(F); }
+  void releaseFunctionBody(const Function *F) override { release(F); }
+
+  void emitFunctionAnnot(const Function *F,
+                         formatted_raw_ostream &OS) override {
+    if (LastPrinted)
+      release(LastPrinted);
+    LastPrinted = const_cast<Function *>(F);
+    materialize(F);
+    if (Inner)
+      Inner->emitFunctionAnnot(F, OS);
+  }
+  void emitBasicBlockStartAnnot(const BasicBlock *BB,
+                                formatted_raw_ostream &OS) override {
+    if (Inner)
+      Inner->emitBasicBlockStartAnnot(BB, OS);
+  }
+  void emitBasicBlockEndAnnot(const BasicBlock *BB,
+                              formatted_raw_ostream &OS) override {
+    if (Inner)
+      Inner->emitBasicBlockEndAnnot(BB, OS);
+  }
+  void emitInstructionAnnot(const Instruction *I,
+                            formatted_raw_ostream &OS) override {
+    if (Inner)
+      Inner->emitInstructionAnnot(I, OS);
+  }
+  void printInfoComment(const Value &V, formatted_raw_ostream &OS) override {
+    if (Inner)
+      Inner->printInfoComment(V, OS);
+  }
+};
+} // end anon namespace
+
 static std::unique_ptr<Module> openInputFile(LLVMContext &Context) {
   std::unique_ptr<MemoryBuffer> MB =
       ExitOnErr(errorOrToExpected(MemoryBuffer::getFileOrSTDIN(InputFilename)));
   std::unique_ptr<Module> M = ExitOnErr(getOwningLazyBitcodeModule(
       std::move(MB), Context,
       /*ShouldLazyLoadMetadata=*/true, SetImporting));
-  if (MaterializeMetadata)
+  if (MaterializeMetadata || StreamFunctions)
     ExitOnErr(M->materializeMetadata());
   else
     ExitOnErr(M->materializeAll());
@@ -174,6 +250,13 @@ int main(int argc, char **argv) {
       llvm::make_unique<LLVMDisDiagnosticHandler>(argv[0]));
   cl::ParseCommandLineOptions(argc, argv, "llvm .bc -> .ll disassembler\n");
 
+  // Predicting the use-list order requires the whole module in memory.
+  if (StreamFunctions && PreserveAssemblyUseListOrder) {
+    errs() << argv[0] << ": -stream-functions cannot be used with "
+                         "-preserve-ll-uselistorder\n";
+    return 1;
+  }
+
   std::unique_ptr<Module> M = openInputFile(Context);
 
   // Just use stdout.  We won't actually print anything on it.
@@ -200,7 +283,9 @@ int main(int argc, char **argv) {
 
   std::unique_ptr<AssemblyAnnotationWriter> Annotator;
   if (ShowAnnotations)
-    Annotator.reset(new CommentWriter());
+    Annotator.reset(new CommentWriter(/*ShowUses=*/!StreamFunctions));
+  if (StreamFunctions)
+    Annotator.reset(new StreamingWriter(std::move(Annotator)));
 
   // All that llvm-dis does is write the assembly to a file.
   if (!DontPrint)
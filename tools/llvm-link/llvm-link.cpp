@@ -10,14 +10,28 @@
 // This utility may be invoked in the following manner:
 //  llvm-link a.bc b.bc c.bc -o x.bc
 //
+// With -j N the input files are split in N contiguous shards that are linked
+// on separate threads, each in its own LLVMContext. The shards are then merged
+// pairwise, through bitcode, until a single module remains. Merging adjacent
+// shards only keeps the result in the same order as a serial link. A shard
+// can't tell which lazily linked definitions (linkonce and
+// available_externally ones) the other shards reference, so they are all kept
+// until the final module, where the unreferenced ones and their comdats are
+// dropped. The messages of each shard are printed once its thread is done.
+//
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/IR/AutoUpgrade.h"
+#include "llvm/IR/Constants.h"
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/IR/Instruction.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/ModuleSummaryIndex.h"
@@ -32,11 +46,14 @@
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/SystemUtils.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Transforms/IPO/FunctionImport.h"
 #include "llvm/Transforms/IPO/Internalize.h"
 #include "llvm/Transforms/Utils/FunctionImportUtils.h"
 
+#include <atomic>
 #include <memory>
 #include <utility>
 using namespace llvm;
@@ -110,6 +127,13 @@ static cl::opt<bool> PreserveAssemblyUseListOrder(
     cl::desc("Preserve use-list order when writing LLVM assembly."),
     cl::init(false), cl::Hidden);
 
+static cl::opt<unsigned> NumThreads(
+    "num-threads", cl::init(1),
+    cl::desc("Link the input files in this many shards in parallel, then "
+             "merge the shards pairwise (0 = autodetect)"));
+static cl::alias NumThreadsA("j", cl::desc("Alias for --num-threads"),
+                             cl::aliasopt(NumThreads));
+
 static ExitOnError ExitOnErr;
 
 // Read the specified bitcode file in and return it. This routine searches the
@@ -118,9 +142,10 @@ static ExitOnError ExitOnErr;
 static std::unique_ptr<Module> loadFile(const char *argv0,
                                         const std::string &FN,
                                         LLVMContext &Context,
-                                        bool MaterializeMetadata = true) {
+                                        bool MaterializeMetadata = true,
+                                        raw_ostream &OS = errs()) {
   SMDiagnostic Err;
-  if (Verbose) errs() << "Loading '" << FN << "'\n";
+  if (Verbose) OS << "Loading '" << FN << "'\n";
   std::unique_ptr<Module> Result;
   if (DisableLazyLoad)
     Result = parseIRFile(FN, Err, Context);
@@ -128,12 +153,15 @@ static std::unique_ptr<Module> loadFile(const char *argv0,
     Result = getLazyIRFileModule(FN, Err, Context, !MaterializeMetadata);
 
   if (!Result) {
-    Err.print(argv0, errs());
+    Err.print(argv0, OS);
     return nullptr;
   }
 
   if (MaterializeMetadata) {
-    ExitOnErr(Result->materializeMetadata());
+    if (Error E = Result->materializeMetadata()) {
+      logAllUnhandledErrors(std::move(E), OS, Twine(argv0) + ": ");
+      return nullptr;
+    }
     UpgradeDebugInfo(*Result);
   }
 
@@ -184,25 +212,29 @@ Module &ModuleLazyLoaderCache::operator()(const char *argv0,
 
 namespace {
 struct LLVMLinkDiagnosticHandler : public DiagnosticHandler {
+  raw_ostream &OS;
+
+  explicit LLVMLinkDiagnosticHandler(raw_ostream &OS = errs()) : OS(OS) {}
+
   bool handleDiagnostics(const DiagnosticInfo &DI) override {
     unsigned Severity = DI.getSeverity();
     switch (Severity) {
     case DS_Error:
-      errs() << "ERROR: ";
+      OS << "ERROR: ";
       break;
     case DS_Warning:
       if (SuppressWarnings)
         return true;
-      errs() << "WARNING: ";
+      OS << "WARNING: ";
       break;
     case DS_Remark:
     case DS_Note:
       llvm_unreachable("Only expecting warnings and errors");
     }
 
-    DiagnosticPrinterRawOStream DP(errs());
+    DiagnosticPrinterRawOStream DP(OS);
     DI.print(DP);
-    errs() << '\n';
+    OS << '\n';
     return true;
   }
 };
@@ -273,33 +305,85 @@ static bool importFunctions(const char *argv0, Module &DestModule) {
   return true;
 }
 
+namespace {
+/// The lazily linked definitions made weak while linking a shard, so that the
+/// shard keeps the ones it doesn't reference: the modules of another shard may.
+struct KeptLazyDefinitions {
+  /// The original linkage of each of them.
+  StringMap<GlobalValue::LinkageTypes> Linkages;
+  /// The names that also have a weak definition, which must stay weak.
+  StringSet<> WeakNames;
+};
+} // anonymous namespace
+
+/// Record that a lazily linked definition of \p Name has \p Linkage. A linkonce
+/// definition is linked over an available_externally one, and definitions
+/// that are not all ODR are merged as non-ODR ones.
+static void addLazyLinkage(KeptLazyDefinitions &Kept, StringRef Name,
+                           GlobalValue::LinkageTypes Linkage) {
+  auto Inserted = Kept.Linkages.insert({Name, Linkage});
+  GlobalValue::LinkageTypes &Merged = Inserted.first->second;
+  if (Inserted.second || Linkage == GlobalValue::AvailableExternallyLinkage)
+    return;
+  if (Merged == GlobalValue::AvailableExternallyLinkage ||
+      Linkage == GlobalValue::LinkOnceAnyLinkage)
+    Merged = Linkage;
+}
+
+/// Make the lazily linked definitions of \p M weak, and record them in
+/// \p Kept.
+static void keepLazyDefinitions(Module &M, KeptLazyDefinitions &Kept) {
+  for (GlobalValue &GV : M.global_values()) {
+    if (!GV.hasName() || GV.isDeclaration())
+      continue;
+    if (GV.hasWeakLinkage()) {
+      Kept.WeakNames.insert(GV.getName());
+      continue;
+    }
+    if (!Linker::isLinkedLazily(GV))
+      continue;
+    addLazyLinkage(Kept, GV.getName(), GV.getLinkage());
+    GV.setLinkage(GV.getLinkage() == GlobalValue::LinkOnceAnyLinkage
+                      ? GlobalValue::WeakAnyLinkage
+                      : GlobalValue::WeakODRLinkage);
+  }
+}
+
 static bool linkFiles(const char *argv0, LLVMContext &Context, Linker &L,
-                      const cl::list<std::string> &Files,
-                      unsigned Flags) {
+                      ArrayRef<std::string> Files,
+                      unsigned Flags,
+                      raw_ostream &OS = errs(),
+                      KeptLazyDefinitions *KeptLazy = nullptr) {
   // Filter out flags that don't apply to the first file we load.
   unsigned ApplicableFlags = Flags & Linker::Flags::OverrideFromSrc;
   // Similar to some flags, internalization doesn't apply to the first file.
   bool InternalizeLinkedSymbols = false;
   for (const auto &File : Files) {
-    std::unique_ptr<Module> M = loadFile(argv0, File, Context);
+    std::unique_ptr<Module> M =
+        loadFile(argv0, File, Context, /*MaterializeMetadata=*/true, OS);
     if (!M.get()) {
-      errs() << argv0 << ": error loading file '" << File << "'\n";
+      OS << argv0 << ": error loading file '" << File << "'\n";
       return false;
     }
 
     // Note that when ODR merging types cannot verify input files in here When
     // doing that debug metadata in the src module might already be pointing to
     // the destination.
-    if (DisableDITypeMap && verifyModule(*M, &errs())) {
-      errs() << argv0 << ": " << File << ": error: input module is broken!\n";
+    if (DisableDITypeMap && verifyModule(*M, &OS)) {
+      OS << argv0 << ": " << File << ": error: input module is broken!\n";
       return false;
     }
 
     // If a module summary index is supplied, load it so linkInModule can treat
     // local functions/variables as exported and promote if necessary.
     if (!SummaryIndex.empty()) {
-      std::unique_ptr<ModuleSummaryIndex> Index =
-          ExitOnErr(llvm::getModuleSummaryIndexForFile(SummaryIndex));
+      Expected<std::unique_ptr<ModuleSummaryIndex>> IndexOrErr =
+          llvm::getModuleSummaryIndexForFile(SummaryIndex);
+      if (!IndexOrErr) {
+        logAllUnhandledErrors(IndexOrErr.takeError(), OS, Twine(argv0) + ": ");
+        return false;
+      }
+      std::unique_ptr<ModuleSummaryIndex> Index = std::move(*IndexOrErr);
 
       // Conservatively mark all internal values as promoted, since this tool
       // does not do the ThinLink that would normally determine what values to
@@ -316,8 +400,11 @@ static bool linkFiles(const char *argv0, LLVMContext &Context, Linker &L,
         return true;
     }
 
+    if (KeptLazy)
+      keepLazyDefinitions(*M, *KeptLazy);
+
     if (Verbose)
-      errs() << "Linking in '" << File << "'\n";
+      OS << "Linking in '" << File << "'\n";
 
     bool Err = false;
     if (InternalizeLinkedSymbols) {
@@ -344,6 +431,217 @@ static bool linkFiles(const char *argv0, LLVMContext &Context, Linker &L,
   return true;
 }
 
+namespace {
+/// A contiguous slice of the input files, linked into its own module. Every
+/// shard but the first owns its LLVMContext so that it can be linked on a
+/// separate thread; the first one links into the final composite module.
+struct LinkShard {
+  std::unique_ptr<LLVMContext> OwnedContext;
+  std::unique_ptr<Module> OwnedComposite;
+  std::unique_ptr<Linker> OwnedLinker;
+  LLVMContext *Context = nullptr;
+  Module *Composite = nullptr;
+  Linker *L = nullptr;
+  /// The messages of the shard, printed once the threads are joined.
+  std::string Log;
+  raw_string_ostream LogOS{Log};
+  KeptLazyDefinitions KeptLazy;
+};
+} // anonymous namespace
+
+/// Whether \p C is used outside of the global values in \p Group.
+static bool isUsedOutside(const Constant &C,
+                          const SmallPtrSetImpl<const GlobalValue *> &Group) {
+  for (const User *U : C.users()) {
+    if (auto *I = dyn_cast<Instruction>(U)) {
+      if (!Group.count(I->getFunction()))
+        return true;
+    } else if (auto *GV = dyn_cast<GlobalValue>(U)) {
+      if (!Group.count(GV))
+        return true;
+    } else if (!isa<Constant>(U) || isUsedOutside(*cast<Constant>(U), Group)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// Restore the linkage of the lazily linked definitions kept by the shards,
+/// and drop the ones left unreferenced, as linking the files serially would
+/// have.
+static void restoreLazyDefinitions(Module &M, const KeptLazyDefinitions &Kept) {
+  SmallPtrSet<const GlobalValue *, 16> Restored;
+  for (const auto &Entry : Kept.Linkages) {
+    if (Kept.WeakNames.count(Entry.first()))
+      continue;
+    GlobalValue *GV = M.getNamedValue(Entry.first());
+    // A strong definition may have replaced them.
+    if (!GV || !GV->hasWeakLinkage())
+      continue;
+    GV->setLinkage(Entry.second);
+    Restored.insert(GV);
+  }
+
+  // A serial link only brings in a comdat when one of its members is
+  // referenced, and then all of them, so the members of a comdat are dropped
+  // together, and only if all of them are lazily linked.
+  std::vector<SmallVector<GlobalValue *, 1>> Groups;
+  DenseMap<const Comdat *, unsigned> ComdatGroups;
+  for (GlobalValue &GV : M.global_values()) {
+    const Comdat *C = GV.getComdat();
+    if (!C) {
+      if (Restored.count(&GV))
+        Groups.push_back({&GV});
+      continue;
+    }
+    auto Inserted = ComdatGroups.insert({C, Groups.size()});
+    if (Inserted.second)
+      Groups.emplace_back();
+    Groups[Inserted.first->second].push_back(&GV);
+  }
+
+  // Dropping a group can leave others unreferenced.
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (auto &Group : Groups) {
+      if (Group.empty() ||
+          llvm::any_of(Group, [&](GlobalValue *GV) {
+            return !Restored.count(GV);
+          }))
+        continue;
+      SmallPtrSet<const GlobalValue *, 4> Members(Group.begin(), Group.end());
+      if (llvm::any_of(Group, [&](GlobalValue *GV) {
+            return isUsedOutside(*GV, Members);
+          }))
+        continue;
+      const Comdat *C = Group.front()->getComdat();
+      for (GlobalValue *GV : Group)
+        GV->replaceAllUsesWith(UndefValue::get(GV->getType()));
+      for (GlobalValue *GV : Group)
+        GV->eraseFromParent();
+      if (C)
+        M.getComdatSymbolTable().erase(C->getName());
+      Group.clear();
+      Changed = true;
+    }
+  }
+}
+
+/// Link \p Src into \p Dst, and release \p Src. Modules from different
+/// contexts cannot be linked directly, so \p Src goes through bitcode.
+static bool mergeShards(const char *argv0, LinkShard &Dst, LinkShard &Src,
+                        unsigned Flags) {
+  SmallVector<char, 0> Buffer;
+  {
+    raw_svector_ostream OS(Buffer);
+    WriteBitcodeToFile(Src.Composite, OS, PreserveBitcodeUseListOrder);
+  }
+  Src.OwnedLinker.reset();
+  Src.OwnedComposite.reset();
+  Src.OwnedContext.reset();
+
+  Expected<std::unique_ptr<Module>> MOrErr = parseBitcodeFile(
+      MemoryBufferRef(StringRef(Buffer.data(), Buffer.size()), "llvm-link"),
+      *Dst.Context);
+  if (!MOrErr) {
+    logAllUnhandledErrors(MOrErr.takeError(), Dst.LogOS, Twine(argv0) + ": ");
+    return false;
+  }
+  return !Dst.L->linkInModule(std::move(*MOrErr), Flags);
+}
+
+/// Link \p Files into \p L with up to NumThreads threads. The result is the
+/// same as calling linkFiles, which is used when a single thread is requested.
+static bool linkFilesInParallel(const char *argv0, LLVMContext &Context,
+                                Linker &L, Module &Composite,
+                                ArrayRef<std::string> Files,
+                                unsigned Flags) {
+  unsigned NumShards = NumThreads ? NumThreads : hardware_concurrency();
+  NumShards = std::min<size_t>(NumShards, Files.size());
+  if (NumShards <= 1)
+    return linkFiles(argv0, Context, L, Files, Flags);
+
+  // The diagnostics of each shard go to its log, printed from this thread in
+  // the order of the shards.
+  std::vector<LinkShard> Shards(NumShards);
+  Shards[0].Context = &Context;
+  Shards[0].Composite = &Composite;
+  Shards[0].L = &L;
+  Context.setDiagnosticHandler(
+      llvm::make_unique<LLVMLinkDiagnosticHandler>(Shards[0].LogOS), true);
+  for (unsigned I = 1; I != NumShards; ++I) {
+    LinkShard &Shard = Shards[I];
+    Shard.OwnedContext = llvm::make_unique<LLVMContext>();
+    Shard.OwnedContext->setDiagnosticHandler(
+        llvm::make_unique<LLVMLinkDiagnosticHandler>(Shard.LogOS), true);
+    if (!DisableDITypeMap)
+      Shard.OwnedContext->enableDebugTypeODRUniquing();
+    Shard.OwnedComposite =
+        llvm::make_unique<Module>("llvm-link", *Shard.OwnedContext);
+    Shard.OwnedLinker = llvm::make_unique<Linker>(*Shard.OwnedComposite);
+    Shard.Context = Shard.OwnedContext.get();
+    Shard.Composite = Shard.OwnedComposite.get();
+    Shard.L = Shard.OwnedLinker.get();
+  }
+
+  auto PrintLogs = [&] {
+    for (LinkShard &Shard : Shards) {
+      errs() << Shard.LogOS.str();
+      Shard.Log.clear();
+    }
+  };
+
+  std::atomic<bool> Failed(false);
+  ThreadPool Pool(NumShards);
+
+  // Link each shard of the inputs.
+  ArrayRef<std::string> Remaining = Files;
+  for (unsigned I = 0; I != NumShards; ++I) {
+    size_t Size = Remaining.size() / (NumShards - I);
+    ArrayRef<std::string> ShardFiles = Remaining.take_front(Size);
+    Remaining = Remaining.drop_front(Size);
+    Pool.async([&, I, ShardFiles] {
+      LinkShard &Shard = Shards[I];
+      if (!linkFiles(argv0, *Shard.Context, *Shard.L, ShardFiles, Flags,
+                     Shard.LogOS, &Shard.KeptLazy))
+        Failed = true;
+    });
+  }
+  Pool.wait();
+  PrintLogs();
+
+  KeptLazyDefinitions KeptLazy;
+  for (LinkShard &Shard : Shards) {
+    for (const auto &Entry : Shard.KeptLazy.Linkages)
+      addLazyLinkage(KeptLazy, Entry.first(), Entry.second);
+    for (const auto &Entry : Shard.KeptLazy.WeakNames)
+      KeptLazy.WeakNames.insert(Entry.first());
+  }
+
+  // Merge adjacent shards (~ lg(NumShards) serial steps).
+  for (unsigned Stride = 1; !Failed && Stride < NumShards; Stride *= 2) {
+    for (unsigned I = 0; I + Stride < NumShards; I += 2 * Stride) {
+      if (Verbose)
+        errs() << "Merging shard " << I + Stride << " into shard " << I
+               << "\n";
+      Pool.async([&, I, Stride] {
+        if (!mergeShards(argv0, Shards[I], Shards[I + Stride], Flags))
+          Failed = true;
+      });
+    }
+    Pool.wait();
+    PrintLogs();
+  }
+
+  Context.setDiagnosticHandler(llvm::make_unique<LLVMLinkDiagnosticHandler>(),
+                               true);
+  if (Failed)
+    return false;
+  restoreLazyDefinitions(Composite, KeptLazy);
+  return true;
+}
+
 int main(int argc, char **argv) {
   // Print a stack trace if we signal out.
   sys::PrintStackTraceOnErrorSignal(argv[0]);
@@ -360,6 +658,14 @@ int main(int argc, char **argv) {
   if (!DisableDITypeMap)
     Context.enableDebugTypeODRUniquing();
 
+  // Both options depend on what was linked so far, which the shards don't see.
+  if (NumThreads != 1 && (OnlyNeeded || Internalize)) {
+    errs() << argv[0]
+           << ": -num-threads cannot be used with -only-needed or "
+              "-internalize\n";
+    return 1;
+  }
+
   auto Composite = make_unique<Module>("llvm-link", Context);
   Linker L(*Composite);
 
@@ -368,7 +674,8 @@ int main(int argc, char **argv) {
     Flags |= Linker::Flags::LinkOnlyNeeded;
 
   // First add all the regular input files
-  if (!linkFiles(argv[0], Context, L, InputFilenames, Flags))
+  if (!linkFilesInParallel(argv[0], Context, L, *Composite, InputFilenames,
+                           Flags))
     return 1;
 
   // Next the -override ones.
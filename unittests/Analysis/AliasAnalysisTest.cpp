@@ -205,6 +205,53 @@ TEST_F(AliasAnalysisTest, getModRefInfo) {
   EXPECT_EQ(AA.getModRefInfo(AtomicRMW, None), ModRefInfo::ModRef);
 }
 
+TEST_F(AliasAnalysisTest, BatchAAResults) {
+  // Setup function.
+  auto IntType = Type::getInt32Ty(C);
+  FunctionType *FTy =
+      FunctionType::get(Type::getVoidTy(C), {IntType}, false);
+  auto *F = cast<Function>(M.getOrInsertFunction("f", FTy));
+  auto *BB = BasicBlock::Create(C, "entry", F);
+  auto *ArrayTy = ArrayType::get(IntType, 8);
+  auto *Zero = ConstantInt::get(IntType, 0);
+  auto *One = ConstantInt::get(IntType, 1);
+  Value *Index = &*F->arg_begin();
+
+  auto *Alloca = new AllocaInst(ArrayTy, 0, "array", BB);
+  auto *GEP0 = GetElementPtrInst::CreateInBounds(Alloca, {Zero, Zero}, "", BB);
+  auto *GEP1 = GetElementPtrInst::CreateInBounds(Alloca, {Zero, One}, "", BB);
+  auto *GEPN = GetElementPtrInst::CreateInBounds(Alloca, {Zero, Index}, "", BB);
+  auto *Other = new AllocaInst(ArrayTy, 0, "other", BB);
+  auto *GEPO = GetElementPtrInst::CreateInBounds(Other, {Zero, One}, "", BB);
+  ReturnInst::Create(C, nullptr, BB);
+
+  auto &AA = getAAResults(*F);
+  MemoryLocation Loc0(GEP0, 4), Loc1(GEP1, 4), LocN(GEPN, 4), LocO(GEPO, 4);
+
+  BatchAAResults BatchAA(AA);
+  EXPECT_EQ(BatchAA.alias(Loc0, Loc1), NoAlias);
+  EXPECT_EQ(BatchAA.alias(Loc0, LocN), MayAlias);
+  EXPECT_EQ(BatchAA.alias(Loc0, Loc0), MustAlias);
+
+  // The cached results match the ones of the underlying AA, and come back in
+  // the order of the queries even though they are grouped by object.
+  SmallVector<AliasResult, 4> Results;
+  BatchAA.alias({{Loc0, Loc1}, {LocO, LocO}, {Loc1, LocN}, {Loc0, Loc1}},
+                Results);
+  ASSERT_EQ(Results.size(), 4u);
+  EXPECT_EQ(Results[0], AA.alias(Loc0, Loc1));
+  EXPECT_EQ(Results[1], MustAlias);
+  EXPECT_EQ(Results[2], AA.alias(Loc1, LocN));
+  EXPECT_EQ(Results[3], Results[0]);
+
+  // Changing the IR requires clearing the batch, but the queries made outside
+  // of it don't see its caches.
+  GEP1->setOperand(2, Zero);
+  EXPECT_EQ(AA.alias(Loc0, Loc1), MustAlias);
+  BatchAA.clear();
+  EXPECT_EQ(BatchAA.alias(Loc0, Loc1), MustAlias);
+}
+
 class AAPassInfraTest : public testing::Test {
 protected:
   LLVMContext C;
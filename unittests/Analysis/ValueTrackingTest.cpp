@@ -8,6 +8,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Analysis/ValueTracking.h"
+#include "llvm/Analysis/KnownBitsCache.h"
 #include "llvm/AsmParser/Parser.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/InstIterator.h"
@@ -313,3 +314,37 @@ TEST(ValueTracking, ComputeKnownMulBits) {
   EXPECT_EQ(Known.One.getZExtValue(), 32u);
   EXPECT_EQ(Known.Zero.getZExtValue(), 95u);
 }
+
+TEST(ValueTracking, ComputeKnownBitsCacheAfterMutation) {
+  StringRef Assembly = "define i32 @f(i32 %a) { "
+                       "  %and = and i32 %a, 15 "
+                       "  %mul = mul i32 %and, %and "
+                       "  ret i32 %mul "
+                       "} ";
+
+  LLVMContext Context;
+  SMDiagnostic Error;
+  auto M = parseAssemblyString(Assembly, Error, Context);
+  assert(M && "Bad assembly?");
+
+  auto *F = M->getFunction("f");
+  assert(F && "Bad assembly?");
+
+  const DataLayout &DL = M->getDataLayout();
+  auto *And = cast<Instruction>(&F->getEntryBlock().front());
+  auto *Mul = And->getNextNode();
+
+  KnownBitsCache Cache;
+  auto Known = computeKnownBits(Mul, DL, 0, nullptr, nullptr, nullptr,
+                                nullptr, &Cache);
+  EXPECT_EQ(Known.countMinLeadingZeros(), 24u);
+
+  // Reusing the cache after an in-place change of an operand doesn't return
+  // the results computed before the change.
+  And->setOperand(1, ConstantInt::get(And->getType(), 255));
+  Known = computeKnownBits(Mul, DL, 0, nullptr, nullptr, nullptr, nullptr,
+                           &Cache);
+  EXPECT_EQ(Known.countMinLeadingZeros(), 16u);
+  EXPECT_EQ(ComputeNumSignBits(And, DL, 0, nullptr, nullptr, nullptr, &Cache),
+            24u);
+}
@@ -950,3 +950,37 @@ TEST(DominatorTree, InsertIntoIrreducible) {
   EXPECT_TRUE(DT.verify());
 }
 
+TEST(DominatorTree, StateMachine) {
+  // A dispatch loop over many states, where each state can also fall through
+  // to the next one, similar to the CFGs of generated state machines.
+  const unsigned NumStates = 256;
+  std::vector<std::string> States;
+  for (unsigned i = 0; i < NumStates; ++i)
+    States.push_back("s" + std::to_string(i));
+
+  std::vector<CFGBuilder::Arc> Arcs = {{"entry", "dispatch"}};
+  for (unsigned i = 0; i < NumStates; ++i) {
+    Arcs.push_back({"dispatch", States[i]});
+    Arcs.push_back({States[i], "dispatch"});
+    StringRef Next =
+        i + 1 == NumStates ? StringRef("exit") : StringRef(States[i + 1]);
+    Arcs.push_back({States[i], Next});
+  }
+
+  CFGHolder Holder;
+  CFGBuilder B(Holder.F, Arcs, {});
+  DominatorTree DT(*Holder.F);
+  EXPECT_TRUE(DT.verify());
+  PostDomTree PDT(*Holder.F);
+  EXPECT_TRUE(PDT.verify());
+
+  BasicBlock *Dispatch = B.getOrAddBlock("dispatch");
+  BasicBlock *Exit = B.getOrAddBlock("exit");
+  for (unsigned i = 0; i < NumStates; ++i) {
+    BasicBlock *State = B.getOrAddBlock(States[i]);
+    EXPECT_EQ(DT.getNode(State)->getIDom()->getBlock(), Dispatch);
+    EXPECT_TRUE(PDT.dominates(Exit, State));
+  }
+  EXPECT_EQ(DT.getNode(Exit)->getIDom()->getBlock(),
+            B.getOrAddBlock(States.back()));
+}